@@ -30,6 +30,7 @@
 
 int
 actor_commands (
+        zsock_t *pipe,
         mlm_client_t *client,
         zmsg_t **message_p,
         bool& verbose,
@@ -90,6 +91,7 @@ actor_commands (
         }
         else {
             nut_agent.setClient (client);
+            nut_agent.agentName (name);
         }
         zstr_free (&endpoint);
         zstr_free (&name);
@@ -195,8 +197,207 @@ actor_commands (
             timeout = 30000;
         }
         nut_agent.TTL (timeout * 2 / 1000);
+        nut_agent.pollingInterval (timeout);
         zstr_free (&polling);
     }
+    else
+    if (streq (cmd, "WORKERS")) {
+        char *workers = zmsg_popstr (message);
+        if (!workers) {
+            log_error (
+                "Expected multipart string format: WORKERS/value. "
+                "Received WORKERS/nullptr");
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        int count = atoi (workers);
+        if (count <= 0) {
+            log_error ("invalid WORKERS value '%s', using default instead", workers);
+            count = NUT_POLLER_DEFAULT_WORKERS;
+        }
+        nut_agent.pollingWorkers (count);
+        zstr_free (&workers);
+    }
+    else
+    if (streq (cmd, "DEADLINE")) {
+        char *device = zmsg_popstr (message);
+        char *budget = zmsg_popstr (message);
+        if (!device || !budget) {
+            log_error (
+                "Expected multipart string format: DEADLINE/device/budget. "
+                "Received DEADLINE/%s/%s", device ? device : "nullptr", budget ? budget : "nullptr");
+            zstr_free (&device);
+            zstr_free (&budget);
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        int64_t deadline = atoi (device) * 1000;
+        if (deadline <= 0) {
+            log_error ("invalid DEADLINE device value '%s', using default instead", device);
+            deadline = NUT_POLLER_DEFAULT_DEADLINE;
+        }
+        int64_t limit = atoi (budget) * 1000;
+        if (limit <= 0) {
+            log_error ("invalid DEADLINE budget value '%s', using default instead", budget);
+            limit = NUT_POLLER_DEFAULT_BUDGET;
+        }
+        nut_agent.fetchDeadline (deadline);
+        nut_agent.cycleBudget (limit);
+        zstr_free (&device);
+        zstr_free (&budget);
+    }
+    else
+    if (streq (cmd, "SELECTIVE")) {
+        char *enabled = zmsg_popstr (message);
+        if (!enabled) {
+            log_error (
+                "Expected multipart string format: SELECTIVE/value. "
+                "Received SELECTIVE/nullptr");
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        nut_agent.selectiveFetch (streq (enabled, "true"));
+        zstr_free (&enabled);
+    }
+    else
+    if (streq (cmd, "STATUS")) {
+        char *interval = zmsg_popstr (message);
+        if (!interval) {
+            log_error (
+                "Expected multipart string format: STATUS/value. "
+                "Received STATUS/nullptr");
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        // seconds, fractions allowed
+        char *end = NULL;
+        double seconds = strtod (interval, &end);
+        if (end == interval || *end != '\0') {
+            log_error (
+                "Expected multipart string format: STATUS/value. "
+                "Received STATUS/%s", interval);
+            zstr_free (&interval);
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        int64_t status = static_cast <int64_t> (seconds * 1000);
+        if (status < 0) {
+            log_error ("invalid STATUS value '%s', using default instead", interval);
+            status = NUT_STATUS_DEFAULT_INTERVAL;
+        }
+        nut_agent.statusInterval (status);
+        zstr_free (&interval);
+    }
+    else
+    if (streq (cmd, "SAMPLING")) {
+        char *interval = zmsg_popstr (message);
+        if (!interval) {
+            log_error (
+                "Expected multipart string format: SAMPLING/value. "
+                "Received SAMPLING/nullptr");
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        // milliseconds
+        char *end = NULL;
+        long long sampling = strtoll (interval, &end, 10);
+        if (end == interval || *end != '\0') {
+            log_error (
+                "Expected multipart string format: SAMPLING/value. "
+                "Received SAMPLING/%s", interval);
+            zstr_free (&interval);
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        if (sampling < 0) {
+            log_error ("invalid SAMPLING value '%s', using default instead", interval);
+            sampling = NUT_SAMPLER_DEFAULT_INTERVAL;
+        }
+        nut_agent.samplingInterval (sampling);
+        zstr_free (&interval);
+    }
+    else
+    if (streq (cmd, "DEMAND")) {
+        char *enabled = zmsg_popstr (message);
+        if (!enabled) {
+            log_error (
+                "Expected multipart string format: DEMAND/value. "
+                "Received DEMAND/nullptr");
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        nut_agent.interest ().enabled (streq (enabled, "true"));
+        zstr_free (&enabled);
+    }
+    else
+    if (streq (cmd, "ENDPOINTS")) {
+        char *list = zmsg_popstr (message);
+        if (!list) {
+            log_error (
+                "Expected multipart string format: ENDPOINTS/list. "
+                "Received ENDPOINTS/nullptr");
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        std::vector <std::string> endpoints;
+        std::string item;
+        for (const char *p = list; ; ++p) {
+            if (*p == 0 || *p == ',' || isspace (*p)) {
+                if (!item.empty ()) endpoints.push_back (item);
+                item.clear ();
+                if (*p == 0) break;
+            }
+            else {
+                item += *p;
+            }
+        }
+        drivers::nut::NUTEndpoints::instance ().configure (endpoints);
+        zstr_free (&list);
+    }
+    else
+    if (streq (cmd, "DRIVERS")) {
+        char *enabled = zmsg_popstr (message);
+        char *state_path = zmsg_popstr (message);
+        if (!enabled || !state_path) {
+            log_error (
+                "Expected multipart string format: DRIVERS/value/state_path. "
+                "Received DRIVERS/%s/%s", enabled ? enabled : "nullptr", state_path ? state_path : "nullptr");
+            zstr_free (&enabled);
+            zstr_free (&state_path);
+            zstr_free (&cmd);
+            zmsg_destroy (message_p);
+            return 0;
+        }
+        nut_agent.driverSockets (streq (enabled, "true"), streq (state_path, "") ? NUT_DRIVER_STATE_PATH : state_path);
+        zstr_free (&enabled);
+        zstr_free (&state_path);
+    }
+    else
+    if (streq (cmd, "STATS")) {
+        zmsg_t *reply = zmsg_new ();
+        zmsg_addstr (reply, "STATS");
+        for (const auto& it : nut_agent.stats ()) {
+            zmsg_addstr (reply, it.first.c_str ());
+            zmsg_addstr (reply, std::to_string (it.second).c_str ());
+        }
+        zmsg_send (&reply, pipe);
+    }
+    else
+    if (streq (cmd, "OVERLOAD")) {
+        auto level = nut_agent.overloadLevel ();
+        zstr_sendx (pipe, "OVERLOAD",
+                    std::to_string (static_cast <int> (level)).c_str (),
+                    drivers::nut::NUTOverload::name (level), NULL);
+    }
     else {
         log_warning ("Command '%s' is unknown or not implemented", cmd);
     }
@@ -246,6 +447,12 @@ actor_commands_test (bool verbose)
     mlm_client_t *client = mlm_client_new ();
     assert (client);
 
+    // replies of the actor go to pipe, peer reads them
+    zsock_t *pipe = zsock_new_pair ("@inproc://actor-commands-test");
+    assert (pipe);
+    zsock_t *peer = zsock_new_pair (">inproc://actor-commands-test");
+    assert (peer);
+
     zmsg_t *message = NULL;
     bool actor_verbose = false;
 
@@ -259,7 +466,7 @@ actor_commands_test (bool verbose)
     // empty message - expected fail
     message = zmsg_new ();
     assert (message);
-    int rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    int rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -277,7 +484,7 @@ actor_commands_test (bool verbose)
     message = zmsg_new ();
     assert (message);
     zmsg_addstr (message, "");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -295,7 +502,7 @@ actor_commands_test (bool verbose)
     message = zmsg_new ();
     assert (message);
     zmsg_addstr (message, "MAGIC!");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -315,7 +522,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONFIGURE");
     // missing mapping_file here
     // missing state_file here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -335,7 +542,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONFIGURE");
     zmsg_addstr (message, "sdfwwed");
     // missing state_file here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -355,7 +562,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONNECT");
     zmsg_addstr (message, endpoint);
     // missing name here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -375,7 +582,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONNECT");
     // missing endpoint here
     // missing name here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -395,7 +602,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONNECT");
     zmsg_addstr (message, "ipc://fty-nut-server-BAD");
     zmsg_addstr (message, "test-agent");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -414,7 +621,7 @@ actor_commands_test (bool verbose)
     assert (message);
     zmsg_addstr (message, "PRODUCER");
     // missing stream here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -434,7 +641,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONSUMER");
     zmsg_addstr (message, "some-stream");
     // missing pattern here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -454,7 +661,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONSUMER");
     // missing stream here
     // missing pattern here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -473,7 +680,7 @@ actor_commands_test (bool verbose)
     assert (message);
     zmsg_addstr (message, "POLLING");
     // missing value here
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -492,7 +699,7 @@ actor_commands_test (bool verbose)
     assert (message);
     zmsg_addstr (message, "POLLING");
     zmsg_addstr (message, "a14s2"); // Bad value
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == false);
@@ -504,6 +711,38 @@ actor_commands_test (bool verbose)
 
     STDERR_NON_EMPTY
 
+    // --------------------------------------------------------------
+    fp = freopen ("stderr.txt", "w+", stderr);
+    // STATUS - expected fail, the interval is kept
+    int64_t statusInterval = nut_agent.statusInterval ();
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "STATUS");
+    zmsg_addstr (message, "abc"); // Bad value
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.statusInterval () == statusInterval);
+
+    STDERR_NON_EMPTY
+
+    // --------------------------------------------------------------
+    fp = freopen ("stderr.txt", "w+", stderr);
+    // SAMPLING - expected fail, milliseconds are whole and sampling stays on
+    int64_t samplingInterval = nut_agent.samplingInterval ();
+    for (const char *bad : { "abc", "0.5" }) {
+        message = zmsg_new ();
+        assert (message);
+        zmsg_addstr (message, "SAMPLING");
+        zmsg_addstr (message, bad);
+        rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+        assert (rv == 0);
+        assert (message == NULL);
+        assert (nut_agent.samplingInterval () == samplingInterval);
+    }
+
+    STDERR_NON_EMPTY
+
     // The original client still waiting on the bad endpoint for malamute
     // server to show up. Therefore we must destroy and create it again.
     mlm_client_destroy (&client);
@@ -526,7 +765,7 @@ actor_commands_test (bool verbose)
     message = zmsg_new ();
     assert (message);
     zmsg_addstr (message, "VERBOSE");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -542,7 +781,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONFIGURE");
     zmsg_addstr (message, "src/mapping.conf");
     zmsg_addstr (message, "src/selftest_state_file");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -556,7 +795,7 @@ actor_commands_test (bool verbose)
     message = zmsg_new ();
     assert (message);
     zmsg_addstr (message, "$TERM");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 1);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -571,7 +810,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONNECT");
     zmsg_addstr (message, endpoint);
     zmsg_addstr (message, "test-agent");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -586,7 +825,7 @@ actor_commands_test (bool verbose)
     zmsg_addstr (message, "CONSUMER");
     zmsg_addstr (message, "some-stream");
     zmsg_addstr (message, ".+@.+");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -600,7 +839,7 @@ actor_commands_test (bool verbose)
     assert (message);
     zmsg_addstr (message, "PRODUCER");
     zmsg_addstr (message, "some-stream");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -614,7 +853,7 @@ actor_commands_test (bool verbose)
     assert (message);
     zmsg_addstr (message, "POLLING");
     zmsg_addstr (message, "150");
-    rv = actor_commands (client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
     assert (rv == 0);
     assert (message == NULL);
     assert (actor_verbose == true);
@@ -622,9 +861,150 @@ actor_commands_test (bool verbose)
     assert (nut_agent.isMappingLoaded () == true);
     assert (nut_agent.isClientSet () == true);
     assert (nut_agent.TTL () == 300);
+    assert (nut_agent.pollingInterval () == 150000);
+
+    // WORKERS
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "WORKERS");
+    zmsg_addstr (message, "8");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.pollingWorkers () == 8);
+
+    // DEADLINE
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "DEADLINE");
+    zmsg_addstr (message, "3");
+    zmsg_addstr (message, "20");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.fetchDeadline () == 3000);
+    assert (nut_agent.cycleBudget () == 20000);
+
+    // SELECTIVE
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "SELECTIVE");
+    zmsg_addstr (message, "true");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.selectiveFetch ());
+
+    // STATUS
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "STATUS");
+    zmsg_addstr (message, "1");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.statusInterval () == 1000);
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "STATUS");
+    zmsg_addstr (message, "0.5");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.statusInterval () == 500);
+
+    // SAMPLING
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "SAMPLING");
+    zmsg_addstr (message, "250");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.samplingInterval () == 250);
+
+    // DEMAND
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "DEMAND");
+    zmsg_addstr (message, "true");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.interest ().enabled ());
+
+    // ENDPOINTS
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "ENDPOINTS");
+    zmsg_addstr (message, "localhost:3493, localhost:3494");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (drivers::nut::NUTEndpoints::instance ().endpoints ().size () == 2);
+    assert (drivers::nut::NUTEndpoints::instance ().endpoints ()[1].port == 3494);
+    drivers::nut::NUTEndpoints::instance ().configure ({});
+
+    // DRIVERS
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "DRIVERS");
+    zmsg_addstr (message, "true");
+    zmsg_addstr (message, "");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    assert (nut_agent.driverSockets ());
+    assert (nut_agent.driverHandles ().empty ());
+
+    // STATS
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "STATS");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    message = zmsg_recv (peer);
+    assert (message);
+    assert (zmsg_size (message) % 2 == 1);
+    char *reply = zmsg_popstr (message);
+    assert (streq (reply, "STATS"));
+    zstr_free (&reply);
+    bool devices = false;
+    while (zmsg_size (message) > 0) {
+        char *name = zmsg_popstr (message);
+        char *value = zmsg_popstr (message);
+        if (streq (name, "devices")) devices = true;
+        zstr_free (&name);
+        zstr_free (&value);
+    }
+    assert (devices);
+    zmsg_destroy (&message);
+
+    // OVERLOAD
+    message = zmsg_new ();
+    assert (message);
+    zmsg_addstr (message, "OVERLOAD");
+    rv = actor_commands (pipe, client, &message, actor_verbose, actor_polling, nut_agent, data, state_file);
+    assert (rv == 0);
+    assert (message == NULL);
+    message = zmsg_recv (peer);
+    assert (message && zmsg_size (message) == 3);
+    reply = zmsg_popstr (message);
+    assert (streq (reply, "OVERLOAD"));
+    zstr_free (&reply);
+    reply = zmsg_popstr (message);
+    assert (streq (reply, "0"));
+    zstr_free (&reply);
+    reply = zmsg_popstr (message);
+    assert (streq (reply, drivers::nut::NUTOverload::name (drivers::nut::NUTOverloadLevel::NONE)));
+    zstr_free (&reply);
+    zmsg_destroy (&message);
 
     STDERR_EMPTY
 
+    zsock_destroy (&peer);
+    zsock_destroy (&pipe);
     nut_destroy (&data);
     zmsg_destroy (&message);
     mlm_client_destroy (&client);
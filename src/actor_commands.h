@@ -51,14 +51,62 @@ class NUTAgent;
 //      change polling interval, where
 //      value - new polling interval in seconds
 //
+//  WORKERS/value
+//      change number of parallel upsd polling workers, where
+//      value - new number of workers
+//
+//  DEADLINE/device/budget
+//      change time limits of polling, where
+//      device - seconds to wait for one device
+//      budget - seconds to start the devices of one poll
+//
+//  SELECTIVE/value
+//      switch selective fetching of device variables, where
+//      value - "true" to fetch just the variables that are used
+//
+//  STATUS/value
+//      change interval of the status lane, where
+//      value - seconds between reads of status variables, 0 turns
+//              the lane off
+//
+//  SAMPLING/value
+//      change interval of sampling metrics selected by asset attribute
+//      'sampling', where
+//      value - milliseconds between samples, 0 turns sampling off
+//
+//  DEMAND/value
+//      switch demand driven publishing, where
+//      value - "true" to publish just the core metrics and those
+//              registered over mailbox (subject INTEREST)
+//
+//  ENDPOINTS/list
+//      change upsd instances serving the devices, where
+//      list - "host[:port]" separated by commas or spaces, default
+//             localhost:3493 if empty
+//
+//  DRIVERS/value/state_path
+//      switch reading variables from NUT driver sockets, where
+//      value - "true" to take variables from drivers as they change
+//      state_path - directory of the driver sockets, empty for default
+//
+//  STATS
+//      replies STATS/name/value/... on pipe with the agent counters
+//      (devices, upsd sessions, ...)
+//
+//  OVERLOAD
+//      replies OVERLOAD/level/name on pipe with the degradation level
+//      of polling (0 none, 1 inventory,
+//      2 devices, 3 outlets)
+//
 
 
 
-// Performs the actor commands logic
+// Performs the actor commands logic, replies go to pipe
 // Destroys the message
 // Returns 1 for $TERM (means exit), 0 otherwise
 FTY_NUT_EXPORT int
     actor_commands (
+            zsock_t *pipe,
             mlm_client_t *client,
             zmsg_t **message_p,
             bool& verbose,
@@ -191,9 +191,14 @@ alert_actor (zsock_t *pipe, void *args)
     Devices devices;
     devices.setPollingMs (polling);
 
-    zpoller_t *poller = zpoller_new (pipe, mlm_client_msgpipe (client), NULL);
+    auto& snapshotBus = drivers::nut::NUTSnapshotBus::instance ();
+    zsock_t *snapshots = drivers::nut::NUTSnapshotBus::subscribe ();
+    zsock_t *statuses = drivers::nut::NUTSnapshotBus::subscribeStatus ();
+    zpoller_t *poller = zpoller_new (pipe, mlm_client_msgpipe (client), snapshots, statuses, NULL);
     if (!poller) {
         log_critical ("zpoller_new () failed");
+        zsock_destroy (&statuses);
+        zsock_destroy (&snapshots);
         mlm_client_destroy (&client);
         return;
     }
@@ -209,11 +214,36 @@ alert_actor (zsock_t *pipe, void *args)
     while (!zsys_interrupted) {
         void *which = zpoller_wait (poller, polling);
         if (which == NULL) {
+            // values come with snapshots of nut server, ask upsd only
+            // when they stopped coming
+            if (snapshotBus.fresh (2 * polling)) continue;
             log_debug ("aa: alert update");
             devices.updateFromNUT ();
             devices.publishRules (client);
             devices.publishAlerts (client);
         }
+        else if (which == snapshots) {
+            zmsg_t *msg = zmsg_recv (snapshots);
+            zmsg_destroy (&msg);
+            auto snapshot = snapshotBus.latest ();
+            if (snapshot) {
+                log_debug ("aa: alert update from snapshot %" PRIu64, snapshot->cycle);
+                devices.updateFromSnapshot (*snapshot);
+                devices.publishRules (client);
+                devices.publishAlerts (client);
+            }
+        }
+        else if (which == statuses) {
+            // status changed between snapshots, alerts go out at once
+            zmsg_t *msg = zmsg_recv (statuses);
+            zmsg_destroy (&msg);
+            auto status = snapshotBus.latestStatus ();
+            if (status) {
+                log_debug ("aa: alert update from status %" PRIu64, status->cycle);
+                devices.updateFromStatus (*status);
+                devices.publishAlerts (client);
+            }
+        }
         else if (which == pipe) {
             zmsg_t *msg = zmsg_recv (pipe);
             if (msg) {
@@ -237,6 +267,8 @@ alert_actor (zsock_t *pipe, void *args)
         }
     }
     zpoller_destroy (&poller);
+    zsock_destroy (&statuses);
+    zsock_destroy (&snapshots);
     mlm_client_destroy (&client);
 }
 
@@ -109,51 +109,41 @@ Device::addAlert(const std::string& quantity, const std::map<std::string,std::ve
 }
 
 int
-Device::scanCapabilities (nut::TcpClient& conn)
+Device::scanCapabilities (const std::map<std::string,std::vector<std::string> >& vars)
 {
-    log_debug ("aa: scanning capabilities for %s", _assetName.c_str());
-    if (!conn.isConnected ()) return 0;
     std::string prefix = daisychainPrefix();
 
     _alerts.clear();
-    try {
-        auto nutDevice = conn.getDevice(_nutName);
-        if (! nutDevice.isOk()) { throw std::runtime_error("device " + _assetName + " is not configured in NUT yet"); }
-        auto vars = nutDevice.getVariableValues();
-        if (vars.empty ()) return 0;
-        if (vars.find (prefix + "ambient.temperature.status") != vars.cend()) {
-            addAlert ("ambient.temperature", vars);
+    if (vars.empty ()) return 0;
+    if (vars.find (prefix + "ambient.temperature.status") != vars.cend()) {
+        addAlert ("ambient.temperature", vars);
+    }
+    if (vars.find (prefix + "ambient.humidity.status") != vars.cend()) {
+        addAlert ("ambient.humidity", vars);
+    }
+    for (int a=1; a<=3; a++) {
+        std::string q = "input.L" + std::to_string(a) + ".current";
+        if (vars.find (prefix + q + ".status") != vars.cend()) {
+            addAlert (q, vars);
         }
-        if (vars.find (prefix + "ambient.humidity.status") != vars.cend()) {
-            addAlert ("ambient.humidity", vars);
+        q = "input.L" + std::to_string(a) + ".voltage";
+        if (vars.find (prefix + q + ".status") != vars.cend()) {
+            addAlert (q, vars);
         }
-        for (int a=1; a<=3; a++) {
-            std::string q = "input.L" + std::to_string(a) + ".current";
-            if (vars.find (prefix + q + ".status") != vars.cend()) {
-                addAlert (q, vars);
-            }
-            q = "input.L" + std::to_string(a) + ".voltage";
-            if (vars.find (prefix + q + ".status") != vars.cend()) {
-                addAlert (q, vars);
-            }
+    }
+    for (int a=1; a<=1000; a++) {
+        int found = 0;
+        std::string q = "outlet.group." + std::to_string(a) + ".current";
+        if (vars.find (prefix + q + ".status") != vars.cend()) {
+            addAlert (q, vars);
+            ++found;
         }
-        for (int a=1; a<=1000; a++) {
-            int found = 0;
-            std::string q = "outlet.group." + std::to_string(a) + ".current";
-            if (vars.find (prefix + q + ".status") != vars.cend()) {
-                addAlert (q, vars);
-                ++found;
-            }
-            q = "outlet.group." + std::to_string(a) + ".voltage";
-            if (vars.find (prefix + q + ".status") != vars.cend()) {
-                addAlert (q, vars);
-                ++found;
-            }
-            if (!found) break;
+        q = "outlet.group." + std::to_string(a) + ".voltage";
+        if (vars.find (prefix + q + ".status") != vars.cend()) {
+            addAlert (q, vars);
+            ++found;
         }
-    } catch ( std::exception &e ) {
-        log_error("aa: Communication problem with %s (%s)", _assetName.c_str(), e.what() );
-        return 0;
+        if (!found) break;
     }
     _scanned = true;
     return 1;
@@ -305,25 +295,26 @@ Device::publishRule (mlm_client_t *client, DeviceAlert& alert)
 }
 
 void
-Device::update (nut::TcpClient& conn)
+Device::updateStatus (const std::string& quantity, DeviceAlert& alert, const std::string& newStatus)
+{
+    log_debug ("aa: %s on %s is %s", quantity.c_str (), _assetName.c_str (), newStatus.c_str());
+    if (alert.status != newStatus) {
+        alert.timestamp = ::time(NULL);
+        alert.status = newStatus;
+    }
+}
+
+void
+Device::update (const std::map<std::string,std::vector<std::string> >& vars)
 {
-    auto nutDevice = conn.getDevice(_nutName);
-    if (! nutDevice.isOk()) return;
+    std::string prefix = daisychainPrefix();
     for (auto &it: _alerts) {
-        try {
-            std::string prefix = daisychainPrefix();
-            auto value = nutDevice.getVariableValue (prefix + it.first + ".status");
-            if (value.empty ()) {
-                log_debug ("aa: %s on %s is not present", it.first.c_str (), _assetName.c_str ());
-            } else {
-                std::string newStatus =  value[0];
-                log_debug ("aa: %s on %s is %s", it.first.c_str (), _assetName.c_str (), newStatus.c_str());
-                if (it.second.status != newStatus) {
-                    it.second.timestamp = ::time(NULL);
-                    it.second.status = newStatus;
-                }
-            }
-        } catch (...) {}
+        const auto value = vars.find (prefix + it.first + ".status");
+        if (value == vars.cend () || value->second.empty ()) {
+            log_debug ("aa: %s on %s is not present", it.first.c_str (), _assetName.c_str ());
+        } else {
+            updateStatus (it.first, it.second, value->second[0]);
+        }
     }
 }
 
@@ -370,6 +361,22 @@ alert_device_test (bool verbose)
     assert(dev._alerts["ambient.temperature"].lowCritical == "5");
     assert(dev._alerts["ambient.temperature"].highWarning == "80");
     assert(dev._alerts["ambient.temperature"].highCritical == "100");
+
+    // scan and update from already fetched variables
+    Device chained ("epdu-2", "epdu", 2);
+    std::map<std::string,std::vector<std::string> > chainVars = {
+        { "device.2.input.L1.current.status", {"good"} },
+        { "device.2.input.L1.current.high.warning", {"16"} },
+        { "device.2.input.L1.current.high.critical", {"20"} },
+        { "device.2.input.L1.current.low.warning", {"0"} },
+    };
+    assert (chained.scanCapabilities (chainVars) == 1);
+    assert (chained.scanned ());
+    assert (chained._alerts.size () == 1);
+    chainVars["device.2.input.L1.current.status"] = {"warning-high"};
+    chained.update (chainVars);
+    assert (chained._alerts["input.L1.current"].status == "warning-high");
+    assert (chained._alerts["input.L1.current"].timestamp != 0);
     //  @end
     printf (" OK\n");
 }
@@ -54,8 +54,9 @@ class Device {
     int chain () const { return _chain; }
     int scanned () const { return _scanned; }
 
-    void update (nut::TcpClient &conn);
-    int scanCapabilities (nut::TcpClient &conn);
+    //! \brief update/scan from all variables of the NUT device, shared by the chain
+    void update (const std::map<std::string,std::vector<std::string> >& vars);
+    int scanCapabilities (const std::map<std::string,std::vector<std::string> >& vars);
     void publishAlerts (mlm_client_t *client, uint64_t ttl);
     void publishRules (mlm_client_t *client);
 
@@ -77,6 +78,7 @@ class Device {
     void publishAlert (mlm_client_t *client, DeviceAlert& alert, uint64_t ttl);
     void publishRule (mlm_client_t *client, DeviceAlert& alert);
     void fixAlertLimits (DeviceAlert& alert);
+    void updateStatus (const std::string& quantity, DeviceAlert& alert, const std::string& newStatus);
     std::string daisychainPrefix() const;
 };
 
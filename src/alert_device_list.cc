@@ -24,32 +24,76 @@
 
 #include "alert_device_list.h"
 #include "fty_nut_library.h"
+#include "nut_circuit_breaker.h"
+#include "nut_connection_pool.h"
+#include "nut_endpoints.h"
 #include "logger.h"
 
 void Devices::updateFromNUT ()
 {
-    try {
-        nut::TcpClient nutClient;
-        nutClient.connect ("localhost", 3493);
-        updateDeviceCapabilities (nutClient);
-        updateDevices (nutClient);
-        nutClient.disconnect();
-    } catch (std::exception& e) {
-        log_error ("reading data from NUT: %s", e.what ());
+    // every upsd is asked for its own devices
+    for (const auto& endpoint : drivers::nut::NUTEndpoints::instance ().inUse ()) {
+        auto nutClient = drivers::nut::NUTConnectionPool::instance ().acquire (endpoint.host, endpoint.port);
+        if (!nutClient) continue;
+        try {
+            updateDevices (*nutClient, endpoint);
+        } catch (nut::IOException& e) {
+            log_error ("reading data from NUT %s: %s", endpoint.toString ().c_str (), e.what ());
+            nutClient.reconnect ();
+        } catch (std::exception& e) {
+            log_error ("reading data from NUT %s: %s", endpoint.toString ().c_str (), e.what ());
+        }
     }
 }
 
-void Devices::updateDevices(nut::TcpClient& nutClient)
+void Devices::updateFromSnapshot (const drivers::nut::NUTSnapshot& snapshot)
 {
     for (auto& it : _devices) {
-        it.second.update (nutClient);
+        auto vars = snapshot.find (it.second.nutName ());
+        if (!vars) continue;
+        if (! it.second.scanned ()) it.second.scanCapabilities (*vars);
+        it.second.update (*vars);
     }
 }
 
-void Devices::updateDeviceCapabilities (nut::TcpClient& nutClient)
+void Devices::updateFromStatus (const drivers::nut::NUTSnapshot& snapshot)
 {
     for (auto& it : _devices) {
-        if (! it.second.scanned ()) it.second.scanCapabilities (nutClient);
+        if (! it.second.scanned ()) continue;
+        auto vars = snapshot.find (it.second.nutName ());
+        if (vars) it.second.update (*vars);
+    }
+}
+
+void Devices::updateDevices(nut::TcpClient& nutClient, const drivers::nut::NUTEndpoint& endpoint)
+{
+    // daisy chain members share one NUT device, read it once for all of them
+    auto& endpoints = drivers::nut::NUTEndpoints::instance ();
+    std::map <std::string, std::vector <Device *>> chains;
+    for (auto& it : _devices) {
+        if (endpoints.lookup (it.second.nutName ()) != endpoint) continue;
+        chains[it.second.nutName ()].push_back (&it.second);
+    }
+    auto& breaker = drivers::nut::NUTCircuitBreaker::instance ();
+    for (const auto& chain : chains) {
+        const std::string& nutName = chain.first;
+        if (! breaker.allow (nutName)) continue;
+        try {
+            auto nutDevice = nutClient.getDevice (nutName);
+            if (! nutDevice.isOk ()) { throw std::runtime_error ("device " + nutName + " is not configured in NUT yet"); }
+            auto vars = nutDevice.getVariableValues ();
+            breaker.success (nutName);
+            for (auto device : chain.second) {
+                if (! device->scanned ()) device->scanCapabilities (vars);
+                device->update (vars);
+            }
+        } catch (nut::IOException& e) {
+            // broken session, let the caller reconnect
+            throw;
+        } catch (std::exception& e) {
+            log_error ("aa: Communication problem with %s (%s)", nutName.c_str (), e.what ());
+            breaker.failure (nutName, e.what ());
+        }
     }
 }
 
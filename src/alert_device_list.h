@@ -24,10 +24,15 @@
 #include "fty_nut_library.h"
 #include "alert_device.h"
 #include "nut.h"
+#include "nut_snapshot.h"
+#include "nut_endpoints.h"
 
 class Devices {
  public:
     void updateFromNUT ();
+    void updateFromSnapshot (const drivers::nut::NUTSnapshot& snapshot);
+    // status lane carries no thresholds, only devices scanned already take it
+    void updateFromStatus (const drivers::nut::NUTSnapshot& snapshot);
     void updateDeviceList (nut_t *config);
     void publishAlerts (mlm_client_t *client);
     void publishRules (mlm_client_t *client);
@@ -41,8 +46,8 @@ class Devices {
     uint64_t _polling_ms = 30000;
     std::map <std::string, Device>  _devices;
 
-    void updateDeviceCapabilities (nut::TcpClient& nutClient);
-    void updateDevices (nut::TcpClient& nutClient);
+    // devices of endpoint only, scans capabilities of new devices as well
+    void updateDevices (nut::TcpClient& nutClient, const drivers::nut::NUTEndpoint& endpoint);
     void addIfNotPresent (Device dev);
 };
 
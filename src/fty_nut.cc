@@ -82,6 +82,16 @@ int main (int argc, char *argv [])
     std::string mapping_file;
     std::string state_file;
     const char* polling = NULL;
+    const char* workers = NULL;
+    const char* fetch_deadline = NULL;
+    const char* cycle_budget = NULL;
+    const char* selective_fetch = NULL;
+    const char* upsd_endpoints = NULL;
+    const char* status_interval = NULL;
+    const char* sampling_interval = NULL;
+    const char* demand_driven = NULL;
+    const char* driver_sockets = NULL;
+    const char* state_path = NULL;
     const char *config_file = "/etc/fty-nut/fty-nut.cfg";
     zconfig_t *config = NULL;
 
@@ -172,6 +182,24 @@ int main (int argc, char *argv [])
     }
     // POLLING
     polling = zconfig_get (config, "nut/polling_interval", "30");
+    // WORKERS
+    workers = zconfig_get (config, "nut/polling_workers", "4");
+    // DEADLINE
+    fetch_deadline = zconfig_get (config, "nut/fetch_deadline", "5");
+    cycle_budget = zconfig_get (config, "nut/cycle_budget", "15");
+    // SELECTIVE
+    selective_fetch = zconfig_get (config, "nut/selective_fetch", "false");
+    // STATUS
+    status_interval = zconfig_get (config, "nut/status_interval", "2");
+    // SAMPLING
+    sampling_interval = zconfig_get (config, "nut/sampling_interval", "500");
+    // DEMAND
+    demand_driven = zconfig_get (config, "nut/demand_driven", "false");
+    // ENDPOINTS
+    upsd_endpoints = zconfig_get (config, "nut/upsd_endpoints", "localhost:3493");
+    // DRIVERS
+    driver_sockets = zconfig_get (config, "nut/driver_sockets", "false");
+    state_path = zconfig_get (config, "nut/state_path", NUT_DRIVER_STATE_PATH);
 
     // log_level cascade (priority ascending)
     //  1. default value
@@ -218,6 +246,14 @@ int main (int argc, char *argv [])
     }
     zstr_sendx (nut_server, "CONFIGURE", mapping_file.c_str (), state_file.c_str (), NULL);
     zstr_sendx (nut_server, "POLLING", polling, NULL);
+    zstr_sendx (nut_server, "WORKERS", workers, NULL);
+    zstr_sendx (nut_server, "DEADLINE", fetch_deadline, cycle_budget, NULL);
+    zstr_sendx (nut_server, "SELECTIVE", selective_fetch, NULL);
+    zstr_sendx (nut_server, "STATUS", status_interval, NULL);
+    zstr_sendx (nut_server, "SAMPLING", sampling_interval, NULL);
+    zstr_sendx (nut_server, "DEMAND", demand_driven, NULL);
+    zstr_sendx (nut_server, "ENDPOINTS", upsd_endpoints, NULL);
+    zstr_sendx (nut_server, "DRIVERS", driver_sockets, state_path, NULL);
     zstr_sendx (nut_server, "CONNECT", ENDPOINT, ACTOR_NUT_NAME, NULL);
     zstr_sendx (nut_server, "PRODUCER", FTY_PROTO_STREAM_METRICS, NULL);
     zstr_sendx (nut_server, "CONSUMER", FTY_PROTO_STREAM_ASSETS, ".*", NULL);
@@ -67,6 +67,70 @@ typedef struct _ups_status_t ups_status_t;
 typedef struct _nut_device_t nut_device_t;
 #define NUT_DEVICE_T_DEFINED
 #endif
+#ifndef NUT_CONNECTION_POOL_T_DEFINED
+typedef struct _nut_connection_pool_t nut_connection_pool_t;
+#define NUT_CONNECTION_POOL_T_DEFINED
+#endif
+#ifndef NUT_POLLER_T_DEFINED
+typedef struct _nut_poller_t nut_poller_t;
+#define NUT_POLLER_T_DEFINED
+#endif
+#ifndef NUT_ASYNC_CLIENT_T_DEFINED
+typedef struct _nut_async_client_t nut_async_client_t;
+#define NUT_ASYNC_CLIENT_T_DEFINED
+#endif
+#ifndef NUT_SNAPSHOT_T_DEFINED
+typedef struct _nut_snapshot_t nut_snapshot_t;
+#define NUT_SNAPSHOT_T_DEFINED
+#endif
+#ifndef NUT_TIMER_WHEEL_T_DEFINED
+typedef struct _nut_timer_wheel_t nut_timer_wheel_t;
+#define NUT_TIMER_WHEEL_T_DEFINED
+#endif
+#ifndef NUT_CIRCUIT_BREAKER_T_DEFINED
+typedef struct _nut_circuit_breaker_t nut_circuit_breaker_t;
+#define NUT_CIRCUIT_BREAKER_T_DEFINED
+#endif
+#ifndef NUT_DRIVER_SOCKET_T_DEFINED
+typedef struct _nut_driver_socket_t nut_driver_socket_t;
+#define NUT_DRIVER_SOCKET_T_DEFINED
+#endif
+#ifndef NUT_ENDPOINTS_T_DEFINED
+typedef struct _nut_endpoints_t nut_endpoints_t;
+#define NUT_ENDPOINTS_T_DEFINED
+#endif
+#ifndef NUT_INTEREST_T_DEFINED
+typedef struct _nut_interest_t nut_interest_t;
+#define NUT_INTEREST_T_DEFINED
+#endif
+#ifndef NUT_SAMPLER_T_DEFINED
+typedef struct _nut_sampler_t nut_sampler_t;
+#define NUT_SAMPLER_T_DEFINED
+#endif
+#ifndef NUT_OVERLOAD_T_DEFINED
+typedef struct _nut_overload_t nut_overload_t;
+#define NUT_OVERLOAD_T_DEFINED
+#endif
+#ifndef NUT_QOS_T_DEFINED
+typedef struct _nut_qos_t nut_qos_t;
+#define NUT_QOS_T_DEFINED
+#endif
+#ifndef NUT_KEYS_T_DEFINED
+typedef struct _nut_keys_t nut_keys_t;
+#define NUT_KEYS_T_DEFINED
+#endif
+#ifndef NUT_MAPPING_T_DEFINED
+typedef struct _nut_mapping_t nut_mapping_t;
+#define NUT_MAPPING_T_DEFINED
+#endif
+#ifndef NUT_RULES_T_DEFINED
+typedef struct _nut_rules_t nut_rules_t;
+#define NUT_RULES_T_DEFINED
+#endif
+#ifndef NUT_OUTLET_TABLE_T_DEFINED
+typedef struct _nut_outlet_table_t nut_outlet_table_t;
+#define NUT_OUTLET_TABLE_T_DEFINED
+#endif
 #ifndef NUT_AGENT_T_DEFINED
 typedef struct _nut_agent_t nut_agent_t;
 #define NUT_AGENT_T_DEFINED
@@ -110,6 +174,22 @@ typedef struct _sensor_list_t sensor_list_t;
 #include "actor_commands.h"
 #include "ups_status.h"
 #include "nut_device.h"
+#include "nut_connection_pool.h"
+#include "nut_poller.h"
+#include "nut_async_client.h"
+#include "nut_snapshot.h"
+#include "nut_timer_wheel.h"
+#include "nut_circuit_breaker.h"
+#include "nut_driver_socket.h"
+#include "nut_endpoints.h"
+#include "nut_interest.h"
+#include "nut_sampler.h"
+#include "nut_overload.h"
+#include "nut_qos.h"
+#include "nut_keys.h"
+#include "nut_mapping.h"
+#include "nut_rules.h"
+#include "nut_outlet_table.h"
 #include "nut_agent.h"
 #include "nut_configurator.h"
 #include "alert_device.h"
@@ -162,6 +242,86 @@ FTY_NUT_PRIVATE void
 FTY_NUT_PRIVATE void
     nut_device_test (bool verbose);
 
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_connection_pool_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_poller_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_async_client_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_snapshot_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_timer_wheel_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_circuit_breaker_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_driver_socket_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_endpoints_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_interest_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_sampler_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_overload_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_qos_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_keys_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_mapping_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_rules_test (bool verbose);
+
+//  *** Draft method, defined for internal use only ***
+//  Self test of this class.
+FTY_NUT_PRIVATE void
+    nut_outlet_table_test (bool verbose);
+
 //  *** Draft method, defined for internal use only ***
 //  Self test of this class.
 FTY_NUT_PRIVATE void
@@ -46,6 +46,22 @@ fty_nut_private_selftest (bool verbose)
     actor_commands_test (verbose);
     ups_status_test (verbose);
     nut_device_test (verbose);
+    nut_connection_pool_test (verbose);
+    nut_poller_test (verbose);
+    nut_async_client_test (verbose);
+    nut_snapshot_test (verbose);
+    nut_timer_wheel_test (verbose);
+    nut_circuit_breaker_test (verbose);
+    nut_driver_socket_test (verbose);
+    nut_endpoints_test (verbose);
+    nut_interest_test (verbose);
+    nut_sampler_test (verbose);
+    nut_overload_test (verbose);
+    nut_qos_test (verbose);
+    nut_keys_test (verbose);
+    nut_mapping_test (verbose);
+    nut_rules_test (verbose);
+    nut_outlet_table_test (verbose);
     nut_agent_test (verbose);
     nut_configurator_test (verbose);
     alert_device_test (verbose);
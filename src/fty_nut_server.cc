@@ -38,6 +38,29 @@ s_handle_poll (NUTAgent& nut_agent, nut_t *data)
 {
     assert (data);
     nut_agent.onPoll (data);
+    // keep the pooled upsd sessions healthy until the next cycle
+    drivers::nut::NUTConnectionPool::instance ().keepalive ();
+}
+
+//  Keep zpoller watching the connected driver sockets, registered holds
+//  the handles added; sockets given up are removed before they close
+static void
+s_sync_drivers (zpoller_t *poller, NUTAgent& nut_agent, std::set <int *>& registered)
+{
+    assert (poller);
+
+    for (auto handle : nut_agent.retiredDriverHandles ()) {
+        if (registered.erase (handle)) {
+            zpoller_remove (poller, handle);
+        }
+    }
+    nut_agent.closeRetiredDrivers ();
+    for (auto handle : nut_agent.driverHandles ()) {
+        if (registered.count (handle)) continue;
+        if (zpoller_add (poller, handle) == 0) {
+            registered.insert (handle);
+        }
+    }
 }
 
 static void
@@ -51,15 +74,75 @@ s_handle_service (mlm_client_t *client, zmsg_t **message_p)
     zmsg_destroy (message_p);
 }
 
+//  Interest of consumers, subject INTEREST:
+//      ADD/metric/asset[/metric/asset...]      patterns to publish, renews the lease
+//      REMOVE/metric/asset[/metric/asset...]   patterns not needed anymore
+//      CLEAR                                   drop all patterns of sender
+//      LIST                                    patterns of sender
+//  replies OK[/metric/asset...] or ERROR/reason
 static void
-s_handle_mailbox (mlm_client_t *client, zmsg_t **message_p)
+s_handle_mailbox (mlm_client_t *client, NUTAgent& nut_agent, zmsg_t **message_p)
 {
-   assert (client);
-   assert (message_p && *message_p);
+    assert (client);
+    assert (message_p && *message_p);
 
-   log_error ("Mailbox command is not implemented.");
+    const char *sender = mlm_client_sender (client);
+    if (!streq (mlm_client_subject (client), NUT_INTEREST_SUBJECT)) {
+        log_warning ("mailbox subject '%s' from %s is not supported", mlm_client_subject (client), sender);
+        zmsg_destroy (message_p);
+        return;
+    }
 
-   zmsg_destroy (message_p);
+    auto& interest = nut_agent.interest ();
+    zmsg_t *reply = zmsg_new ();
+    char *command = zmsg_popstr (*message_p);
+    if (command && (streq (command, "ADD") || streq (command, "REMOVE"))) {
+        bool valid = zmsg_size (*message_p) > 0 && zmsg_size (*message_p) % 2 == 0;
+        while (valid && zmsg_size (*message_p) > 0) {
+            char *metric = zmsg_popstr (*message_p);
+            char *asset = zmsg_popstr (*message_p);
+            if (streq (command, "ADD")) {
+                valid = interest.add (sender, metric, asset);
+            }
+            else {
+                interest.remove (sender, metric, asset);
+            }
+            zstr_free (&metric);
+            zstr_free (&asset);
+        }
+        if (valid) {
+            zmsg_addstr (reply, "OK");
+        }
+        else {
+            zmsg_addstr (reply, "ERROR");
+            zmsg_addstr (reply, "expected metric/asset pairs");
+        }
+    }
+    else
+    if (command && streq (command, "CLEAR")) {
+        interest.clear (sender);
+        zmsg_addstr (reply, "OK");
+    }
+    else
+    if (command && streq (command, "LIST")) {
+        zmsg_addstr (reply, "OK");
+        for (const auto& pattern : interest.list (sender)) {
+            zmsg_addstr (reply, pattern.first.c_str ());
+            zmsg_addstr (reply, pattern.second.c_str ());
+        }
+    }
+    else {
+        log_warning ("interest command '%s' from %s is not supported", command ? command : "(null)", sender);
+        zmsg_addstr (reply, "ERROR");
+        zmsg_addstr (reply, "unknown command");
+    }
+    zstr_free (&command);
+
+    if (mlm_client_sendto (client, sender, NUT_INTEREST_SUBJECT, NULL, 1000, &reply) != 0) {
+        log_error ("reply to %s failed", sender);
+    }
+    zmsg_destroy (&reply);
+    zmsg_destroy (message_p);
 }
 
 static void
@@ -72,23 +155,6 @@ s_handle_stream (mlm_client_t *client, NUTAgent& nut_agent, nut_t *data, zmsg_t
     stream_deliver_handle (client, nut_agent, data, message_p);
 }
 
-uint64_t
-polling_timeout(uint64_t last_poll, uint64_t polling_timeout)
-{
-    static uint32_t too_short_poll_count = 0;
-
-    uint64_t now = static_cast<uint64_t> (zclock_mono ());
-    if (last_poll + polling_timeout < now) {
-        too_short_poll_count++;
-        if (too_short_poll_count > 10) {
-            log_error("Can't handle so many devices in so short polling interval");
-        }
-        return 0;
-    }
-    too_short_poll_count = 0;
-    return last_poll + polling_timeout - now;
-}
-
 void
 fty_nut_server (zsock_t *pipe, void *args)
 {
@@ -144,12 +210,19 @@ fty_nut_server (zsock_t *pipe, void *args)
 */
 
     nut_agent.setiClient (iclient);
+    drivers::nut::NUTSnapshotBus::instance ().open ();
 
-    uint64_t timestamp = static_cast<uint64_t> (zclock_mono ());
     uint64_t timeout = 30000;
+    std::set <int *> drivers;
 
     while (!zsys_interrupted) {
-        void *which = zpoller_wait (poller, polling_timeout (timestamp, timeout));
+        if (nut_agent.pollTimeout () == 0) {
+            // busy message pipe must not starve the devices
+            s_handle_poll (nut_agent, data);
+        }
+        s_sync_drivers (poller, nut_agent, drivers);
+        // devices are spread over the polling interval, wake up for the next one
+        void *which = zpoller_wait (poller, nut_agent.pollTimeout ());
         if (nut_changed (data)) {
             r = nut_save (data, state_file.c_str ());
             if (r != 0) {
@@ -162,7 +235,6 @@ fty_nut_server (zsock_t *pipe, void *args)
                 break;
             }
             if (zpoller_expired (poller)) {
-                timestamp = static_cast<uint64_t> (zclock_mono ());
                 s_handle_poll (nut_agent, data);
             }
             continue;
@@ -174,12 +246,17 @@ fty_nut_server (zsock_t *pipe, void *args)
                 log_error ("Given `which == pipe`, function `zmsg_recv (pipe)` returned NULL");
                 continue;
             }
-            if (actor_commands (client, &message, verbose, timeout, nut_agent, data, state_file) == 1) {
+            if (actor_commands (pipe, client, &message, verbose, timeout, nut_agent, data, state_file) == 1) {
                 break;
             }
             continue;
         }
 
+        if (drivers.count (static_cast <int *> (which))) {
+            nut_agent.onDriverEvent (data, static_cast <int *> (which));
+            continue;
+        }
+
         // paranoid non-destructive assertion of a twisted mind
         if (which != mlm_client_msgpipe (client)) {
             log_critical (
@@ -200,7 +277,7 @@ fty_nut_server (zsock_t *pipe, void *args)
         }
         else
         if (streq (command, "MAILBOX DELIVER")) {
-            s_handle_mailbox (client, &message);
+            s_handle_mailbox (client, nut_agent, &message);
         }
         else
         if (streq (command, "SERVICE DELIVER")) {
@@ -218,6 +295,7 @@ fty_nut_server (zsock_t *pipe, void *args)
             log_warning ("Could not save state file '%s'.", state_file.c_str ());
         }
     }
+    drivers::nut::NUTSnapshotBus::instance ().close ();
     nut_destroy (&data);
     zpoller_destroy (&poller);
     mlm_client_destroy (&client);
@@ -111,7 +111,10 @@ clear_ext (zhash_t *hash)
             !streq (zhash_cursor (hash), "parent_name.1") &&
             !streq (zhash_cursor (hash), "logical_asset") &&
             !streq (zhash_cursor (hash), "max_current") &&
-            !streq (zhash_cursor (hash), "max_power") )
+            !streq (zhash_cursor (hash), "max_power") &&
+            !streq (zhash_cursor (hash), "upsd") &&
+            !streq (zhash_cursor (hash), "sampling") &&
+            !streq (zhash_cursor (hash), "qos") )
         {
             zlistx_add_end (to_delete, (void *) zhash_cursor (hash));
         }
@@ -248,6 +251,21 @@ nut_put (nut_t *self, fty_proto_t **message_p)
             fty_proto_ext_insert (asset, "max_power", "%s", fty_proto_ext_string (message, "max_power",""));
         }
 
+        if (!nut_ext_value_is_the_same (asset, message, "upsd")) {
+            self->changed = true;
+            fty_proto_ext_insert (asset, "upsd", "%s", fty_proto_ext_string (message, "upsd",""));
+        }
+
+        if (!nut_ext_value_is_the_same (asset, message, "sampling")) {
+            self->changed = true;
+            fty_proto_ext_insert (asset, "sampling", "%s", fty_proto_ext_string (message, "sampling",""));
+        }
+
+        if (!nut_ext_value_is_the_same (asset, message, "qos")) {
+            self->changed = true;
+            fty_proto_ext_insert (asset, "qos", "%s", fty_proto_ext_string (message, "qos",""));
+        }
+
         fty_proto_destroy (message_p);
     }
     else
@@ -25,7 +25,9 @@
 @discuss
 @end
 */
+#include <algorithm>
 #include <cmath>
+#include <set>
 
 #include "fty_nut_classes.h"
 
@@ -44,6 +46,11 @@ const std::map<std::string, std::string> NUTAgent::_units =
     { "delay",       "s" },
 };
 
+NUTAgent::NUTAgent ()
+{
+    _deviceList.interest (&_interest);
+}
+
 bool NUTAgent::loadMapping (const char *path_to_file)
 {
     if ( !path_to_file )
@@ -76,16 +83,113 @@ bool NUTAgent::isClientSet () const
     return _client != NULL;
 }
 
+// most important QoS class first, order within a class is kept
+static void
+s_sort_by_qos (std::vector <drivers::nut::NUTDevice *>& devices)
+{
+    using drivers::nut::NUTQos;
+    std::stable_sort (devices.begin (), devices.end (),
+        [] (const drivers::nut::NUTDevice *a, const drivers::nut::NUTDevice *b) {
+            return NUTQos::schedule (a->qos ()).priority > NUTQos::schedule (b->qos ()).priority;
+        });
+}
+
 void NUTAgent::onPoll (nut_t *data)
 {
-    if (_client)
-        advertisePhysics (data);
+    std::vector <drivers::nut::NUTDevice *> devices;
+    _interest.expire ();
+    if (_client) {
+        // status lane goes first, a transfer to battery must not wait for the full read
+        // of this call; a full read in progress is not interrupted, it delays both lanes
+        auto changed = _deviceList.updateStatus ();
+        s_sort_by_qos (changed);
+        if (!changed.empty ())
+            advertisePhysics (data, changed, true);
+        _deviceList.updateSamples ();
+        devices = _deviceList.update (true);
+        // all measurements of a device go once in TTL/2 so none expires,
+        // the reads in between send what left its deadband and the windows
+        int64_t now = zclock_mono ();
+        std::vector <drivers::nut::NUTDevice *> refreshed;
+        for (auto device : devices) {
+            int64_t &timestamp = _physicsTimestamps_ms[device->assetName ()];
+            if (timestamp != 0 && now - timestamp < _ttl * 1000 / 2) continue;
+            timestamp = now;
+            refreshed.push_back (device);
+        }
+        std::set <drivers::nut::NUTDevice *> pending (refreshed.begin (), refreshed.end ());
+        std::vector <drivers::nut::NUTDevice *> updated;
+        for (auto device : _deviceList.changedDevices ()) {
+            if (pending.insert (device).second) updated.push_back (device);
+        }
+        for (auto device : devices) {
+            if (_deviceList.sampler ().configured (device->assetName ()) && pending.insert (device).second)
+                updated.push_back (device);
+        }
+        s_sort_by_qos (refreshed);
+        s_sort_by_qos (updated);
+        advertisePhysics (data, refreshed);
+        advertisePhysics (data, updated, true, true);
+        advertiseOverload ();
+    }
     if (_iclient)
-        advertiseInventory ();
+        advertiseInventory (devices);
+}
+
+void NUTAgent::onDriverEvent (nut_t *data, int *handle)
+{
+    auto devices = _deviceList.onDriverEvent (handle);
+    // inventory keeps its own pace, onPoll advertises it
+    if (_client && !devices.empty ())
+        advertisePhysics (data, devices, true);
 }
 
 void NUTAgent::updateDeviceList (nut_t *deviceState) {
     _deviceList.updateDeviceList (deviceState);
+    // an asset added again starts with all its measurements
+    for (auto it = _physicsTimestamps_ms.begin (); it != _physicsTimestamps_ms.end (); ) {
+        if (_deviceList.nutName (it->first).empty ()) it = _physicsTimestamps_ms.erase (it);
+        else ++it;
+    }
+}
+
+std::map <std::string, uint64_t> NUTAgent::stats () const
+{
+    auto connections = drivers::nut::NUTConnectionPool::instance ().stats ();
+    auto breaker = drivers::nut::NUTCircuitBreaker::instance ().stats ();
+    return {
+        { "devices", _deviceList.size () },
+        { "poll.workers", _deviceList.pollingWorkers () },
+        { "poll.polled", _deviceList.polledCount () },
+        { "poll.fetched", _deviceList.fetchCount () },
+        { "poll.deferred", _deviceList.deferredCount () },
+        { "poll.timeouts", _deviceList.timeoutCount () },
+        { "poll.skipped", _deviceList.skippedCount () },
+        { "poll.overruns", _deviceList.overrunCount () },
+        { "poll.learned", _deviceList.learnCount () },
+        { "poll.variables", _deviceList.variableCount () },
+        { "payload.hits", _deviceList.payloadHits () },
+        { "payload.misses", _deviceList.payloadMisses () },
+        { "rules.evaluated", _deviceList.mapping ().rules ().evaluations () },
+        { "rules.reused", _deviceList.mapping ().rules ().reuses () },
+        { "interest.consumers", _interest.consumers () },
+        { "interest.suppressed", _suppressed },
+        { "status.polls", _deviceList.statusPolls () },
+        { "status.changes", _deviceList.statusChanges () },
+        { "sampling.polls", _deviceList.samplePolls () },
+        { "sampling.samples", _deviceList.sampler ().samples () },
+        { "overload.level", static_cast <uint64_t> (_deviceList.overload ().level ()) },
+        { "overload.changes", _deviceList.overload ().changes () },
+        { "driver.connected", _deviceList.driverConnected () },
+        { "driver.events", _deviceList.driverEvents () },
+        { "upsd.connects", connections.connects },
+        { "upsd.reuses", connections.reuses },
+        { "upsd.failures", connections.failures },
+        { "upsd.endpoints", drivers::nut::NUTEndpoints::instance ().endpoints ().size () },
+        { "breaker.open", breaker.open },
+        { "breaker.opened", breaker.opened },
+        { "breaker.rejected", breaker.rejected },
+    };
 }
 
 int NUTAgent::send (const std::string& subject, zmsg_t **message_p)
@@ -134,196 +238,195 @@ std::string NUTAgent::physicalQuantityToUnits (const std::string& quantity) cons
     return it->second;
 }
 
-void NUTAgent::advertisePhysics (nut_t *data)
+void NUTAgent::advertisePhysics (nut_t *data, const std::vector <drivers::nut::NUTDevice *>& devices, bool onlyChanged, bool samples)
 {
-    _deviceList.update (true);
-    for (auto& device : _deviceList) {
+    auto &keys = drivers::nut::NUTKeys::instance ();
+    const auto &sampler = _deviceList.sampler ();
+    for (auto device : devices) {
         std::string subject;
-        auto measurements = device.second.physics (false); // take  NOT only changed
-        for (const auto& measurement : measurements) {
-            std::string type = physicalQuantityShortName (measurement.first);
+        // walked in place, publishing clears the changed flags only
+        const auto& measurements = device->physicsValues ();
+        // just the dirty ones when only changes go, and the sampled ones with them
+        std::vector <size_t> slots;
+        if (onlyChanged) {
+            slots = measurements.changedSlots ();
+            if (samples && sampler.configured (device->assetName ())) {
+                for (size_t i = 0; i < measurements.size (); ++i) {
+                    if (!measurements.changed (i) && sampler.sampled (device->assetName (), keys.name (measurements.key (i))))
+                        slots.push_back (i);
+                }
+            }
+        }
+        size_t count = onlyChanged ? slots.size () : measurements.size ();
+        for (size_t j = 0; j < count; ++j) {
+            size_t i = onlyChanged ? slots[j] : j;
+            const std::string& name = keys.name (measurements.key (i));
+            const std::string& value = measurements.value (i).value;
+            if (!_interest.wanted (name, device->assetName ())) {
+                // counted once per change, the device must not stay dirty for it
+                ++_suppressed;
+                device->setChanged (measurements.key (i), false);
+                continue;
+            }
+            std::string type = physicalQuantityShortName (name);
             std::string units = physicalQuantityToUnits (type);
 
+            // sampled metric brings the window since its last advertisement along
+            zhash_t *aux = NULL;
+            drivers::nut::NUTSampleWindow window;
+            if ((!onlyChanged || samples) && _deviceList.sampler ().take (device->assetName (), name, window)) {
+                aux = zhash_new ();
+                zhash_autofree (aux);
+                zhash_insert (aux, "samples", (void *) std::to_string (window.count).c_str ());
+                zhash_insert (aux, "min", (void *) std::to_string (window.min).c_str ());
+                zhash_insert (aux, "max", (void *) std::to_string (window.max).c_str ());
+                zhash_insert (aux, "avg", (void *) std::to_string (window.avg).c_str ());
+                zhash_insert (aux, "last", (void *) std::to_string (window.last).c_str ());
+            }
             zmsg_t *msg = fty_proto_encode_metric (
-                NULL,
+                aux,
                 time (NULL),
                 _ttl,
-                measurement.first.c_str (),
-                device.second.assetName ().c_str (),
-                measurement.second.c_str (),
+                name.c_str (),
+                device->assetName ().c_str (),
+                value.c_str (),
                 units.c_str ());
             if (msg) {
                 log_debug ("sending new measurement for element_src = '%s', type = '%s', value = '%s', units = '%s'",
-                           device.second.assetName ().c_str (),
-                           measurement.first.c_str (),
-                           measurement.second.c_str (),
+                           device->assetName ().c_str (),
+                           name.c_str (),
+                           value.c_str (),
                            units.c_str ());
 
-                subject = measurement.first + "@" + device.second.assetName ();
+                subject = name + "@" + device->assetName ();
                 int r = send(subject, &msg);
                 if( r != 0 )
                     log_error("failed to send measurement %s result %i", subject.c_str(), r);
                 zmsg_destroy (&msg);
-                device.second.setChanged (measurement.first, false);
+                device->setChanged (measurements.key (i), false);
             }
+            zhash_destroy (&aux);
         }
-        // 'load' computing
-        // BIOS-1185 start
-        // if it is epdu, that doesn't provide load.default,
-        // but it is still could be calculated (because input.current is known) then do this
-        const char *subtype = nut_asset_subtype (data, device.second.assetName().c_str() );
-        if (    (subtype && streq ("epdu", subtype))
-             && measurements.count ("load.default") == 0 )
-        {
-            if ( measurements.count ("load.input.L1") != 0 ) {
-                std::string value = measurements.at("load.input.L1");
-                zmsg_t *msg = fty_proto_encode_metric (
-                        NULL,
-                        time (NULL),
-                        _ttl,
-                        "load.default",
-                        device.second.assetName().c_str(),
-                        value.c_str (),
-                        "%");
-                if (msg) {
-                    log_debug ("sending new measurement for element_src = '%s', type = '%s', value = '%s', units = '%s'",
-                               device.second.assetName ().c_str (), "load.default", value.c_str (), "%");
-
-                    subject = "load.default@" + device.second.assetName();
-                    int r = send (subject, &msg);
-                    if( r != 0 )
-                        log_error("failed to send measurement %s result %i", subject.c_str(), r);
-                    zmsg_destroy (&msg);
-                }
-            }
-            else if ( measurements.count ("current.input.L1") != 0 ) // it is a mapped value!!!!!!!!!!!
-            {
-                // try to compute it
-                // 1. Determine the MAX value
-                double max_value = 0;
-                if ( measurements.count ("current.input.nominal") == 1 ) {
-                    try {
-                        max_value = std::stof (measurements.at("current.input.nominal"));
-                        log_debug ("load.default: max_value %lf from UPS", max_value);
-                    } catch (...) {}
-                } else {
-                    const char *max_current = nut_asset_max_current (data, device.second.assetName().c_str() );
-                    if ( max_current && !streq ("", max_current) ) {
-                        // ASSUMPTION: max_current at this point is always verified to be double
-                        max_value = std::stod (max_current);
-                        log_debug ("load.default: max_value %lf from user", max_value);
-                    }
-                }
-                // 2. if MAX value is known -> do work, otherwise skip
-                if ( max_value != 0 ) {
-                    double value = 0;
-                    try {
-                        value = stof (measurements.at("current.input.L1"));
-                    } catch (...) {};
-                    char buffer [50];
-                    // 3. compute a real value
-                    sprintf (buffer, "%lf", value*100/max_value); // because it is %!!!!
-                    // 4. form message
-                    zmsg_t *msg = fty_proto_encode_metric (
-                            NULL,
-                            time (NULL),
-                            _ttl,
-                            "load.default",
-                            device.second.assetName().c_str(),
-                            buffer,
-                            "%");
-                    // 5. send the messsage
-                    if (msg) {
-                        log_debug ("sending new measurement for element_src = '%s', type = '%s', value = '%s', units = '%s'",
-                                device.second.assetName ().c_str (), "load.default", buffer, "%");
-
-                        subject = "load.default@" + device.second.assetName();
-                        int r = send (subject, &msg);
-                        if( r != 0 )
-                            log_error("failed to send measurement %s result %i", subject.c_str(), r);
-                        zmsg_destroy (&msg);
-                    }
-                }
-            }
-        }
-
-        // BIOS-1185 end
         // send also status as bitmap
-        if (device.second.hasProperty ("status.ups")) {
-            std::string status_s = device.second.property ("status.ups");
+        if (device->hasProperty ("status.ups")) {
+            std::string status_s = device->property ("status.ups");
             uint16_t    status_i = upsstatus_to_int (status_s);
             zmsg_t *msg = fty_proto_encode_metric (
                 NULL,
                 time (NULL),
                 _ttl,
                 "status.ups",
-                device.second.assetName ().c_str (),
+                device->assetName ().c_str (),
                 std::to_string (status_i).c_str (),
                 "");
             if (msg) {
                 log_debug ("sending new status for element_src = '%s', value = '%s' (%s)",
-                           device.second.assetName().c_str (), std::to_string (status_i).c_str (), status_s.c_str ());
-                subject = "status@" + device.second.assetName ();
+                           device->assetName().c_str (), std::to_string (status_i).c_str (), status_s.c_str ());
+                subject = "status@" + device->assetName ();
                 int r = send (subject, &msg);
                 if( r != 0 )
                     log_error("failed to send measurement %s result %i", subject.c_str(), r);
                 zmsg_destroy (&msg);
-                device.second.setChanged ("status.ups", false);
+                device->setChanged ("status.ups", false);
             }
         }
         //MVY: send also epdu status as bitmap
-        for (int i = 1; i != 100; i++) {
+        // read from the outlet table, up to the first outlet without status
+        auto &outlets = device->outlets ();
+        size_t n = outlets.outlets (drivers::nut::NUTOutletColumn::STATUS);
+        if (onlyChanged && outlets.changed (drivers::nut::NUTOutletColumn::STATUS) == 0)
+            n = 0;
+        for (size_t i = 1; i <= n; i++) {
             std::string property = "status.outlet." + std::to_string (i);
-            // assumption, if outlet.10 does not exists, outlet.11 does not as well
-            if (!device.second.hasProperty (property))
-                break;
-            std::string status_s = device.second.property (property);
-            uint16_t    status_i = status_s == "on" ? 42 : 0;
+            // the table tells on from the rest, the text is NUT's own
+            std::string status_s = device->property (property);
+            uint16_t    status_i = outlets.value (drivers::nut::NUTOutletColumn::STATUS, i) == NUT_OUTLET_ON ? 42 : 0;
 
             zmsg_t *msg = fty_proto_encode_metric (
                 NULL,
                 time (NULL),
                 _ttl,
                 property.c_str (),
-                device.second.assetName ().c_str (),
+                device->assetName ().c_str (),
                 std::to_string (status_i).c_str (),
                 "");
             if (msg) {
                 log_debug ("sending new status for %s %s, value %i (%s)",
                            property.c_str (),
-                           device.second.assetName().c_str(),
+                           device->assetName().c_str(),
                            status_i,
-                           status_s.c_str());
-                subject = "status.outlet." + std::to_string (i) + "@" + device.second.assetName ();
+                           status_s.c_str ());
+                subject = property + "@" + device->assetName ();
                 int r = send (subject, &msg);
                 if( r != 0 )
                     log_error("failed to send measurement %s result %i", subject.c_str(), r);
                 zmsg_destroy (&msg);
-                device.second.setChanged (property, false);
+                device->setChanged (outlets.statusKey (i), false);
             }
         }
+        outlets.commit (drivers::nut::NUTOutletColumn::STATUS);
     }
 }
 
-void NUTAgent::advertiseInventory()
+void NUTAgent::advertiseOverload ()
 {
-    bool advertiseAll = false;
-    if (_inventoryTimestamp_ms + NUT_INVENTORY_REPEAT_AFTER_MS < static_cast<uint64_t> (zclock_mono ())) {
-        advertiseAll = true;
-        _inventoryTimestamp_ms = static_cast<uint64_t> (zclock_mono ());
+    auto level = _deviceList.overload ().level ();
+    int64_t now = zclock_mono ();
+    if (_overloadTimestamp_ms != 0 && level == _overloadAdvertised &&
+        now - _overloadTimestamp_ms < _ttl * 1000 / 2) return;
+
+    std::string value = std::to_string (static_cast <int> (level));
+    zmsg_t *msg = fty_proto_encode_metric (
+        NULL,
+        time (NULL),
+        _ttl,
+        NUT_OVERLOAD_METRIC,
+        _name.c_str (),
+        value.c_str (),
+        "");
+    if (msg) {
+        log_debug ("sending %s = %s (%s) of %s",
+                   NUT_OVERLOAD_METRIC, value.c_str (), drivers::nut::NUTOverload::name (level), _name.c_str ());
+        std::string subject = std::string (NUT_OVERLOAD_METRIC) + "@" + _name;
+        int r = send (subject, &msg);
+        if( r != 0 )
+            log_error("failed to send measurement %s result %i", subject.c_str(), r);
+        zmsg_destroy (&msg);
     }
-    for (auto& device : _deviceList) {
+    _overloadAdvertised = level;
+    _overloadTimestamp_ms = now;
+}
+
+void NUTAgent::advertiseInventory (const std::vector <drivers::nut::NUTDevice *>& devices)
+{
+    uint64_t now = static_cast<uint64_t> (zclock_mono ());
+    for (auto device : devices) {
+        // whole inventory is repeated per device, so it does not come in one burst
+        bool advertiseAll = false;
+        uint64_t& timestamp = _inventoryTimestamps_ms [device->assetName ()];
+        // overloaded polling defers the refresh, the first one is no refresh
+        bool deferred = _deviceList.overload ().level () >= drivers::nut::NUTOverloadLevel::INVENTORY;
+        if (timestamp == 0 || (!deferred && timestamp + NUT_INVENTORY_REPEAT_AFTER_MS < now)) {
+            advertiseAll = true;
+            timestamp = now;
+        }
         std::string log;
         zhash_t *inventory = zhash_new ();
         // !advertiseAll = advetise_Not_OnlyChanged
-        for (auto& item : device.second.inventory (!advertiseAll) ) {
-            if (item.first == "status.ups") {
+        const auto& items = device->inventoryValues ();
+        std::vector <size_t> slots;
+        if (!advertiseAll) slots = items.changedSlots ();
+        size_t count = advertiseAll ? items.size () : slots.size ();
+        for (size_t j = 0; j < count; ++j) {
+            size_t i = advertiseAll ? j : slots[j];
+            const std::string& name = drivers::nut::NUTKeys::instance ().name (items.key (i));
+            if (name == "status.ups") {
                 // this value is not advertised as inventory information
                 continue;
             }
-            zhash_insert (inventory, item.first.c_str (), (void *) item.second.c_str ()) ;
-            log += item.first + " = \"" + item.second + "\"; ";
-            device.second.setChanged (item.first, false);
+            zhash_insert (inventory, name.c_str (), (void *) items.value (i).value.c_str ()) ;
+            log += name + " = \"" + items.value (i).value + "\"; ";
+            device->setChanged (items.key (i), false);
         }
         if (zhash_size (inventory) == 0) {
             zhash_destroy (&inventory);
@@ -332,12 +435,12 @@ void NUTAgent::advertiseInventory()
 
         zmsg_t *message = fty_proto_encode_asset (
                 NULL,
-                device.second.assetName().c_str(),
+                device->assetName().c_str(),
                 "inventory",
                 inventory);
 
         if (message) {
-            std::string topic = "inventory@" + device.second.assetName();
+            std::string topic = "inventory@" + device->assetName();
             log_debug ("new inventory message '%s': %s", topic.c_str(), log.c_str());
             int r = isend (topic, &message);
             if( r != 0 )
@@ -357,6 +460,20 @@ nut_agent_test (bool verbose)
     printf (" * nut_agent: ");
 
     //  @selftest
+    // unwanted change is suppressed once, the device leaves the dirty list
+    NUTAgent agent;
+    assert (agent.loadMapping ("src/mapping.conf"));
+    agent._interest.enabled (true);
+    auto &list = agent._deviceList;
+    list["ups-1"] = drivers::nut::NUTDevice ("ups-1", "ups-1", 0);
+    assert (list["ups-1"].updateStatus ({ { "input.frequency", { "50" } } }, list.mapping ()));
+    list.markChanged (list["ups-1"]);
+    auto changed = list.changedDevices ();
+    assert (changed.size () == 1);
+    agent.advertisePhysics (NULL, changed, true);
+    assert (agent._suppressed == 1 && list.changedDevices ().empty ());
+    agent.advertisePhysics (NULL, list.changedDevices (), true);
+    assert (agent._suppressed == 1);
     //  @end
     printf ("OK\n");
 }
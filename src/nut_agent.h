@@ -23,27 +23,92 @@
 #define NUT_FTY_H_INCLUDED
 #include "nut.h"
 
+FTY_NUT_EXPORT void
+    nut_agent_test (bool verbose);
+
 #define NUT_INVENTORY_REPEAT_AFTER_MS      3600000
 
 class NUTAgent {
+    friend void ::nut_agent_test (bool verbose);
  public:
+    NUTAgent ();
+
     bool loadMapping (const char *path_to_file);
     bool isMappingLoaded () const;
 
     void setClient (mlm_client_t *client);
     void setiClient (mlm_client_t *client);
     bool isClientSet () const;
+    //! \brief name of the agent on malamute, element of its own metrics
+    void agentName (const std::string& name) { _name = name; };
 
+    //! \brief read and advertise devices whose phase came and status changes
     void onPoll (nut_t *data);
+    //! \brief [ms] until next onPoll () is needed
+    int pollTimeout () { return _deviceList.pollTimeout (); };
     void updateDeviceList (nut_t *state);
+    //! \brief NUT device name of asset, empty if not known
+    std::string nutName (const std::string& asset) const { return _deviceList.nutName (asset); };
 
     void TTL (int ttl) { _ttl = ttl; };
     int TTL () const { return _ttl; };
+
+    void pollingWorkers (size_t count) { _deviceList.pollingWorkers (count); };
+    size_t pollingWorkers () const { return _deviceList.pollingWorkers (); };
+
+    //! \brief base polling interval [ms], quiet devices are polled less often
+    void pollingInterval (int64_t interval) { _deviceList.pollingInterval (interval); };
+    int64_t pollingInterval () const { return _deviceList.pollingInterval (); };
+
+    //! \brief [ms] to wait for one device / to start the devices of one poll
+    void fetchDeadline (int64_t deadline) { _deviceList.fetchDeadline (deadline); };
+    int64_t fetchDeadline () const { return _deviceList.fetchDeadline (); };
+    void cycleBudget (int64_t budget) { _deviceList.cycleBudget (budget); };
+    int64_t cycleBudget () const { return _deviceList.cycleBudget (); };
+
+    //! \brief [ms] between reads of status variables, 0 turns the status lane off
+    void statusInterval (int64_t interval) { _deviceList.statusInterval (interval); };
+    int64_t statusInterval () const { return _deviceList.statusInterval (); };
+
+    //! \brief [ms] between samples of metrics selected by asset attribute, 0 turns sampling off
+    void samplingInterval (int64_t interval) { _deviceList.samplingInterval (interval); };
+    int64_t samplingInterval () const { return _deviceList.samplingInterval (); };
+
+    //! \brief fetch just the variables the device needs, see NUTDeviceList
+    void selectiveFetch (bool enabled) { _deviceList.selectiveFetch (enabled); };
+    bool selectiveFetch () const { return _deviceList.selectiveFetch (); };
+
+    //! \brief read variables from NUT driver sockets in stateDir, see NUTDeviceList
+    void driverSockets (bool enabled, const std::string& stateDir) { _deviceList.driverSockets (enabled, stateDir); };
+    bool driverSockets () const { return _deviceList.driverSockets (); };
+    //! \brief connected driver sockets, to be watched by zpoller
+    std::vector <int *> driverHandles () { return _deviceList.driverHandles (); };
+    //! \brief driver sockets to take out of zpoller before closeRetiredDrivers ()
+    std::vector <int *> retiredDriverHandles () { return _deviceList.retiredDriverHandles (); };
+    void closeRetiredDrivers () { _deviceList.closeRetiredDrivers (); };
+    //! \brief read driver socket handle and advertise what changed
+    void onDriverEvent (nut_t *data, int *handle);
+
+    //! \brief metrics consumers registered, just those and the core set are
+    //!        published when enabled
+    drivers::nut::NUTInterest& interest () { return _interest; };
+
+    //! \brief degradation level of polling, see NUTOverload
+    drivers::nut::NUTOverloadLevel overloadLevel () const { return _deviceList.overload ().level (); };
+
+    //! \brief counters reported by STATS actor command
+    std::map <std::string, uint64_t> stats () const;
  protected:
     std::string physicalQuantityShortName (const std::string& longName) const;
     std::string physicalQuantityToUnits (const std::string& quantity) const;
-    void advertisePhysics (nut_t *data);
-    void advertiseInventory ();
+    //! \brief onlyChanged sends just the measurements changed since last advertisement,
+    //!        otherwise or with samples sampled metrics carry min/max/avg/last/samples
+    //!        of their window in aux (with onlyChanged even if they did not change)
+    void advertisePhysics (nut_t *data, const std::vector <drivers::nut::NUTDevice *>& devices,
+                           bool onlyChanged = false, bool samples = false);
+    void advertiseInventory (const std::vector <drivers::nut::NUTDevice *>& devices);
+    //! \brief publish NUT_OVERLOAD_METRIC of the agent when it changes and before it expires
+    void advertiseOverload ();
     int send (const std::string& subject, zmsg_t **message_p);
     int isend (const std::string& subject, zmsg_t **message_p);
 
@@ -51,11 +116,19 @@ class NUTAgent {
     uint64_t _lastUpdate = 0;
 
     drivers::nut::NUTDeviceList _deviceList;
-    uint64_t _inventoryTimestamp_ms = 0; // [ms] it is not an actual timestamp, it is just a reference point in time, when inventory was advertised
+    drivers::nut::NUTInterest _interest;
+    uint64_t _suppressed = 0;  //!< measurements nobody wanted
+    drivers::nut::NUTOverloadLevel _overloadAdvertised = drivers::nut::NUTOverloadLevel::NONE;
+    int64_t _overloadTimestamp_ms = 0;  //!< [ms] zclock_mono of last advertisement, 0 if none
+    //! \brief asset name | [ms] zclock_mono of its last advertisement of all measurements,
+    //!        the full reads in between advertise changes only
+    std::map <std::string, int64_t> _physicsTimestamps_ms;
+    std::map <std::string, uint64_t> _inventoryTimestamps_ms; // asset name | [ms] it is not an actual timestamp, it is just a reference point in time, when whole inventory was advertised
 
     static const std::map <std::string, std::string> _units;
 
     std::string _conf;
+    std::string _name = "fty-nut";
     mlm_client_t *_client = NULL;
     mlm_client_t *_iclient = NULL;
 };
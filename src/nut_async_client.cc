@@ -0,0 +1,454 @@
+/*  =========================================================================
+    nut_async_client - asynchronous pipelined client of NUT daemon
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_async_client - asynchronous pipelined client of NUT daemon
+@discuss
+    upsd answers the requests of one session strictly in order, so the
+    client only keeps a FIFO of callbacks. Replies look like
+
+        VAR <ups> <var> "<value>"               (GET VAR)
+        BEGIN LIST VAR <ups>                    (LIST VAR)
+        VAR <ups> <var> "<value>"
+        ...
+        END LIST VAR <ups>
+        ERR <error>                             (any request)
+
+    Values are quoted, with \" and \\ escaped.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTAsyncClient::NUTAsyncClient (const std::string& host, int port) :
+    _host (host),
+    _port (port)
+{
+}
+
+NUTAsyncClient::~NUTAsyncClient ()
+{
+    // owners of the callbacks may be gone already, do not call them
+    if (_fd >= 0) {
+        ::close (_fd);
+    }
+}
+
+bool NUTAsyncClient::connect (int timeout)
+{
+    if (_fd >= 0) return true;
+
+    struct addrinfo hints;
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result = NULL;
+    std::string port = std::to_string (_port);
+    int rv = getaddrinfo (_host.c_str (), port.c_str (), &hints, &result);
+    if (rv != 0) {
+        log_error ("can't resolve upsd host %s (%s)", _host.c_str (), gai_strerror (rv));
+        return false;
+    }
+    for (struct addrinfo *ai = result; ai && _fd < 0; ai = ai->ai_next) {
+        int fd = socket (ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect (fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            if (errno != EINPROGRESS) {
+                ::close (fd);
+                continue;
+            }
+            struct pollfd item = { fd, POLLOUT, 0 };
+            int error = ETIMEDOUT;
+            socklen_t length = sizeof (error);
+            if (poll (&item, 1, timeout) == 1) {
+                getsockopt (fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            }
+            if (error != 0) {
+                ::close (fd);
+                continue;
+            }
+        }
+        _fd = fd;
+    }
+    freeaddrinfo (result);
+    if (_fd < 0) {
+        log_error ("connect to upsd %s:%i failed", _host.c_str (), _port);
+        return false;
+    }
+    log_debug ("asynchronous session to upsd %s:%i opened", _host.c_str (), _port);
+    return true;
+}
+
+void NUTAsyncClient::disconnect ()
+{
+    if (_fd >= 0) {
+        ::close (_fd);
+        _fd = -1;
+    }
+    _output.clear ();
+    _input.clear ();
+    failAll ("connection lost");
+}
+
+void NUTAsyncClient::listVar (const std::string& device, NUTAsyncCallback callback)
+{
+    _requests.push_back (Request { LIST_VAR, device, std::move (callback) });
+    send ("LIST VAR " + device + "\n");
+}
+
+void NUTAsyncClient::getVar (const std::string& device, const std::string& variable, NUTAsyncCallback callback)
+{
+    _requests.push_back (Request { GET_VAR, device, std::move (callback) });
+    send ("GET VAR " + device + " " + variable + "\n");
+}
+
+void NUTAsyncClient::send (const std::string& line)
+{
+    if (_fd < 0) {
+        failAll ("not connected");
+        return;
+    }
+    _output.append (line);
+    flush ();
+}
+
+bool NUTAsyncClient::flush ()
+{
+    while (_fd >= 0 && !_output.empty ()) {
+        ssize_t n = ::send (_fd, _output.data (), _output.size (), MSG_NOSIGNAL);
+        if (n > 0) {
+            _output.erase (0, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        log_error ("write to upsd %s:%i failed (%s)", _host.c_str (), _port, strerror (errno));
+        disconnect ();
+        return false;
+    }
+    return _fd >= 0;
+}
+
+bool NUTAsyncClient::receive ()
+{
+    if (!flush ()) return false;
+
+    char buffer [4096];
+    while (true) {
+        ssize_t n = ::recv (_fd, buffer, sizeof (buffer), 0);
+        if (n == 0) {
+            log_warning ("upsd %s:%i closed the session", _host.c_str (), _port);
+            disconnect ();
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            log_error ("read from upsd %s:%i failed (%s)", _host.c_str (), _port, strerror (errno));
+            disconnect ();
+            return false;
+        }
+
+        // complete lines are parsed in place, only the tail is kept
+        const char *data = buffer;
+        const char *end = buffer + n;
+        while (data < end) {
+            const char *eol = static_cast <const char *> (memchr (data, '\n', end - data));
+            if (!eol) {
+                _input.append (data, end - data);
+                break;
+            }
+            const char *line = data;
+            size_t length = eol - data;
+            if (!_input.empty ()) {
+                _input.append (data, length);
+                line = _input.data ();
+                length = _input.size ();
+            }
+            if (length > 0 && line [length - 1] == '\r') --length;
+            dispatch (line, length);
+            _input.clear ();
+            // callback may have closed the session
+            if (_fd < 0) return false;
+            data = eol + 1;
+        }
+    }
+}
+
+bool NUTAsyncClient::wait (int timeout)
+{
+    int64_t deadline = zclock_mono () + timeout;
+    while (!_requests.empty ()) {
+        if (_fd < 0) return false;
+        int64_t remaining = deadline - zclock_mono ();
+        if (remaining <= 0) return false;
+        struct pollfd item = { _fd, POLLIN, 0 };
+        if (!_output.empty ()) item.events |= POLLOUT;
+        int rv = poll (&item, 1, remaining);
+        if (rv < 0 && errno == EINTR) continue;
+        if (rv <= 0) return false;
+        if (!receive ()) return false;
+    }
+    return true;
+}
+
+bool NUTAsyncClient::tokenize (const char *line, size_t length, std::vector <std::string>& words)
+{
+    words.clear ();
+    const char *end = line + length;
+    while (line < end) {
+        if (*line == ' ' || *line == '\t') {
+            ++line;
+            continue;
+        }
+        words.emplace_back ();
+        std::string& word = words.back ();
+        if (*line != '"') {
+            const char *start = line;
+            while (line < end && *line != ' ' && *line != '\t') ++line;
+            word.assign (start, line - start);
+            continue;
+        }
+        ++line;
+        bool closed = false;
+        while (line < end) {
+            if (*line == '\\' && line + 1 < end) {
+                word.push_back (line [1]);
+                line += 2;
+                continue;
+            }
+            if (*line == '"') {
+                ++line;
+                closed = true;
+                break;
+            }
+            word.push_back (*line++);
+        }
+        if (!closed) return false;
+    }
+    return true;
+}
+
+void NUTAsyncClient::dispatch (const char *line, size_t length)
+{
+    if (_requests.empty ()) {
+        log_warning ("unexpected line from upsd %s:%i: %.*s", _host.c_str (), _port, (int) length, line);
+        return;
+    }
+    const Request& request = _requests.front ();
+    if (!tokenize (line, length, _words) || _words.empty ()) {
+        log_warning ("malformed line from upsd %s:%i: %.*s", _host.c_str (), _port, (int) length, line);
+        if (request.type == GET_VAR || !_listStarted) {
+            _reply.error = "malformed reply";
+            complete ();
+        }
+        return;
+    }
+    if (_words [0] == "ERR") {
+        _reply.error = _words.size () > 1 ? _words [1] : "UNKNOWN-ERROR";
+        complete ();
+        return;
+    }
+    bool isVar = _words.size () >= 4 && _words [0] == "VAR";
+    switch (request.type) {
+        case GET_VAR:
+            if (isVar) {
+                _reply.ok = true;
+                _reply.vars.emplace_back (std::move (_words [2]), std::move (_words [3]));
+            }
+            else {
+                _reply.error = "unexpected reply";
+            }
+            complete ();
+            break;
+        case LIST_VAR:
+            if (!_listStarted) {
+                if (_words [0] == "BEGIN") {
+                    _listStarted = true;
+                }
+                else {
+                    _reply.error = "unexpected reply";
+                    complete ();
+                }
+            }
+            else if (isVar) {
+                _reply.vars.emplace_back (std::move (_words [2]), std::move (_words [3]));
+            }
+            else if (_words [0] == "END") {
+                _reply.ok = true;
+                complete ();
+            }
+            break;
+    }
+}
+
+void NUTAsyncClient::complete ()
+{
+    Request request = std::move (_requests.front ());
+    _requests.pop_front ();
+    _listStarted = false;
+    _reply.device = std::move (request.device);
+    if (request.callback) {
+        request.callback (_reply);
+    }
+    _reply.ok = false;
+    _reply.error.clear ();
+    _reply.vars.clear ();
+}
+
+void NUTAsyncClient::failAll (const char *error)
+{
+    std::deque <Request> requests;
+    requests.swap (_requests);
+    _listStarted = false;
+    NUTAsyncReply reply;
+    reply.error = error;
+    for (auto& request : requests) {
+        reply.device = request.device;
+        if (request.callback) {
+            request.callback (reply);
+        }
+    }
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static void
+s_write (int fd, const char *data)
+{
+    size_t length = strlen (data);
+    assert (write (fd, data, length) == (ssize_t) length);
+}
+
+void
+nut_async_client_test (bool verbose)
+{
+    printf (" * nut_async_client: ");
+
+    //  @selftest
+    using drivers::nut::NUTAsyncClient;
+    using drivers::nut::NUTAsyncReply;
+
+    std::vector <std::string> words;
+    const char *line = "VAR ups ups.mfr \"Ea\\\"ton \\\\ x\"";
+    assert (NUTAsyncClient::tokenize (line, strlen (line), words));
+    assert (words.size () == 4);
+    assert (words [2] == "ups.mfr");
+    assert (words [3] == "Ea\"ton \\ x");
+    line = "VAR ups x \"unterminated";
+    assert (!NUTAsyncClient::tokenize (line, strlen (line), words));
+
+    // fake upsd on a random local port
+    int server = socket (AF_INET, SOCK_STREAM, 0);
+    assert (server >= 0);
+    struct sockaddr_in address;
+    memset (&address, 0, sizeof (address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    socklen_t length = sizeof (address);
+    assert (bind (server, (struct sockaddr *) &address, length) == 0);
+    assert (listen (server, 1) == 0);
+    assert (getsockname (server, (struct sockaddr *) &address, &length) == 0);
+
+    NUTAsyncClient client ("127.0.0.1", ntohs (address.sin_port));
+    assert (client.connect ());
+    int session = accept (server, NULL, NULL);
+    assert (session >= 0);
+
+    // three requests in flight at once
+    std::vector <std::string> answers;
+    client.listVar ("ups", [&answers] (const NUTAsyncReply& reply) {
+        assert (reply.ok);
+        assert (reply.device == "ups");
+        assert (reply.vars.size () == 2);
+        assert (reply.vars [1].first == "ups.status");
+        answers.push_back (reply.vars [1].second);
+    });
+    client.getVar ("ups", "ups.load", [&answers] (const NUTAsyncReply& reply) {
+        assert (reply.ok);
+        answers.push_back (reply.vars [0].second);
+    });
+    client.getVar ("ups", "ups.nothing", [&answers] (const NUTAsyncReply& reply) {
+        assert (!reply.ok);
+        answers.push_back (reply.error);
+    });
+    assert (client.pending () == 3);
+
+    const char *requests = "LIST VAR ups\nGET VAR ups ups.load\nGET VAR ups ups.nothing\n";
+    char buffer [256];
+    ssize_t n = 0;
+    while (n < (ssize_t) strlen (requests)) {
+        ssize_t rv = read (session, buffer + n, sizeof (buffer) - n);
+        assert (rv > 0);
+        n += rv;
+    }
+    buffer [n] = 0;
+    assert (streq (buffer, requests));
+
+    // replies split in the middle of lines
+    s_write (session, "BEGIN LIST VAR ups\nVAR ups ups.mfr \"EATON\"\nVAR ups ups.st");
+    assert (!client.wait (100));
+    assert (answers.empty ());
+    s_write (session, "atus \"OL CHRG\"\nEND LIST VAR ups\nVAR ups ups.load \"42\"\r\nERR VAR-NOT");
+    s_write (session, "-SUPPORTED\n");
+    assert (client.wait (1000));
+    assert (answers.size () == 3);
+    assert (answers [0] == "OL CHRG");
+    assert (answers [1] == "42");
+    assert (answers [2] == "VAR-NOT-SUPPORTED");
+
+    // lost session fails what is pending
+    answers.clear ();
+    client.getVar ("ups", "ups.load", [&answers] (const NUTAsyncReply& reply) {
+        assert (!reply.ok);
+        answers.push_back (reply.error);
+    });
+    close (session);
+    assert (!client.wait (1000));
+    assert (!client.isConnected ());
+    assert (client.pending () == 0);
+    assert (answers.size () == 1 && answers [0] == "connection lost");
+
+    close (server);
+    //  @end
+    printf ("OK\n");
+}
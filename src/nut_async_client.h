@@ -0,0 +1,144 @@
+/*  =========================================================================
+    nut_async_client - asynchronous pipelined client of NUT daemon
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_ASYNC_CLIENT_H_INCLUDED
+#define NUT_ASYNC_CLIENT_H_INCLUDED
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define NUT_ASYNC_CONNECT_TIMEOUT_MS    1000    //!< connect () gives up after this
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief answer of upsd to one request
+struct NUTAsyncReply {
+    bool ok = false;
+    std::string error;      //!< upsd error (e.g. VAR-NOT-SUPPORTED) or "connection lost"
+    std::string device;
+    //! name, value; one entry for GET VAR, all variables for LIST VAR
+    std::vector <std::pair <std::string, std::string>> vars;
+};
+
+typedef std::function <void (const NUTAsyncReply&)> NUTAsyncCallback;
+
+/**
+ * \brief Nonblocking client of the upsd text protocol.
+ *
+ * Requests are written to the socket immediately and answered in order,
+ * so any number of LIST VAR / GET VAR can be in flight on one session.
+ * Replies are parsed straight from the receive buffer and handed to the
+ * callback of the request; the reply object is reused between callbacks.
+ *
+ * The session plugs into a zpoller loop:
+ *
+ *    NUTAsyncClient client;
+ *    client.connect ();
+ *    zpoller_add (poller, client.handle ());
+ *    client.getVar ("ups", "ups.status", [] (const NUTAsyncReply& reply) { ... });
+ *    ...
+ *    if (which == client.handle ()) client.receive ();
+ *
+ * or wait () can be used to block until everything is answered.
+ */
+class NUTAsyncClient {
+ public:
+    explicit NUTAsyncClient (const std::string& host = "localhost", int port = 3493);
+    NUTAsyncClient (const NUTAsyncClient&) = delete;
+    NUTAsyncClient& operator= (const NUTAsyncClient&) = delete;
+    ~NUTAsyncClient ();
+
+    //! \brief open the session, returns true when connected
+    bool connect (int timeout = NUT_ASYNC_CONNECT_TIMEOUT_MS);
+    //! \brief close the session, pending requests fail with "connection lost"
+    void disconnect ();
+    bool isConnected () const { return _fd >= 0; }
+
+    //! \brief file descriptor for zpoller_add (), stable for the object lifetime
+    int *handle () { return &_fd; }
+
+    //! \brief queue LIST VAR device
+    void listVar (const std::string& device, NUTAsyncCallback callback);
+    //! \brief queue GET VAR device variable
+    void getVar (const std::string& device, const std::string& variable, NUTAsyncCallback callback);
+
+    /**
+     * \brief Read what is available on the socket and dispatch complete replies.
+     * \return false if the session was lost (it is closed then)
+     */
+    bool receive ();
+
+    //! \brief write requests the socket did not accept yet
+    bool flush ();
+
+    /**
+     * \brief Block until all pending requests are answered.
+     * \return true if nothing is pending anymore, false on timeout or lost session
+     */
+    bool wait (int timeout);
+
+    //! \brief number of requests waiting for reply
+    size_t pending () const { return _requests.size (); }
+
+    //! \brief parse one line of upsd protocol into words, unquoting values
+    static bool tokenize (const char *line, size_t length, std::vector <std::string>& words);
+
+ private:
+    enum RequestType { LIST_VAR, GET_VAR };
+    struct Request {
+        RequestType type;
+        std::string device;
+        NUTAsyncCallback callback;
+    };
+
+    void send (const std::string& line);
+    //! \brief process one complete line of input
+    void dispatch (const char *line, size_t length);
+    void complete ();
+    void failAll (const char *error);
+
+    std::string _host;
+    int _port;
+    int _fd = -1;
+
+    std::string _output;                //!< requests not written yet
+    std::string _input;                 //!< incomplete reply line
+    std::deque <Request> _requests;     //!< in flight, in order of sending
+    bool _listStarted = false;          //!< BEGIN LIST seen for front request
+    NUTAsyncReply _reply;               //!< reused for every answer
+    std::vector <std::string> _words;   //!< reused tokenizer output
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_async_client_test (bool verbose);
+//  @end
+
+#endif
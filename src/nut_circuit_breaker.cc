@@ -0,0 +1,209 @@
+/*  =========================================================================
+    nut_circuit_breaker - circuit breaker for unreachable NUT devices
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_circuit_breaker - circuit breaker for unreachable NUT devices
+@discuss
+    Devices without failures have no entry at all, so the common case is
+    one map lookup under the mutex. Opening a circuit is logged once as a
+    warning, the failures while it is open are silent.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTCircuitBreaker::NUTCircuitBreaker (unsigned threshold, int64_t backoffMin, int64_t backoffMax) :
+    _threshold (std::max (1u, threshold)),
+    _backoffMin (backoffMin),
+    _backoffMax (std::max (backoffMin, backoffMax))
+{
+}
+
+NUTCircuitBreaker& NUTCircuitBreaker::instance ()
+{
+    static NUTCircuitBreaker breaker;
+    return breaker;
+}
+
+bool NUTCircuitBreaker::allow (const std::string& name, int64_t now)
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto it = _circuits.find (name);
+    if (it == _circuits.end () || it->second.state == NUTCircuitState::CLOSED) return true;
+
+    Circuit& circuit = it->second;
+    if (now < 0) now = zclock_mono ();
+    if (now < circuit.nextProbe) {
+        ++_rejected;
+        return false;
+    }
+    // this caller is the probe, the rest waits for it
+    log_debug ("probing %s after %" PRIi64 " ms", name.c_str (), circuit.backoff);
+    circuit.state = NUTCircuitState::HALF_OPEN;
+    circuit.nextProbe = now + circuit.backoff;
+    return true;
+}
+
+void NUTCircuitBreaker::success (const std::string& name)
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto it = _circuits.find (name);
+    if (it == _circuits.end ()) return;
+    if (it->second.state != NUTCircuitState::CLOSED) {
+        log_info ("%s answers again", name.c_str ());
+    }
+    _circuits.erase (it);
+}
+
+void NUTCircuitBreaker::failure (const std::string& name, const std::string& reason, int64_t now)
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    if (now < 0) now = zclock_mono ();
+    Circuit& circuit = _circuits[name];
+    switch (circuit.state) {
+    case NUTCircuitState::CLOSED:
+        if (++circuit.failures < _threshold) return;
+        circuit.backoff = _backoffMin;
+        ++_opened;
+        log_warning ("%s failed %u times (%s), asking it again in %" PRIi64 " s",
+                     name.c_str (), circuit.failures, reason.c_str (), circuit.backoff / 1000);
+        break;
+    case NUTCircuitState::HALF_OPEN:
+        circuit.backoff = std::min (circuit.backoff * 2, _backoffMax);
+        log_debug ("probe of %s failed (%s), next in %" PRIi64 " s",
+                   name.c_str (), reason.c_str (), circuit.backoff / 1000);
+        break;
+    case NUTCircuitState::OPEN:
+        // late report of a request sent before the circuit opened
+        return;
+    }
+    circuit.state = NUTCircuitState::OPEN;
+    circuit.nextProbe = now + circuit.backoff;
+}
+
+void NUTCircuitBreaker::reset (const std::string& name)
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    _circuits.erase (name);
+}
+
+NUTCircuitState NUTCircuitBreaker::state (const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto it = _circuits.find (name);
+    return it == _circuits.end () ? NUTCircuitState::CLOSED : it->second.state;
+}
+
+NUTCircuitStats NUTCircuitBreaker::stats () const
+{
+    uint64_t open = 0;
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        for (const auto& it : _circuits) {
+            if (it.second.state != NUTCircuitState::CLOSED) ++open;
+        }
+    }
+    return NUTCircuitStats { open, _opened.load (), _rejected.load () };
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_circuit_breaker_test (bool verbose)
+{
+    printf (" * nut_circuit_breaker: ");
+
+    //  @selftest
+    using namespace drivers::nut;
+
+    NUTCircuitBreaker breaker (3, 1000, 4000);
+    int64_t now = 1000000;
+    assert (breaker.allow ("ups", now));
+    assert (breaker.state ("ups") == NUTCircuitState::CLOSED);
+
+    // a success in between starts the count again
+    breaker.failure ("ups", "driver not connected", now);
+    breaker.failure ("ups", "driver not connected", now);
+    breaker.success ("ups");
+    breaker.failure ("ups", "driver not connected", now);
+    breaker.failure ("ups", "driver not connected", now);
+    assert (breaker.state ("ups") == NUTCircuitState::CLOSED);
+    assert (breaker.allow ("ups", now));
+
+    // third failure in a row opens
+    breaker.failure ("ups", "driver not connected", now);
+    assert (breaker.state ("ups") == NUTCircuitState::OPEN);
+    assert (!breaker.allow ("ups", now + 999));
+    assert (breaker.allow ("epdu", now));
+
+    // one probe after backoff, others wait for it
+    assert (breaker.allow ("ups", now + 1000));
+    assert (breaker.state ("ups") == NUTCircuitState::HALF_OPEN);
+    assert (!breaker.allow ("ups", now + 1000));
+
+    // failed probes double the backoff up to the maximum
+    now += 1000;
+    breaker.failure ("ups", "driver not connected", now);
+    assert (breaker.state ("ups") == NUTCircuitState::OPEN);
+    assert (!breaker.allow ("ups", now + 1999));
+    assert (breaker.allow ("ups", now + 2000));
+    now += 2000;
+    breaker.failure ("ups", "driver not connected", now);
+    assert (breaker.allow ("ups", now + 4000));
+    now += 4000;
+    breaker.failure ("ups", "driver not connected", now);
+    assert (!breaker.allow ("ups", now + 3999));
+    assert (breaker.allow ("ups", now + 4000));
+
+    // probe never reported is given up after the backoff
+    now += 4000;
+    assert (!breaker.allow ("ups", now + 3999));
+    assert (breaker.allow ("ups", now + 4000));
+
+    NUTCircuitStats stats = breaker.stats ();
+    assert (stats.open == 1);
+    assert (stats.opened == 1);
+    assert (stats.rejected == 5);
+
+    // successful probe closes
+    breaker.success ("ups");
+    assert (breaker.state ("ups") == NUTCircuitState::CLOSED);
+    assert (breaker.allow ("ups", now));
+
+    // asset update resets
+    for (int i = 0; i < 3; ++i) breaker.failure ("sts", "unknown ups", now);
+    assert (!breaker.allow ("sts", now));
+    breaker.reset ("sts");
+    assert (breaker.allow ("sts", now));
+    assert (breaker.stats ().open == 0);
+    //  @end
+    printf ("OK\n");
+}
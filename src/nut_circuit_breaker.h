@@ -0,0 +1,125 @@
+/*  =========================================================================
+    nut_circuit_breaker - circuit breaker for unreachable NUT devices
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_CIRCUIT_BREAKER_H_INCLUDED
+#define NUT_CIRCUIT_BREAKER_H_INCLUDED
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+#define NUT_BREAKER_THRESHOLD           3       //!< failures in a row opening the circuit
+#define NUT_BREAKER_BACKOFF_MIN_MS      60000   //!< first probe after the circuit opened
+#define NUT_BREAKER_BACKOFF_MAX_MS      1800000 //!< probes never get rarer than this
+
+namespace drivers
+{
+namespace nut
+{
+
+enum class NUTCircuitState {
+    CLOSED,     //!< device answers, ask it freely
+    OPEN,       //!< device failed repeatedly, don't ask it until next probe
+    HALF_OPEN   //!< one probe is asking the device, others wait for its outcome
+};
+
+struct NUTCircuitStats {
+    uint64_t open;      //!< circuits open or half-open now
+    uint64_t opened;    //!< times a circuit was opened
+    uint64_t rejected;  //!< requests not sent because the circuit was open
+};
+
+/**
+ * \brief Process wide circuit breaker per NUT device.
+ *
+ * Devices not configured in NUT yet or with a dead driver used to be
+ * asked (and logged about) every cycle by every actor. After
+ * NUT_BREAKER_THRESHOLD failures in a row the circuit opens and the
+ * device is asked again only by a single probe, with backoff doubled
+ * after each failed probe. Keyed by NUT device name, so all assets of a
+ * daisy chain share the circuit of the master.
+ *
+ *    auto& breaker = NUTCircuitBreaker::instance ();
+ *    if (breaker.allow (nutName)) {
+ *        if (fetch (nutName)) breaker.success (nutName);
+ *        else breaker.failure (nutName, error);
+ *    }
+ */
+class NUTCircuitBreaker {
+ public:
+    explicit NUTCircuitBreaker (
+        unsigned threshold = NUT_BREAKER_THRESHOLD,
+        int64_t backoffMin = NUT_BREAKER_BACKOFF_MIN_MS,
+        int64_t backoffMax = NUT_BREAKER_BACKOFF_MAX_MS);
+    NUTCircuitBreaker (const NUTCircuitBreaker&) = delete;
+    NUTCircuitBreaker& operator= (const NUTCircuitBreaker&) = delete;
+
+    //! \brief the breaker shared by all actors of the process
+    static NUTCircuitBreaker& instance ();
+
+    /**
+     * \brief true if device name may be asked at time now [ms]
+     *
+     * When the backoff of an open circuit expired, the caller getting true
+     * is the probe and must report success () or failure (). A probe not
+     * reported within the backoff is given up and another one is allowed.
+     */
+    bool allow (const std::string& name, int64_t now = -1);
+
+    //! \brief device answered, close its circuit
+    void success (const std::string& name);
+    //! \brief device did not answer at time now [ms]
+    void failure (const std::string& name, const std::string& reason, int64_t now = -1);
+    //! \brief forget the device, e.g. when its asset changed
+    void reset (const std::string& name);
+
+    NUTCircuitState state (const std::string& name) const;
+    NUTCircuitStats stats () const;
+
+ private:
+    struct Circuit {
+        NUTCircuitState state = NUTCircuitState::CLOSED;
+        unsigned failures = 0;      //!< in a row
+        int64_t backoff = 0;        //!< [ms] current probe interval
+        int64_t nextProbe = 0;      //!< [ms] zclock_mono
+    };
+
+    unsigned _threshold;
+    int64_t _backoffMin;
+    int64_t _backoffMax;
+
+    mutable std::mutex _mutex;      //!< protects _circuits
+    std::map <std::string, Circuit> _circuits;     //!< only devices with failures
+
+    std::atomic<uint64_t> _opened {0};
+    std::atomic<uint64_t> _rejected {0};
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_circuit_breaker_test (bool verbose);
+//  @end
+
+#endif
@@ -0,0 +1,267 @@
+/*  =========================================================================
+    nut_connection_pool - persistent connections to NUT daemon
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_connection_pool - persistent connections to NUT daemon
+@discuss
+    Sessions to upsd survive between polling cycles. A session is checked
+    by a cheap LIST UPS when it was idle for more than
+    NUT_CONNECTION_KEEPALIVE_MS and reopened when broken. Failed connects
+    are retried with exponential backoff (NUT_CONNECTION_BACKOFF_MIN_MS up
+    to NUT_CONNECTION_BACKOFF_MAX_MS).
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTConnectionPool::Lease::Lease (NUTConnectionPool *pool, Entry *entry) :
+    _pool (pool),
+    _entry (entry)
+{
+}
+
+NUTConnectionPool::Lease::Lease (Lease&& other) :
+    _pool (other._pool),
+    _entry (other._entry)
+{
+    other._pool = NULL;
+    other._entry = NULL;
+}
+
+NUTConnectionPool::Lease::~Lease ()
+{
+    if (_pool && _entry) {
+        _pool->release (_entry);
+    }
+}
+
+NUTConnectionPool::Lease::operator bool () const
+{
+    return _entry && _entry->client && _entry->client->isConnected ();
+}
+
+nutclient::TcpClient& NUTConnectionPool::Lease::operator* ()
+{
+    return *_entry->client;
+}
+
+nutclient::TcpClient* NUTConnectionPool::Lease::operator-> ()
+{
+    return _entry->client.get ();
+}
+
+bool NUTConnectionPool::Lease::reconnect ()
+{
+    if (!_pool || !_entry) return false;
+    log_warning ("upsd session to %s:%i is broken, reconnecting", _entry->host.c_str (), _entry->port);
+    ++_pool->_failures;
+    close (*_entry);
+    return _pool->open (*_entry);
+}
+
+NUTConnectionPool& NUTConnectionPool::instance ()
+{
+    static NUTConnectionPool pool;
+    return pool;
+}
+
+NUTConnectionPool::Lease NUTConnectionPool::acquire (const std::string& host, int port)
+{
+    Entry *entry = NULL;
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        for (auto& it : _entries) {
+            if (!it.leased && it.port == port && it.host == host) {
+                // prefer open sessions
+                if (!entry || (it.client->isConnected () && !entry->client->isConnected ())) {
+                    entry = &it;
+                }
+            }
+        }
+        if (!entry) {
+            _entries.emplace_back ();
+            entry = &_entries.back ();
+            entry->host = host;
+            entry->port = port;
+            entry->client.reset (new nutclient::TcpClient ());
+        }
+        entry->leased = true;
+    }
+    Lease lease (this, entry);
+    if (entry->client->isConnected ()) {
+        if (check (*entry)) {
+            ++_reuses;
+        }
+    }
+    else {
+        open (*entry);
+    }
+    return lease;
+}
+
+void NUTConnectionPool::release (Entry *entry)
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    entry->lastUsed = zclock_mono ();
+    entry->leased = false;
+}
+
+void NUTConnectionPool::close (Entry& entry)
+{
+    try {
+        entry.client->disconnect ();
+    } catch (...) {}
+}
+
+bool NUTConnectionPool::open (Entry& entry)
+{
+    int64_t now = zclock_mono ();
+    if (now < entry.nextAttempt) {
+        log_debug ("upsd %s:%i: next connect attempt in %" PRIi64 " ms",
+                   entry.host.c_str (), entry.port, entry.nextAttempt - now);
+        return false;
+    }
+    try {
+        close (entry);
+        entry.client->connect (entry.host, entry.port);
+    } catch (std::exception& e) {
+        log_error ("connect to upsd %s:%i failed (%s)", entry.host.c_str (), entry.port, e.what ());
+    }
+    if (entry.client->isConnected ()) {
+        ++_connects;
+        entry.backoff = NUT_CONNECTION_BACKOFF_MIN_MS;
+        entry.nextAttempt = 0;
+        return true;
+    }
+    ++_failures;
+    entry.nextAttempt = now + entry.backoff;
+    entry.backoff = std::min<int64_t> (entry.backoff * 2, NUT_CONNECTION_BACKOFF_MAX_MS);
+    return false;
+}
+
+bool NUTConnectionPool::check (Entry& entry)
+{
+    if (zclock_mono () - entry.lastUsed < NUT_CONNECTION_KEEPALIVE_MS) {
+        return true;
+    }
+    try {
+        entry.client->getDeviceNames ();
+        return true;
+    } catch (std::exception& e) {
+        log_warning ("idle upsd session to %s:%i is broken (%s)", entry.host.c_str (), entry.port, e.what ());
+    }
+    ++_failures;
+    close (entry);
+    return open (entry);
+}
+
+void NUTConnectionPool::keepalive ()
+{
+    std::list<Entry *> idle;
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        for (auto& it : _entries) {
+            if (!it.leased && it.client->isConnected ()) {
+                it.leased = true;
+                idle.push_back (&it);
+            }
+        }
+    }
+    for (auto entry : idle) {
+        check (*entry);
+        release (entry);
+    }
+}
+
+void NUTConnectionPool::clear ()
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto it = _entries.begin ();
+    while (it != _entries.end ()) {
+        if (it->leased) {
+            ++it;
+            continue;
+        }
+        close (*it);
+        it = _entries.erase (it);
+    }
+}
+
+NUTConnectionStats NUTConnectionPool::stats () const
+{
+    NUTConnectionStats result;
+    result.connects = _connects;
+    result.reuses = _reuses;
+    result.failures = _failures;
+    return result;
+}
+
+NUTConnectionPool::~NUTConnectionPool ()
+{
+    for (auto& it : _entries) {
+        close (it);
+    }
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_connection_pool_test (bool verbose)
+{
+    printf (" * nut_connection_pool: ");
+
+    //  @selftest
+    // nothing listens on port 1, connect must fail and back off
+    drivers::nut::NUTConnectionPool pool;
+    {
+        auto lease = pool.acquire ("127.0.0.1", 1);
+        assert (!lease);
+    }
+    assert (pool.stats ().connects == 0);
+    assert (pool.stats ().failures == 1);
+    {
+        // the idle (broken) session is reused, backoff prevents new attempt
+        auto lease = pool.acquire ("127.0.0.1", 1);
+        assert (!lease);
+        assert (!lease.reconnect ());
+    }
+    assert (pool.stats ().failures == 2);
+    {
+        // two leases at once get two sessions
+        auto lease1 = pool.acquire ("127.0.0.1", 1);
+        auto lease2 = pool.acquire ("127.0.0.1", 1);
+        assert (&*lease1 != &*lease2);
+    }
+    pool.clear ();
+    assert (pool.stats ().reuses == 0);
+    //  @end
+    printf ("OK\n");
+}
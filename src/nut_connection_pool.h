@@ -0,0 +1,152 @@
+/*  =========================================================================
+    nut_connection_pool - persistent connections to NUT daemon
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_CONNECTION_POOL_H_INCLUDED
+#define NUT_CONNECTION_POOL_H_INCLUDED
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <nutclient.h>
+
+namespace nutclient = nut;
+
+#define NUT_CONNECTION_KEEPALIVE_MS     60000   //!< idle sessions are checked by LIST UPS after this
+#define NUT_CONNECTION_BACKOFF_MIN_MS    1000   //!< first reconnect delay after a failure
+#define NUT_CONNECTION_BACKOFF_MAX_MS   60000   //!< reconnect delay never grows above this
+
+namespace drivers
+{
+namespace nut
+{
+
+struct NUTConnectionStats {
+    uint64_t connects;  //!< sessions opened to upsd
+    uint64_t reuses;    //!< leases served by an already open session
+    uint64_t failures;  //!< failed connect attempts and broken sessions
+};
+
+/**
+ * \brief Process wide pool of long-lived upsd sessions.
+ *
+ * Every actor used to open and close its own nut::TcpClient each polling
+ * cycle. The pool keeps the sessions open between cycles instead, checks
+ * sessions idle for a long time, and reopens broken ones with exponential
+ * backoff. A session is used by one lease (one thread) at a time.
+ */
+class NUTConnectionPool {
+    struct Entry {
+        std::string host;
+        int port = 3493;
+        std::unique_ptr<nutclient::TcpClient> client;
+        bool leased = false;
+        int64_t lastUsed = 0;       //!< [ms] zclock_mono of last release
+        int64_t nextAttempt = 0;    //!< [ms] no connect attempt before this
+        int64_t backoff = NUT_CONNECTION_BACKOFF_MIN_MS;
+    };
+ public:
+    /**
+     * \brief Exclusive use of one pooled session, returned on destruction.
+     *
+     *    auto conn = NUTConnectionPool::instance ().acquire ();
+     *    if (conn) {
+     *        conn->getDevice ("ups").getVariableValues ();
+     *    }
+     */
+    class Lease {
+     public:
+        Lease (Lease&& other);
+        Lease (const Lease&) = delete;
+        Lease& operator= (const Lease&) = delete;
+        ~Lease ();
+
+        //! \brief true if the session is connected
+        explicit operator bool () const;
+        nutclient::TcpClient& operator* ();
+        nutclient::TcpClient* operator-> ();
+
+        /**
+         * \brief Drop the session after an I/O error and try to open it again.
+         * \return true if the session is connected again
+         *
+         * The reconnect is subject to the backoff, so a dead upsd is not
+         * hammered by every device of the cycle.
+         */
+        bool reconnect ();
+     private:
+        friend class NUTConnectionPool;
+        Lease (NUTConnectionPool *pool, Entry *entry);
+
+        NUTConnectionPool *_pool;
+        Entry *_entry;
+    };
+
+    //! \brief the pool shared by all actors of the process
+    static NUTConnectionPool& instance ();
+
+    /**
+     * \brief Lease a session to upsd on host:port.
+     *
+     * Reuses an idle session if there is one, otherwise opens a new one.
+     * Returned lease evaluates to false when upsd is not reachable (or the
+     * reconnect backoff did not expire yet).
+     */
+    Lease acquire (const std::string& host = "localhost", int port = 3493);
+
+    //! \brief check idle sessions, so broken ones are detected between cycles
+    void keepalive ();
+
+    //! \brief close all idle sessions
+    void clear ();
+
+    NUTConnectionStats stats () const;
+
+    NUTConnectionPool () {};
+    NUTConnectionPool (const NUTConnectionPool&) = delete;
+    NUTConnectionPool& operator= (const NUTConnectionPool&) = delete;
+    ~NUTConnectionPool ();
+ private:
+    //! \brief (re)connect the entry, honouring the backoff
+    bool open (Entry& entry);
+    //! \brief ping the session if idle for too long, reopen if broken
+    bool check (Entry& entry);
+    void release (Entry *entry);
+    static void close (Entry& entry);
+
+    std::mutex _mutex;              //!< protects _entries (not the sessions)
+    std::list<Entry> _entries;      //!< list, so Entry pointers stay valid
+
+    std::atomic<uint64_t> _connects {0};
+    std::atomic<uint64_t> _reuses {0};
+    std::atomic<uint64_t> _failures {0};
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_connection_pool_test (bool verbose);
+//  @end
+
+#endif
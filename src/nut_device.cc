@@ -29,6 +29,8 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
+#include <set>
 #include <exception>
 #include <cxxtools/jsondeserializer.h>
 #include <cxxtools/serializationerror.h>
@@ -45,6 +47,99 @@ namespace drivers
 namespace nut
 {
 
+// suffixes of variables read from the snapshot by alert actor
+static const std::vector <std::string> s_alert_suffixes = {
+    ".status", ".high", ".low", ".high.warning", ".high.critical", ".low.warning", ".low.critical"
+};
+
+// true for variables the alert actor reads, like outlet.1.current.high.warning
+static bool
+s_is_alert (const std::string& name)
+{
+    for (const auto& suffix : s_alert_suffixes) {
+        if (name.size () > suffix.size () &&
+            name.compare (name.size () - suffix.size (), suffix.size (), suffix) == 0) return true;
+    }
+    return false;
+}
+
+// variables of one member of a daisy chain, the only ones NUTDevice::update () reads
+static std::map <std::string, std::vector <std::string>>
+s_chain_variables (const std::map <std::string, std::vector <std::string>>& vars, const std::string& prefix)
+{
+    if (prefix.empty ()) return vars;
+    std::map <std::string, std::vector <std::string>> result;
+    for (auto it = vars.lower_bound (prefix); it != vars.end () && it->first.compare (0, prefix.size (), prefix) == 0; ++it) {
+        result.insert (result.end (), *it);
+    }
+    return result;
+}
+
+// FNV-1a of variable names and values, 0 is left for "no payload"
+static uint64_t
+s_payload_hash (const std::map <std::string, std::vector <std::string>>& vars)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash] (const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        // separator, so "ab","c" differs from "a","bc"
+        hash ^= 0xff;
+        hash *= 1099511628211ULL;
+    };
+    for (const auto &item : vars) {
+        add (item.first);
+        for (const auto &value : item.second) {
+            add (value);
+        }
+        hash ^= 0xfe;
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+// parse text as a number, false if it is none
+static bool
+s_parse_number (const std::string& text, double& number)
+{
+    if (text.empty ()) return false;
+    char *rest = NULL;
+    number = strtod (text.c_str (), &rest);
+    return *rest == '\0' && std::isfinite (number);
+}
+
+// true for ups.status and the alert status variables like outlet.1.current.status
+static bool
+s_is_status (const std::string& name)
+{
+    static const std::string suffix = ".status";
+    return name == "ups.status" ||
+        (name.size () > suffix.size () && name.compare (name.size () - suffix.size (), suffix.size (), suffix) == 0);
+}
+
+// true for variables of one outlet like outlet.1.current or device.2.outlet.1.current
+static bool
+s_is_outlet (const std::string& name)
+{
+    for (size_t pos = name.find ("outlet."); pos != std::string::npos; pos = name.find ("outlet.", pos + 1)) {
+        if ((pos == 0 || name[pos - 1] == '.') && isdigit (name[pos + 7])) return true;
+    }
+    return false;
+}
+
+// QoS class of a daisy chain, the one of its most important member
+static const NUTQosClass&
+s_chain_class (const std::vector <NUTDevice *>& chain)
+{
+    NUTQosLevel level = NUTQosLevel::BULK;
+    for (const auto device : chain) {
+        level = std::min (level, device->qos ());
+    }
+    return NUTQos::schedule (level);
+}
+
 NUTDevice::NUTDevice() :
     _daisyChainIndex (0)
 {
@@ -104,6 +199,10 @@ int NUTDevice::daisyChainIndex () const {
 
 void NUTDevice::assetExtAttribute (const std::string name, const std::string value)
 {
+    if (value != assetExtAttribute (name)) {
+        // attributes take part in the rules deriving variables
+        _payloadHash = 0;
+    }
     if (value.empty ()) {
         _assetExtAttributes.erase (name);
     } else {
@@ -132,97 +231,184 @@ std::string NUTDevice::daisyPrefix() const {
  * change getters
  */
 bool NUTDevice::changed() const {
-    for(auto &it : _physics ){
-        if(it.second.changed) return true;
-    }
-    for(auto &it : _inventory ){
-        if(it.second.changed) return true;
-    }
-    return false;
+    return _physics.anyChanged() || _inventory.anyChanged();
 }
 
-bool NUTDevice::changed(const char *name) const {
-    auto iterP = _physics.find(name);
-    if( iterP != _physics.end() ) {
+bool NUTDevice::changed(NUTKey key) const {
+    size_t slot = _physics.slot(key);
+    if( slot != SIZE_MAX ) {
         // this is a number, value exists
-        return iterP->second.changed;
+        return _physics.changed(slot);
     }
-    auto iterI = _inventory.find(name);
-    if( iterI != _inventory.end() ) {
+    slot = _inventory.slot(key);
+    if( slot != SIZE_MAX ) {
         // this is a inventory string, value exists
-        return iterI->second.changed;
+        return _inventory.changed(slot);
     }
     return false;
 }
 
+bool NUTDevice::changed(const char *name) const {
+    return changed(NUTKeys::instance().find(name));
+}
+
 bool NUTDevice::changed(const std::string &name) const {
-    return changed(name.c_str());
+    return changed(NUTKeys::instance().find(name));
 }
 
 /**
  * change setters
  */
 void NUTDevice::setChanged(const bool status) {
-    for(auto &it : _physics ){
-        it.second.changed = status;
-    }
-    for(auto &it : _inventory ){
-        it.second.changed = status;
-    }
+    _physics.setChanged(status);
+    _inventory.setChanged(status);
 }
 
-void NUTDevice::setChanged(const char *name, const bool status) {
-    auto iterP = _physics.find(name);
-    if( iterP != _physics.end() ) {
+void NUTDevice::setChanged(NUTKey key, const bool status) {
+    size_t slot = _physics.slot(key);
+    if( slot != SIZE_MAX ) {
         // this is a number, value exists
-        iterP->second.changed = status;
+        _physics.setChanged(slot, status);
     }
-    auto iterI = _inventory.find(name);
-    if( iterI != _inventory.end() ) {
+    slot = _inventory.slot(key);
+    if( slot != SIZE_MAX ) {
         // this is a inventory string, value exists
-        iterI->second.changed = status;
+        _inventory.setChanged(slot, status);
     }
 }
 
+void NUTDevice::setChanged(const char *name, const bool status) {
+    setChanged(NUTKeys::instance().find(name), status);
+}
+
 void NUTDevice::setChanged(const std::string& name,const bool status){
-    setChanged(name.c_str(),status);
+    setChanged(NUTKeys::instance().find(name), status);
 }
 
 void NUTDevice::updatePhysics(const std::string& varName, const std::string& newValue) {
-    if( _physics.count( varName ) == 0 ) {
+    updatePhysics(NUTKeys::instance().intern( varName ), newValue);
+}
+
+void NUTDevice::updatePhysics(NUTKey key, const std::string& newValue, const NUTDeadband& deadband) {
+    bool inserted;
+    NUTPhysicalValue& pvalue = _physics.insert( key, &inserted );
+    double number = 0;
+    bool numeric = s_parse_number( newValue, number );
+    if( ! inserted ) {
+        if( numeric && pvalue.numeric ) {
+            // jitter within the band keeps the value published last
+            if( ! deadband.exceeded( pvalue.number, number ) ) return;
+        }
+        else if( pvalue.value == newValue ) {
+            return;
+        }
+    } else {
         // this is new value
-        struct NUTPhysicalValue pvalue;
-        pvalue.changed = true;
         pvalue.value = "0";
-        pvalue.candidate = newValue;
-        _physics[ varName ] = pvalue;
-    } else {
-        if (_physics[ varName ].value != newValue) {
-            _physics[ varName ].candidate = newValue;
-        }
+        pvalue.number = 0;
+        pvalue.numeric = true;
     }
+    pvalue.candidate = newValue;
+    pvalue.candidateNumber = number;
+    pvalue.candidateNumeric = numeric;
+    _pending.push_back( static_cast<uint32_t>( _physics.slot( key ) ) );
 }
 
 void NUTDevice::updatePhysics(const std::string& varName, std::vector<std::string>& values) {
+    updatePhysics(NUTKeys::instance().intern( varName ), values);
+}
+
+void NUTDevice::updatePhysics(NUTKey key, const std::vector<std::string>& values, const NUTDeadband& deadband) {
     if( values.size() == 1 ) {
         // don't know how to handle multiple values
         // multiple values would be probably nonsence
         try {
-            updatePhysics(varName,values[0]);
+            updatePhysics(key,values[0],deadband);
         } catch (...) {}
     }
 }
 
 void NUTDevice::commitChanges() {
-    for( auto & item:  _physics ) {
-        if( item.second.value != item.second.candidate ) {
-            item.second.value = item.second.candidate;
-            item.second.changed = true;
+    _committedChanges = 0;
+    _statusChanged = false;
+    static const NUTKey statusKey = NUTKeys::instance().intern("status.ups");
+    // just the values given a candidate since the last commit
+    for( uint32_t i : _pending ) {
+        NUTPhysicalValue& item = _physics.value(i);
+        if( item.value != item.candidate ) {
+            item.value = item.candidate;
+            item.number = item.candidateNumber;
+            item.numeric = item.candidateNumeric;
+            _physics.setChanged(i, true);
+            ++_committedChanges;
+            if( _physics.key(i) == statusKey ) _statusChanged = true;
         }
     }
+    _pending.clear();
+}
+
+bool NUTDevice::lowPriority () const
+{
+    return NUTQos::lowPriority (_qos, assetExtAttribute ("subtype").c_str ());
+}
+
+void NUTDevice::reschedule (int64_t now, int64_t base, int64_t ceiling)
+{
+    int64_t interval;
+    if (_pollingInterval < base || _statusChanged) {
+        // first cycle or something is going on (e.g. transfer to battery)
+        interval = base;
+    }
+    else if (_committedChanges) {
+        // ceiling may have come down, e.g. for a failed read
+        interval = std::min (ceiling, std::max (base, _pollingInterval / 2));
+    }
+    else {
+        interval = std::min (ceiling, _pollingInterval + _pollingInterval / 2);
+    }
+    if (interval != _pollingInterval) {
+        log_debug ("polling interval of %s changed from %" PRIi64 " to %" PRIi64 " ms (%zu changes)",
+                   _assetName.c_str (), _pollingInterval, interval, _committedChanges);
+    }
+    _pollingInterval = interval;
+    _nextPoll = now + interval;
+    _committedChanges = 0;
+    _statusChanged = false;
+}
+
+void NUTDevice::learnSchema (const std::map <std::string, std::vector <std::string>>& vars,
+                             const NUTMapping& mapping,
+                             int64_t now,
+                             std::function <bool (const std::string& metric)> wanted)
+{
+    const std::string prefix = daisyPrefix ();
+    auto needed = [&] (const std::string& variable) {
+        // sensors and alerts of any device in the chain
+        if (variable.find ("ambient.") != std::string::npos || s_is_alert (variable)) return true;
+        // the rest only of this device
+        if (variable.compare (0, prefix.size (), prefix) != 0) return false;
+        const char *name = variable.c_str () + prefix.size ();
+        auto target = mapping.resolve (name);
+        if (target.inventory != NUT_KEY_NONE) return true;
+        // metric nobody listens to is not worth a round trip
+        if (target.physics != NUT_KEY_NONE && (!wanted || wanted (NUTKeys::instance ().name (target.physics)))) return true;
+        return mapping.rules ().input (name);
+    };
+
+    _schema.clear ();
+    for (const auto& item : vars) {
+        if (needed (item.first)) _schema.push_back (item.first);
+    }
+    _schemaLearned = now;
+    log_debug ("%s needs %zu of %zu variables", _assetName.c_str (), _schema.size (), vars.size ());
 }
 
 void NUTDevice::updateInventory(const std::string& varName, std::vector<std::string>& values) {
+    updateInventory(NUTKeys::instance().intern( varName ), values);
+}
+
+void NUTDevice::updateInventory(NUTKey key, const std::vector<std::string>& values) {
+    static const NUTKey typeKey = NUTKeys::instance().intern("type");
     std::string inventory = "";
     for(size_t i = 0 ; i < values.size() ; ++i ) {
         inventory += values[i];
@@ -232,129 +418,111 @@ void NUTDevice::updateInventory(const std::string& varName, std::vector<std::str
     }
     // inventory now looks like "value1, value2, value3"
     // NUT bug type pdu => epdu
-    if( varName == "type" && inventory == "pdu" ) { inventory = "epdu"; }
-    if( _inventory.count( varName ) == 0 ) {
-        // this is new value
-        struct NUTInventoryValue ivalue;
-        ivalue.changed = true;
+    if( key == typeKey && inventory == "pdu" ) { inventory = "epdu"; }
+    bool inserted;
+    NUTInventoryValue& ivalue = _inventory.insert( key, &inserted );
+    if( inserted || ivalue.value != inventory ) {
+        // new value is flagged changed by insert
         ivalue.value = inventory;
-        _inventory[ varName ] = ivalue;
-    } else {
-        if( _inventory[ varName ].value != inventory ) {
-            _inventory[ varName ].value = inventory;
-            _inventory[ varName ].changed = true;
-        }
+        _inventory.setChanged( _inventory.slot( key ), true );
     }
 }
 
-void NUTDevice::update (std::map <std::string, std::vector <std::string>> vars,
-                        std::function <const std::map <std::string, std::string>&(const char *)> mapping,
+bool NUTDevice::update (std::map <std::string, std::vector <std::string>> vars,
+                        const NUTMapping& mapping,
                         bool forceUpdate) {
 
-    if( vars.empty() ) return;
+    if( vars.empty() ) return false;
     _lastUpdate = time(NULL);
-    std::string prefix = daisyPrefix();
 
-    // use transformation table first
-    NUTValuesTransformation (prefix, vars);
-
-    // walk trough physics
-    for (const auto& item : mapping ("physicsMapping")) {
-        if (vars.find (prefix + item.first) != vars.end ()) {
-            // variable found in received data
-            std::vector<std::string> values = vars[prefix + item.first];
-            updatePhysics (item.second, values);
-        }
-        else {
-            // iterating numbered items in physics
-            // like outlet.1.voltage, outlet.2.voltage, ...
-            int x = item.first.find(".#."); // is always in the middle: outlet.1.realpower
-            int y = item.second.find(".#"); // can be at the end: outlet.voltage.#
-            if( x > 0 && y > 0 ) {
-                // this is something like outlet.#.realpower
-                std::string nutprefix = item.first.substr(0,x+1);
-                std::string nutsuffix = item.first.substr(x+2);
-                std::string biosprefix = item.second.substr(0,y+1);
-                std::string biossuffix = item.second.substr(y+2);
-                std::string nutname,biosname;
-                int i = 1;
-                while(true) {
-                    nutname = nutprefix + std::to_string(i) + nutsuffix;
-                    biosname = biosprefix + std::to_string(i) + biossuffix;
-                    if( vars.count(prefix + nutname) == 0 ) break; // variable out of scope
-                    // variable found
-                    std::vector<std::string> values = vars[prefix + nutname];
-                    updatePhysics (biosname, values);
-                    ++i;
-                }
-            }
-        }
+    // the driver says the same as last time, so would we
+    uint64_t hash = s_payload_hash (vars);
+    if (hash == _payloadHash) {
+        _committedChanges = 0;
+        _statusChanged = false;
+        return false;
     }
+    _payloadHash = hash;
 
-    // walk trough inventory
-    //for(size_t i = 0; i < inventoryMapping.size(); ++i) {
-    for (const auto& item : mapping ("inventoryMapping")) {
-        if( vars.find (prefix + item.first) != vars.end() ) {
-            // variable found in received data
-            std::vector<std::string> values = vars[prefix + item.first];
-            updateInventory (item.second, values);
-        } else {
-            // iterating numbered items in physics
-            // like outlet.1.voltage, outlet.2.voltage, ...
-            int x = item.first.find(".#."); // is always in the middle: outlet.1.realpower
-            int y = item.second.find(".#"); // can be at the end: outlet.voltage.#
-            if( x > 0 && y > 0 ) {
-                // this is something like outlet.#.realpower
-                std::string nutprefix = item.first.substr(0,x+1);
-                std::string nutsuffix = item.first.substr(x+2);
-                std::string biosprefix = item.second.substr(0,y+1);
-                std::string biossuffix = item.second.substr(y+2);
-                std::string nutname,biosname;
-                int i = 1;
-                while(true) {
-                    nutname = nutprefix + std::to_string(i) + nutsuffix;
-                    biosname = biosprefix + std::to_string(i) + biossuffix;
-                    if( vars.count(prefix + nutname) == 0 ) break; // variable out of scope
-                    // variable found
-                    std::vector<std::string> values = vars[prefix + nutname];
-                    updateInventory(biosname, values);
-                    ++i;
-                }
-            }
+    std::string prefix = daisyPrefix();
+
+    {
+        // pdu replace with epdu
+        auto it = vars.find (prefix + "device.type");
+        if( it != vars.end() ) {
+            if( ! it->second.empty() && it->second[0] == "pdu" ) it->second[0] = "epdu";
         }
     }
+    // outlet variables sit together in the sorted map
+    _outlets.reset ();
+    const std::string outletPrefix = prefix + "outlet.";
+    for (auto it = vars.lower_bound (outletPrefix); it != vars.end () && it->first.compare (0, outletPrefix.size (), outletPrefix) == 0; ++it) {
+        _outlets.take (it->first.c_str () + prefix.size (), it->second);
+    }
+    // variables the device does not give, derived by rules of mapping.conf
+    mapping.rules ().apply (prefix, _assetExtAttributes, vars, _rulesState, &_outlets);
+
+    // one pass over what came, mapping tells where each variable goes
+    for (const auto& item : vars) {
+        if (item.first.compare (0, prefix.size (), prefix) != 0) continue;
+        auto target = mapping.resolve (prefix.empty () ? item.first : item.first.substr (prefix.size ()));
+        if (target.physics != NUT_KEY_NONE) updatePhysics (target.physics, item.second, mapping.deadband (target.physics));
+        if (target.inventory != NUT_KEY_NONE) updateInventory (target.inventory, item.second);
+    }
     commitChanges();
+    return true;
 }
 
-std::string NUTDevice::itof(const long int X) const {
-    std::string num,dec,sig;
-    long int AX;
-
-    if( X < 0 ) {
-        sig = "-";
-    } else {
-        sig = "";
-    }
-    AX = abs(X);
-    num = std::to_string( AX / 100 );
-    dec = std::to_string( AX % 100 );
-    if( dec.size() == 1 ) dec = "0" + dec;
-    if( dec == "00" ) {
-        return sig + num;
-    } else {
-        return sig + num + "." + dec;
+bool NUTDevice::updateStatus (const std::map <std::string, std::vector <std::string>>& vars,
+                              const NUTMapping& mapping)
+{
+    static const NUTKey statusKey = NUTKeys::instance().intern("status.ups");
+    const std::string prefix = daisyPrefix ();
+
+    bool changed = false;
+    for (const auto& item : vars) {
+        if (item.first.compare (0, prefix.size (), prefix) != 0 || item.second.size () != 1) continue;
+        _outlets.take (item.first.c_str () + prefix.size (), item.second);
+        auto target = mapping.resolve (item.first.c_str () + prefix.size ());
+        if (target.inventory != NUT_KEY_NONE) {
+            const auto *old = _inventory.find (target.inventory);
+            if (old && old->value == item.second[0]) continue;
+            updateInventory (target.inventory, item.second);
+            changed = true;
+            continue;
+        }
+        if (target.physics != NUT_KEY_NONE) {
+            NUTKey key = target.physics;
+            const auto *old = _physics.find (key);
+            if (old && old->value == item.second[0]) continue;
+            // committed alone, everything else was committed by update ()
+            NUTPhysicalValue& value = _physics.insert (key);
+            value.value = value.candidate = item.second[0];
+            value.numeric = value.candidateNumeric = s_parse_number (value.value, value.number);
+            value.candidateNumber = value.number;
+            _physics.setChanged (_physics.slot (key), true);
+            // counted like a committed change, the next reschedule () drops
+            // back to the base interval on OL -> OB
+            if (key == statusKey) _statusChanged = true;
+            ++_committedChanges;
+            changed = true;
+        }
     }
+    // next full read must not be taken for the same payload as the last one
+    if (changed) _payloadHash = 0;
+    return changed;
 }
 
 std::string NUTDevice::toString() const {
     std::string msg = "",val;
-    for(auto it : _physics ){
-        msg += "\"" + it.first + "\":" + it.second.value + ", ";
+    auto &keys = NUTKeys::instance();
+    for( size_t i = 0; i < _physics.size(); ++i ) {
+        msg += "\"" + keys.name(_physics.key(i)) + "\":" + _physics.value(i).value + ", ";
     }
-    for(auto it : _inventory ){
-        val = it.second.value;
+    for( size_t i = 0; i < _inventory.size(); ++i ) {
+        val = _inventory.value(i).value;
         std::replace(val.begin(), val.end(),'"',' ');
-        msg += "\"" + it.first + "\":\"" + val + "\", ";
+        msg += "\"" + keys.name(_inventory.key(i)) + "\":\"" + val + "\", ";
     }
     if( msg.size() > 2 ) {
         msg = msg.substr(0, msg.size()-2 );
@@ -364,46 +532,51 @@ std::string NUTDevice::toString() const {
 
 std::map<std::string,std::string> NUTDevice::properties() const {
     std::map<std::string,std::string> map;
-    for(auto it : _physics ){
-        map[ it.first ] = it.second.value;
+    auto &keys = NUTKeys::instance();
+    for( size_t i = 0; i < _physics.size(); ++i ) {
+        map[ keys.name(_physics.key(i)) ] = _physics.value(i).value;
     }
-    for(auto it : _inventory ){
-        map[ it.first ] = it.second.value;
+    for( size_t i = 0; i < _inventory.size(); ++i ) {
+        map[ keys.name(_inventory.key(i)) ] = _inventory.value(i).value;
     }
     return map;
 }
 
 std::map<std::string,std::string> NUTDevice::physics(bool onlyChanged) const {
     std::map<std::string,std::string> map;
-    for ( const auto &it : _physics ) {
-        if( ( ! onlyChanged ) || it.second.changed ) {
-            map[ it.first ] = it.second.value;
+    auto &keys = NUTKeys::instance();
+    if( onlyChanged ) {
+        for( size_t i : _physics.changedSlots() ) {
+            map[ keys.name(_physics.key(i)) ] = _physics.value(i).value;
         }
+        return map;
+    }
+    for( size_t i = 0; i < _physics.size(); ++i ) {
+        map[ keys.name(_physics.key(i)) ] = _physics.value(i).value;
     }
     return map;
 }
 
 std::map<std::string,std::string> NUTDevice::inventory(bool onlyChanged) const {
     std::map<std::string,std::string> map;
-    for ( const auto &it : _inventory ) {
-        if( ( ! onlyChanged ) || it.second.changed ) {
-            map[ it.first ] = it.second.value;
+    auto &keys = NUTKeys::instance();
+    if( onlyChanged ) {
+        for( size_t i : _inventory.changedSlots() ) {
+            map[ keys.name(_inventory.key(i)) ] = _inventory.value(i).value;
         }
+        return map;
+    }
+    for( size_t i = 0; i < _inventory.size(); ++i ) {
+        map[ keys.name(_inventory.key(i)) ] = _inventory.value(i).value;
     }
     return map;
 }
 
 
 bool NUTDevice::hasProperty(const char *name) const {
-    if( _physics.count( name ) != 0 ) {
-        // this is a number and value exists
-        return true;
-    }
-    if( _inventory.count( name ) != 0 ) {
-        // this is a inventory string, value exists
-        return true;
-    }
-    return false;
+    NUTKey key = NUTKeys::instance().find(name);
+    // a number or an inventory string, value exists
+    return _physics.contains(key) || _inventory.contains(key);
 }
 
 bool NUTDevice::hasProperty(const std::string& name) const {
@@ -411,11 +584,7 @@ bool NUTDevice::hasProperty(const std::string& name) const {
 }
 
 bool NUTDevice::hasPhysics(const char *name) const {
-    if( _physics.count( name ) != 0 ) {
-        // this is a number and value exists
-        return true;
-    }
-    return false;
+    return _physics.contains(NUTKeys::instance().find(name));
 }
 
 bool NUTDevice::hasPhysics(const std::string& name) const {
@@ -425,15 +594,16 @@ bool NUTDevice::hasPhysics(const std::string& name) const {
 
 
 std::string NUTDevice::property(const char *name) const {
-    auto iterP = _physics.find(name);
-    if( iterP != _physics.end() ) {
+    NUTKey key = NUTKeys::instance().find(name);
+    const NUTPhysicalValue *physics = _physics.find(key);
+    if( physics ) {
         // this is a number, value exists
-        return iterP->second.value;
+        return physics->value;
     }
-    auto iterI = _inventory.find(name);
-    if( iterI != _inventory.end() ) {
+    const NUTInventoryValue *inventory = _inventory.find(key);
+    if( inventory ) {
         // this is a inventory string, value exists
-        return iterI->second.value;
+        return inventory->value;
     }
     return "";
 }
@@ -442,341 +612,794 @@ std::string NUTDevice::property(const std::string& name) const {
     return property(name.c_str());
 }
 
-void NUTDevice::NUTSetIfNotPresent (const std::string& prefix, std::map< std::string,std::vector<std::string> > &vars, const std::string &dst, const std::string &src)
-{
-    if (vars.find(prefix + dst) == vars.cend()) {
-        const auto &it = vars.find(prefix + src);
-        if (it != vars.cend()) vars[prefix + dst] = it->second;
+bool NUTDevice::physicsNumber(const std::string& name, double& number) const {
+    const NUTPhysicalValue *physics = _physics.find(NUTKeys::instance().find(name));
+    if( ! physics || ! physics->numeric ) return false;
+    number = physics->number;
+    return true;
+}
+
+void NUTDevice::clear() {
+    _payloadHash = 0;
+    _pending.clear();
+    _outlets.clear();
+    if( ! _inventory.empty() || ! _physics.empty() ) {
+        _inventory.clear();
+        _physics.clear();
+        log_error("Dropping all measurement/inventory data for %s", _assetName.c_str() );
     }
 }
 
-void NUTDevice::NUTRealpowerFromOutput (const std::string& prefix, std::map< std::string,std::vector<std::string> > &vars) {
+NUTDevice::~NUTDevice() {
 
-    if (vars.find (prefix + "ups.realpower") != vars.end()) { return; }
+}
 
-    // use outlet.realpower if exists
-    if (vars.find (prefix + "outlet.realpower") != vars.end()) {
-        NUTSetIfNotPresent (prefix, vars, "ups.realpower", "outlet.realpower");
-        log_debug("realpower of %s taken from outlet.realpower", _assetName.c_str ());
-        return;
-    }
-    // sum the output.Lx.realpower
-    if (vars.find (prefix + "output.L1.realpower") != vars.end ()) {
-        int phases = 1;
-        if (vars.find (prefix + "output.phases") != vars.end ()) {
-            try {
-                phases = std::stoi (vars [prefix + "output.phases"][0]);
-            } catch(...) { }
+NUTDeviceList::NUTDeviceList() {
+
+}
+
+void NUTDeviceList::updateDeviceList(nut_t * deviceState) {
+    try {
+        if (!deviceState) return;
+        zlist_t *devices = nut_get_powerdevices (deviceState);
+        if (!devices) return;
+
+        // assets with an IP, in one pass, and daisy chain masters among them;
+        // the state does not tell which asset the message changed, so all of
+        // them are walked, the devices themselves are only touched if needed
+        std::vector<std::pair<std::string, int>> assets;
+        std::map<std::string, std::string> masters;
+        {
+            const char *name = (char *)zlist_first(devices);
+            while (name) {
+                const char* ip = nut_asset_ip (deviceState, name);
+                if (!ip || streq (ip, "")) {
+                    // this is strange. No IP?
+                    name = (char *)zlist_next(devices);
+                    continue;
+                }
+                const char* chain_str = nut_asset_daisychain (deviceState, name);
+                int chain = 0;
+                if (chain_str) try { chain = std::stoi (chain_str); } catch(...) {};
+                if (chain_str && (streq (chain_str,"") || streq (chain_str,"1"))) {
+                    // this is master
+                    masters[name] = ip;
+                }
+                assets.emplace_back (name, chain);
+                name = (char *)zlist_next(devices);
+            }
         }
-        double sum = 0.0;
-        for (int i=1; i<= phases; i++) {
-            auto it = vars.find (prefix + "output.L" + std::to_string(i) + ".realpower");
+        zlist_destroy (&devices);
 
-            if (it  == vars.end ()) {
-                it = vars.find (prefix + "ups.L" + std::to_string(i) + ".realpower");
+        // ip->master map follows the masters that came, moved or left
+        for (auto it = _masterIps.begin (); it != _masterIps.end (); ) {
+            auto master = masters.find (it->first);
+            if (master != masters.end () && master->second == it->second) {
+                ++it;
+                continue;
+            }
+            auto entry = _ip2master.find (it->second);
+            if (entry != _ip2master.end () && entry->second == it->first) _ip2master.erase (entry);
+            it = _masterIps.erase (it);
+        }
+        for (const auto &master : masters) {
+            if (_masterIps.emplace (master.first, master.second).second) _ip2master[master.second] = master.first;
+        }
 
-                if (it  == vars.end ()) {
-                    // even output is missing, can't compute
-                        break;
+        // devices keep their values, flags and schedule unless they moved
+        // to another NUT device or chain index
+        int64_t now = zclock_mono ();
+        if (_wheel.size () == 0) _wheel.start (now);
+        std::set<std::string> present;
+        // NUT devices left by removed or moved assets, their circuits may go
+        std::set<std::string> left;
+        size_t added = 0, rekeyed = 0, removed = 0;
+        for (const auto &asset : assets) {
+            const char *name = asset.first.c_str ();
+            int chain = asset.second;
+            std::string nutName = name;
+            if (chain > 1) {
+                const char* ip = nut_asset_ip (deviceState, name);
+                const auto master_it = _ip2master.find (ip);
+                if (master_it == _ip2master.cend()) {
+                    log_error ("Daisychain host for %s not found", name);
+                    continue;
                 }
+                nutName = master_it->second;
             }
-            try {
-                sum += std::stod (it->second[0]);
-            } catch(...) {
-                break;
+            int index = chain < 0 ? 0 : chain;
+            present.insert (asset.first);
+            auto it = _devices.find (asset.first);
+            if (it == _devices.end () || it->second.nutName () != nutName || it->second.daisyChainIndex () != index) {
+                if (it == _devices.end ()) ++added; else { ++rekeyed; left.insert (it->second.nutName ()); }
+                _devices[asset.first] = NUTDevice(asset.first, nutName, index);
+                _changedDevices.erase (asset.first);
+                int64_t phase = NUTTimerWheel::phase (nutName, _pollingInterval);
+                _wheel.schedule (asset.first, NUTTimerWheel::align (now, phase, _pollingInterval));
+            }
+            NUTDevice &device = _devices[asset.first];
+            if (chain <= 1) {
+                // upsd serving the device and its chain, hashed if not given
+                const char *upsd = nut_asset_get_string (deviceState, name, NUT_ENDPOINT_ATTRIBUTE);
+                NUTEndpoints::instance ().assign (name, upsd ? upsd : "");
             }
+            else {
+                // may have been a master before
+                NUTEndpoints::instance ().assign (name, "");
+            }
+            // other ext attributes, a changed one makes the next payload count
+            for (const auto attr : {"max_current", "max_power"}) {
+                const char *p = nut_asset_get_string (deviceState, name, attr);
+                if (p) {
+                    device.assetExtAttribute (attr, p);
+                } else {
+                    device.assetExtAttribute (attr, "");
+                }
+            }
+            // rules of mapping.conf tell devices apart by it
+            const char *subtype = nut_asset_subtype (deviceState, name);
+            device.assetExtAttribute ("subtype", subtype ? subtype : "");
+            // polling class, NUTQos::lowPriority () tells which can wait
+            // when polling is overloaded
+            NUTQosLevel qos = NUTQos::parse (nut_asset_get_string (deviceState, name, NUT_QOS_ATTRIBUTE));
+            device.qos (qos);
+            // metrics sampled between polls
+            const char *sampling = nut_asset_get_string (deviceState, name, NUT_SAMPLER_ATTRIBUTE);
+            _sampler.configure (name, sampling ? sampling : "");
         }
-        // we have sum
-        log_debug("realpower of %s calculated as sum of output.Lx.realpower", _assetName.c_str ());
-        std::vector<std::string> value;
-        value.push_back (itof (round (sum * 100)));
-        vars[prefix + "ups.realpower"] = value;
-        return;
+        for (auto it = _devices.begin (); it != _devices.end (); ) {
+            if (present.count (it->first)) {
+                ++it;
+                continue;
+            }
+            _wheel.cancel (it->first);
+            _changedDevices.erase (it->first);
+            left.insert (it->second.nutName ());
+            if (it->second.nutName () == it->first) {
+                // the device pinned its chain to an endpoint
+                NUTEndpoints::instance ().assign (it->first, "");
+            }
+            it = _devices.erase (it);
+            ++removed;
+        }
+        for (const auto &device : _devices) {
+            left.erase (device.second.nutName ());
+        }
+        for (const auto &nutName : left) {
+            NUTCircuitBreaker::instance ().reset (nutName);
+        }
+        for (const auto &asset : _sampler.assets ()) {
+            if (! _devices.count (asset)) _sampler.configure (asset, "");
+        }
+        if (added || rekeyed || removed) {
+            log_info ("device list: %zu added, %zu moved, %zu removed, %zu kept",
+                      added, rekeyed, removed, _devices.size () - added - rekeyed);
+        }
+    } catch (const std::exception& e) {
+        log_error ("exception while configuring device: %s", e.what ());
     }
+}
 
-    // if we have outlets, sum them
-    if (vars.find (prefix + "outlet.1.realpower") != vars.end()) {
-        double sum = 0.0;
-        int count = 100;
-        auto cntit = vars.find (prefix + "outlet.count");
-        if (cntit != vars.end()) {
-            try {
-                count = std::stoi(cntit->second[0]);
-            } catch(...) {}
-        }
-        for (int outlet = 1; outlet <= count; outlet++) {
-            auto it = vars.find (prefix + "outlet." + std::to_string(outlet) + ".realpower");
-            if (it  == vars.end ()) {
-                // end of outlets
-                break;
-            }
-            try {
-                sum += std::stod (it->second[0]);
-            } catch(...) {}
+
+void NUTDeviceList::scheduleAll (int64_t now)
+{
+    _wheel.clear ();
+    _wheel.start (now);
+    for (const auto &device : _devices) {
+        // members of a daisy chain share the phase of their NUT device
+        int64_t phase = NUTTimerWheel::phase (device.second.nutName (), _pollingInterval);
+        _wheel.schedule (device.first, NUTTimerWheel::align (now, phase, _pollingInterval));
+    }
+}
+
+void NUTDeviceList::pollingInterval (int64_t interval)
+{
+    if (interval <= 0 || interval == _pollingInterval) return;
+    _pollingInterval = interval;
+    scheduleAll (zclock_mono ());
+}
+
+int64_t NUTDeviceList::pollTimeout ()
+{
+    // devices skipped by the budget should not wait for their phase
+    if (!_carriedOver.empty ()) return 0;
+    int64_t now = zclock_mono ();
+    int64_t timeout = _wheel.timeout (now);
+    if (timeout < 0 || timeout > _pollingInterval) timeout = _pollingInterval;
+    if (_statusInterval > 0 && ! _statusVariables.empty ()) {
+        timeout = std::min (timeout, std::max <int64_t> (0, _nextStatus - now));
+    }
+    if (_samplingInterval > 0 && ! _samplingVariables.empty ()) {
+        timeout = std::min (timeout, std::max <int64_t> (0, _nextSample - now));
+    }
+    return timeout;
+}
+
+std::vector <NUTDevice *> NUTDeviceList::updateDeviceStatus( bool forceUpdate ) {
+    // take devices skipped last time first ...
+    int64_t now = zclock_mono ();
+    std::vector<NUTDevice *> fired;
+    std::vector<NUTDevice *> due;
+    std::vector<NUTPollRequest> requests;
+    std::set<std::string> carriedOver (_carriedOver.begin (), _carriedOver.end ());
+    _carriedOver.clear ();
+    for (const auto &name : carriedOver) {
+        auto it = _devices.find (name);
+        if (it == _devices.end ()) continue;
+        fired.push_back (&it->second);
+        due.push_back (&it->second);
+    }
+
+    // ... (what consumers want changed, fetch all again to see what they want now) ...
+    if (_interest && _interest->generation () != _interestGeneration) {
+        _interestGeneration = _interest->generation ();
+        for (auto &device : _devices) {
+            device.second.forgetSchema ();
         }
-        log_debug("realpower of %s calculated as sum of outlet.X.realpower", _assetName.c_str ());
-        std::vector<std::string> value;
-        value.push_back (itof (round (sum * 100)));
-        vars[prefix + "ups.realpower"] = value;
-        return;
     }
 
-    // mainly for STS/ATS - if we have output voltage and current let's multiply them
+    // ... then devices whose phase came ...
+    auto &breaker = NUTCircuitBreaker::instance ();
+    std::map<std::string, bool> allowedNow;
+    for (const auto &name : _wheel.advance (now)) {
+        auto it = _devices.find (name);
+        if (it == _devices.end ()) continue;
+        // same phase in the next interval
+        int64_t phase = NUTTimerWheel::phase (it->second.nutName (), _pollingInterval);
+        _wheel.schedule (name, NUTTimerWheel::align (now + 1, phase, _pollingInterval));
+        if (carriedOver.count (name)) continue;
+        fired.push_back (&it->second);
+        if (! it->second.due (now, _pollingInterval / 2)) {
+            ++_deferredCount;
+            continue;
+        }
+        auto allowed = allowedNow.find (it->second.nutName ());
+        if (allowed == allowedNow.end ()) {
+            // asked once for the whole chain, a probe must not be refused to its own chain
+            allowed = allowedNow.emplace (it->second.nutName (), breaker.allow (it->second.nutName (), now)).first;
+        }
+        if (! allowed->second) {
+            // failed repeatedly, wait for the probe
+            reschedule (it->second, now, true);
+            if( time(NULL) - it->second.lastUpdate() > NUT_MEASUREMENT_REPEAT_AFTER/2 ) {
+                it->second.clear();
+            }
+            continue;
+        }
+        due.push_back (&it->second);
+    }
+    // ... group them by NUT device, a daisy chain is fetched once for all
+    // its members ...
+    std::vector<std::vector<NUTDevice *>> chains;
     {
-        auto it_current = vars.find (prefix + "output.current");
-        auto it_voltage = vars.find (prefix + "output.voltage");
-        if ((it_current != vars.end ()) && (it_voltage != vars.end ())) {
-            try {
-                double power = std::stod (it_current->second[0]) * std::stod (it_voltage->second[0]);
-                std::vector<std::string> value;
-                value.push_back (itof (round (power * 100)));
-                vars[prefix + "ups.realpower"] = value;
-                log_debug ("ats, realpower");
-                return;
-            } catch(...) {
-                zsys_error ("Exception in power = current*voltage calculation");
+        std::map<std::string, size_t> chainIndex;
+        for (const auto device : due) {
+            auto inserted = chainIndex.emplace (device->nutName (), chains.size ());
+            if (inserted.second) chains.emplace_back ();
+            chains[inserted.first->second].push_back (device);
+        }
+    }
+    // ... those with a live driver socket have their variables already ...
+    syncDriverSockets (now);
+    std::map<std::string, std::map<std::string, std::vector<std::string>>> pushed;
+    if (! _driverSockets.empty ()) {
+        std::vector<std::vector<NUTDevice *>> fetched;
+        for (auto &chain : chains) {
+            auto driver = _driverSockets.find (chain.front ()->nutName ());
+            if (driver == _driverSockets.end () || ! driver->second->ready ()) {
+                fetched.push_back (std::move (chain));
+                continue;
+            }
+            const auto &vars = driver->second->variables ();
+            pushed[driver->first] = vars;
+            breaker.success (driver->first);
+            _polledCount += chain.size ();
+            for (const auto device : chain) {
+                if (! _sampler.empty ()) learnSampling (*device, vars, now);
+                try {
+                    if (device->update (s_chain_variables (vars, device->daisyPrefix ()), _mapping, forceUpdate)) ++_payloadMisses; else ++_payloadHits;
+                    markChanged (*device);
+                } catch ( std::exception &e ) {
+                    log_error("Update of %s from its driver failed (%s)", device->assetName().c_str(), e.what() );
+                }
+                reschedule (*device, now);
             }
         }
+        chains.swap (fetched);
     }
-}
-
-void NUTDevice::NUTFixMissingLoad (const std::string& prefix, std::map< std::string,std::vector<std::string> > &vars) {
-    if (vars.find (prefix + "ups.load") != vars.end ()) return;
-    try {
-        if (vars [prefix + "output.phases"][0] == "1") {
-            // 1 phase ups
-            {
-                // try realpower/max_power*100
-                const auto max_power_it = _assetExtAttributes.find ("max_power");
-                if (max_power_it != _assetExtAttributes.cend ()) {
-                    double max_power = stod (max_power_it->second) * 1000;
-                    const auto realpower_it = vars.find (prefix + "ups.realpower");
-                    if (realpower_it != vars.cend ()) {
-                        double realpower = std::stod (realpower_it->second[0]);
-                        if (max_power > 0.1) {
-                            std::string load = std::to_string (round ((realpower / max_power) * 100.0));
-                            vars["ups.load"] = { load };
-                            return;
-                        }
+    auto &endpoints = NUTEndpoints::instance ();
+    for (const auto &chain : chains) {
+        // the chain goes in the class of its most important member
+        const auto &qos = s_chain_class (chain);
+        NUTPollRequest request { chain.front ()->nutName (), {}, endpoints.lookup (chain.front ()->nutName ()).toString (), qos.priority, qos.workerShare };
+        if (_selectiveFetch) {
+            // union of the schemas, all variables if any member has to learn
+            std::set<std::string> variables;
+            for (const auto device : chain) {
+                if (! schemaUsable (*device, now) || device->schema ().empty ()) {
+                    variables.clear ();
+                    break;
+                }
+                variables.insert (device->schema ().begin (), device->schema ().end ());
+            }
+            if (! variables.empty () && _overload.level () >= NUTOverloadLevel::OUTLETS) {
+                // outlets keep their last values between stretched reads, their status
+                // and thresholds the alert actor reads from the snapshot do not wait
+                int64_t &outletsRead = _outletsRead[request.name];
+                if (now - outletsRead < _pollingInterval * NUT_OVERLOAD_STRETCH) {
+                    for (auto it = variables.begin (); it != variables.end (); ) {
+                        if (s_is_outlet (*it) && ! s_is_alert (*it)) it = variables.erase (it);
+                        else ++it;
                     }
                 }
+                else {
+                    outletsRead = now;
+                }
             }
-        } else {
-            // 3 phase ups
-            {
-                // try ups.LX.load
-                const auto it1 = vars.find (prefix + "ups.L1.load");
-                const auto it2 = vars.find (prefix + "ups.L2.load");
-                const auto it3 = vars.find (prefix + "ups.L3.load");
-                if ((it1 != vars.cend ()) && (it2 != vars.cend ()) && (it2 != vars.cend ())) {
-                    std::string load = std::to_string(
-                        (std::stod (it1->second[0]) + std::stod (it2->second[0]) + std::stod (it3->second[0]))/3.0
-                    );
-                    vars["ups.load"] = { load };
-                    return;
+            request.variables.assign (variables.begin (), variables.end ());
+        }
+        requests.push_back (std::move (request));
+    }
+
+    // ... fetch in parallel the ones due by their adaptive interval ...
+    auto results = _poller.fetch (requests, _fetchDeadline, std::min (_cycleBudget, _pollingInterval));
+    _fetchCount += requests.size ();
+
+    // alert and sensor actors read the same variables from the snapshot,
+    // collected over one interval so they keep their pace
+    if (!_cycleSnapshot) {
+        _cycleSnapshot = std::make_shared <NUTSnapshot> ();
+        _cycleStart = now;
+    }
+    for (size_t i = 0; i < requests.size (); ++i) {
+        if (results[i].ok) {
+            auto &vars = _cycleSnapshot->devices[requests[i].name];
+            for (const auto &item : results[i].vars) {
+                vars[item.first] = item.second;
+            }
+        }
+    }
+    for (const auto &item : pushed) {
+        _cycleSnapshot->devices[item.first] = item.second;
+    }
+    if (now - _cycleStart >= _pollingInterval) {
+        NUTSnapshotBus::instance ().publish (_cycleSnapshot);
+        _cycleSnapshot.reset ();
+        // once an interval, workers of endpoints no device uses anymore go
+        std::set<std::string> inUse;
+        for (const auto &device : _devices) {
+            inUse.insert (endpoints.lookup (device.second.nutName ()).toString ());
+        }
+        _poller.retain (inUse);
+        _statusPoller.retain (inUse);
+    }
+
+    // ... and merge here, NUTDevice is not thread safe
+    size_t skipped = 0;
+    for (size_t i = 0; i < chains.size (); ++i) {
+        const auto &chain = chains[i];
+        const std::string &nutName = requests[i].name;
+        auto &result = results[i];
+        if (result.skipped) {
+            // keeps last values, goes first next time
+            for (const auto device : chain) {
+                _carriedOver.push_back (device->assetName ());
+            }
+            skipped += chain.size ();
+            continue;
+        }
+        _polledCount += chain.size ();
+        if (result.timedOut) {
+            // keeps last values, asked again at its next phase
+            log_warning ("%s did not answer in time (%s)", nutName.c_str (), result.error.c_str ());
+            ++_timeoutCount;
+            breaker.failure (nutName, result.error, now);
+            for (const auto device : chain) {
+                device->forgetSchema ();
+                reschedule (*device, now, true);
+            }
+            continue;
+        }
+        if (! result.ok) {
+            log_error("Communication problem with %s (%s)", nutName.c_str(), result.error.c_str() );
+            if (! result.unreachable) breaker.failure (nutName, result.error, now);
+            for (const auto device : chain) {
+                // driver may come back with other variables
+                device->forgetSchema ();
+                // try again next cycle of its class
+                reschedule (*device, now, true);
+                if( time(NULL) - device->lastUpdate() > NUT_MEASUREMENT_REPEAT_AFTER/2 ) {
+                    // we are not communicating for a while. Let's drop the values.
+                    device->clear();
                 }
             }
-            {
-                // try sum(realpower_i)/max_power*100
-                const auto max_power_it = _assetExtAttributes.find ("max_power");
-                if (max_power_it != _assetExtAttributes.cend ()) {
-                    double max_power = stod (max_power_it->second) * 1000;
-                    if (max_power > 0.1) {
-                        const auto it1 = vars.find (prefix + "output.L1.realpower");
-                        const auto it2 = vars.find (prefix + "output.L2.realpower");
-                        const auto it3 = vars.find (prefix + "output.L3.realpower");
-                        if ((it1 != vars.cend ()) && (it2 != vars.cend ()) && (it2 != vars.cend ())) {
-                            std::string load = std::to_string(
-                                round ((std::stod (it1->second[0]) + std::stod (it2->second[0]) + std::stod (it3->second[0]))/max_power*100.0)
-                            );
-                            vars["ups.load"] = { load };
-                            return;
-                        }
+            continue;
+        }
+        breaker.success (nutName);
+        _variableCount += result.vars.size ();
+        // its driver socket is named after it
+        auto driverName = result.vars.find ("driver.name");
+        if (driverName != result.vars.end () && ! driverName->second.empty ()) {
+            _driverNames[nutName] = driverName->second[0];
+        }
+        // the status lane reads what the full read has seen
+        {
+            auto &statusVariables = _statusVariables[nutName];
+            auto &statusValues = _statusValues[nutName];
+            statusVariables.clear ();
+            statusValues.clear ();
+            for (const auto &item : result.vars) {
+                if (! s_is_status (item.first)) continue;
+                statusVariables.insert (item.first);
+                statusValues.insert (item);
+            }
+        }
+        // some variables are gone, the driver may have restarted
+        bool vanished = ! requests[i].variables.empty () && result.vars.size () < requests[i].variables.size ();
+        for (const auto device : chain) {
+            if (_selectiveFetch) {
+                if (vanished) {
+                    device->forgetSchema ();
+                }
+                else if (! schemaUsable (*device, now)) {
+                    std::function <bool (const std::string&)> wanted;
+                    if (_interest && _interest->enabled ()) {
+                        const std::string asset = device->assetName ();
+                        NUTInterest *interest = _interest;
+                        wanted = [interest, asset] (const std::string& metric) { return interest->wanted (metric, asset); };
                     }
+                    device->learnSchema (result.vars, _mapping, now, wanted);
+                    ++_learnCount;
                 }
             }
+            if (! _sampler.empty ()) learnSampling (*device, result.vars, now);
+            try {
+                bool updated;
+                if (chain.size () == 1) {
+                    updated = device->update( std::move (result.vars), _mapping, forceUpdate );
+                }
+                else {
+                    updated = device->update( s_chain_variables (result.vars, device->daisyPrefix ()), _mapping, forceUpdate );
+                }
+                if (updated) ++_payloadMisses; else ++_payloadHits;
+                markChanged (*device);
+                reschedule (*device, now);
+            } catch ( std::exception &e ) {
+                log_error("Communication problem with %s (%s)", device->assetName().c_str(), e.what() );
+                reschedule (*device, now, true);
+            }
         }
-    } catch (...) {
-        zsys_error ("failed to calculate load for %s", _assetName.c_str ());
     }
+    if (skipped) {
+        log_warning ("polling budget of %" PRIi64 " ms exhausted, %zu devices carried over",
+                     std::min (_cycleBudget, _pollingInterval), skipped);
+        _skippedCount += skipped;
+        ++_overrunCount;
+    }
+    _overload.record (skipped > 0, now, _pollingInterval);
+    return fired;
 }
 
-void NUTDevice::NUTValuesTransformation (const std::string &prefix, std::map< std::string,std::vector<std::string> > &vars ) {
-    if( vars.empty() ) return ;
+void NUTDeviceList::reschedule (NUTDevice& device, int64_t now, bool failed) const
+{
+    const auto &qos = NUTQos::schedule (device.qos ());
+    int64_t base = _pollingInterval * qos.intervalFactor;
+    int64_t ceiling = _pollingInterval * qos.ceilingFactor;
+    if (device.lowPriority () && _overload.level () >= NUTOverloadLevel::DEVICES) {
+        base = std::max (base, _pollingInterval * NUT_OVERLOAD_STRETCH);
+    }
+    // a failed read is not stretched, nor retried sooner than its class is read
+    device.reschedule (now, base, failed ? base : std::max (ceiling, base));
+}
 
-    // number of input phases
-    if (vars.find (prefix + "input.phases") == vars.end ()) {
-        if ( vars.find (prefix + "input.L3-N.voltage") != vars.end () || vars.find (prefix + "input.L3.current") != vars.end () ) {
-            vars [prefix + "input.phases"] = { "3" };
-        } else {
-            vars [prefix + "input.phases"] = { "1" };
+bool NUTDeviceList::schemaUsable (const NUTDevice& device, int64_t now) const
+{
+    if (device.schemaValid (now)) return true;
+    // relearning reads all variables, a refresh to give up first
+    return _overload.level () >= NUTOverloadLevel::INVENTORY && device.schemaLearned () && ! device.schema ().empty ();
+}
+
+void NUTDeviceList::driverSockets (bool enabled, const std::string& stateDir)
+{
+    if (enabled != _driverSocketsEnabled || stateDir != _driverStatePath) {
+        for (auto &driver : _driverSockets) {
+            retireDriver (driver.second);
         }
+        _driverSockets.clear ();
+        _driverScan = 0;
     }
+    _driverSocketsEnabled = enabled;
+    _driverStatePath = stateDir;
+}
 
-    // number of output phases
-    if (vars.find (prefix + "output.phases") == vars.end ()) {
-        if ( vars.find (prefix + "output.L3-N.voltage") != vars.end () || vars.find (prefix + "output.L3.current") != vars.end () ) {
-            vars [prefix + "output.phases"] = { "3" };
-        } else {
-            vars [prefix + "output.phases"] = { "1" };
+void NUTDeviceList::syncDriverSockets (int64_t now)
+{
+    if (! _driverSocketsEnabled) return;
+    std::set<std::string> nutNames;
+    for (const auto &device : _devices) {
+        nutNames.insert (device.second.nutName ());
+    }
+    for (auto it = _driverSockets.begin (); it != _driverSockets.end (); ) {
+        if (nutNames.count (it->first) && ! (it->second && it->second->isLost ())) {
+            ++it;
+            continue;
         }
+        retireDriver (it->second);
+        it = _driverSockets.erase (it);
     }
-    {
-        // pdu replace with epdu
-        auto it = vars.find (prefix + "device.type");
-        if( it != vars.end() ) {
-            if( ! it->second.empty() && it->second[0] == "pdu" ) it->second[0] = "epdu";
+    if (_driverScan != 0 && now - _driverScan < NUT_DRIVER_RECONNECT_MS) return;
+    _driverScan = now;
+    for (const auto &nutName : nutNames) {
+        auto &driver = _driverSockets[nutName];
+        if (driver && driver->isConnected ()) continue;
+        // socket is named after the driver seen by the last read from upsd
+        auto driverName = _driverNames.find (nutName);
+        std::string path = driverName == _driverNames.end () ? "" :
+            NUTDriverSocket::find (_driverStatePath, driverName->second, nutName);
+        if (path.empty ()) {
+            retireDriver (driver);
+            continue;
+        }
+        if (! driver || driver->path () != path) {
+            retireDriver (driver);
+            driver.reset (new NUTDriverSocket (path));
+        }
+        if (driver->connect ()) {
+            log_info ("reading %s from driver socket %s", nutName.c_str (), path.c_str ());
         }
     }
-    // sum the realpower from output information
-    NUTRealpowerFromOutput (prefix, vars);
-    // variables, that differs from ups to ups
-    NUTSetIfNotPresent (prefix, vars, "ups.realpower", "input.realpower");
-    NUTSetIfNotPresent (prefix, vars, "input.L1.realpower", "input.realpower");
-    NUTSetIfNotPresent (prefix, vars, "input.L1.realpower", "ups.realpower");
-    NUTSetIfNotPresent (prefix, vars, "output.L1.realpower", "output.realpower");
-    // take input realpower and present it as output if output is not present
-    // and also the opposite way
-    for( const auto &variable: {"realpower", "L1.realpower", "L2.realpower", "L3.realpower"} ) {
-        std::string outvar = "output."; outvar.append (variable);
-        std::string invar = "input."; invar.append(variable);
-        NUTSetIfNotPresent (prefix, vars, outvar, invar);
-        NUTSetIfNotPresent (prefix, vars, invar, outvar);
-    }
-    // sum the realpower again if still not present
-    // hope that missing output values have been filled
-    // from input values
-    NUTRealpowerFromOutput (prefix, vars);
-    // ups load
-    NUTFixMissingLoad (prefix, vars);
 }
 
-void NUTDevice::clear() {
-    if( ! _inventory.empty() || ! _physics.empty() ) {
-        _inventory.clear();
-        _physics.clear();
-        log_error("Dropping all measurement/inventory data for %s", _assetName.c_str() );
-    }
+void NUTDeviceList::retireDriver (std::unique_ptr <NUTDriverSocket> &driver)
+{
+    if (! driver) return;
+    // open descriptors wait for the caller to take them out of its poller
+    if (*driver->handle () >= 0) _retiredDrivers.push_back (std::move (driver));
+    driver.reset ();
 }
 
-NUTDevice::~NUTDevice() {
-
+std::vector <int *> NUTDeviceList::retiredDriverHandles ()
+{
+    std::vector <int *> handles;
+    for (auto &driver : _retiredDrivers) {
+        handles.push_back (driver->handle ());
+    }
+    return handles;
 }
 
-NUTDeviceList::NUTDeviceList() {
+void NUTDeviceList::closeRetiredDrivers ()
+{
+    _retiredDrivers.clear ();
+}
 
+std::vector <int *> NUTDeviceList::driverHandles ()
+{
+    std::vector <int *> handles;
+    for (auto &driver : _driverSockets) {
+        if (driver.second && driver.second->isConnected ()) {
+            handles.push_back (driver.second->handle ());
+        }
+    }
+    return handles;
 }
 
-void NUTDeviceList::updateDeviceList(nut_t * deviceState) {
-    try {
-        if (!deviceState) return;
-        zlist_t *devices = nut_get_powerdevices (deviceState);
-        if (!devices) return;
+uint64_t NUTDeviceList::driverConnected () const
+{
+    uint64_t connected = 0;
+    for (const auto &driver : _driverSockets) {
+        if (driver.second && driver.second->isConnected ()) ++connected;
+    }
+    return connected;
+}
 
-        _devices.clear();
-        std::map<std::string, std::string> ip2master;
-        {
-            // make ip->master map
-            const char *name = (char *)zlist_first(devices);
-            while (name) {
-                const char* ip = nut_asset_ip (deviceState, name);
-                const char* chain = nut_asset_daisychain (deviceState, name);
-                if (ip == NULL || chain == NULL || streq (ip, "") ) {
-                    // this is strange. No IP?
-                    name = (char *)zlist_next(devices);
-                    continue;
-                }
-                if (streq (chain,"") || streq (chain,"1")) {
-                    // this is master
-                    ip2master[ip] = name;
-                }
-                name = (char *)zlist_next(devices);
+std::vector <NUTDevice *> NUTDeviceList::onDriverEvent (int *handle)
+{
+    std::vector <NUTDevice *> updated;
+    auto driver = _driverSockets.begin ();
+    while (driver != _driverSockets.end () && ! (driver->second && driver->second->handle () == handle)) {
+        ++driver;
+    }
+    if (driver == _driverSockets.end ()) return updated;
+    if (! driver->second->receive ()) {
+        log_warning ("lost driver socket of %s, reading it from upsd", driver->first.c_str ());
+        retireDriver (driver->second);
+        _driverSockets.erase (driver);
+        return updated;
+    }
+    if (! driver->second->takeChanged ()) return updated;
+
+    ++_driverEvents;
+    const auto &vars = driver->second->variables ();
+    int64_t now = zclock_mono ();
+    for (auto &device : _devices) {
+        if (device.second.nutName () != driver->first) continue;
+        // every change the driver pushes is a sample
+        auto sampled = _samplingVariables.find (device.first);
+        if (sampled != _samplingVariables.end ()) sample (device.first, sampled->second, vars, now);
+        try {
+            if (device.second.update (s_chain_variables (vars, device.second.daisyPrefix ()), _mapping, true)) {
+                ++_payloadMisses;
+                markChanged (device.second);
+                updated.push_back (&device.second);
+            }
+            else {
+                ++_payloadHits;
             }
+        } catch ( std::exception &e ) {
+            log_error("Update of %s from its driver failed (%s)", device.first.c_str(), e.what() );
         }
-        {
-            const char *name = (char *)zlist_first(devices);
-            while (name) {
-                const char* ip = nut_asset_ip (deviceState, name);
-                if (!ip || streq (ip, "")) {
-                    // this is strange. No IP?
-                    name = (char *)zlist_next(devices);
-                    continue;
-                }
-                const char* chain_str = nut_asset_daisychain (deviceState, name);
-                int chain = 0;
-                if (chain_str) try { chain = std::stoi (chain_str); } catch(...) {};
-                switch(chain) {
-                case 0:
-                    _devices[name] = NUTDevice(name);
-                    break;
-                case 1:
-                    _devices[name] = NUTDevice(name, name, 1);
-                    break;
-                default:
-                    const auto master_it = ip2master.find (ip);
-                    if (master_it == ip2master.cend()) {
-                        log_error ("Daisychain host for %s not found", name);
-                    } else {
-                        _devices[name] = NUTDevice(name, master_it->second.c_str (), chain);
-                    }
-                    break;
-                }
-                // other ext attributes
-                for (const auto attr : {"max_current", "max_power"}) {
-                    const char *p = nut_asset_get_string (deviceState, name, attr);
-                    if (p) {
-                        _devices[name].assetExtAttribute (attr, p);
-                    } else {
-                        _devices[name].assetExtAttribute (attr, "");
-                    }
+    }
+    return updated;
+}
+
+std::vector <NUTDevice *> NUTDeviceList::updateStatus ()
+{
+    std::vector <NUTDevice *> changed;
+    int64_t now = zclock_mono ();
+    if (_statusInterval <= 0 || now < _nextStatus) return changed;
+    _nextStatus = now + _statusInterval;
+
+    std::map<std::string, std::vector<NUTDevice *>> chains;
+    for (auto &device : _devices) {
+        chains[device.second.nutName ()].push_back (&device.second);
+    }
+    auto &breaker = NUTCircuitBreaker::instance ();
+    auto &endpoints = NUTEndpoints::instance ();
+    std::vector<NUTPollRequest> requests;
+    for (auto it = _statusVariables.begin (); it != _statusVariables.end (); ) {
+        const std::string &nutName = it->first;
+        if (! chains.count (nutName)) {
+            _statusValues.erase (nutName);
+            it = _statusVariables.erase (it);
+            continue;
+        }
+        auto driver = _driverSockets.find (nutName);
+        bool pushed = driver != _driverSockets.end () && driver->second && driver->second->ready ();
+        // failing devices are left to the probes of the full read
+        if (! it->second.empty () && ! pushed && breaker.state (nutName) == NUTCircuitState::CLOSED) {
+            const auto &qos = s_chain_class (chains[nutName]);
+            requests.push_back (NUTPollRequest { nutName, { it->second.begin (), it->second.end () }, endpoints.lookup (nutName).toString (), qos.priority, qos.workerShare });
+        }
+        ++it;
+    }
+    if (requests.empty ()) return changed;
+
+    auto results = _statusPoller.fetch (requests, std::min (_fetchDeadline, _statusInterval), _statusInterval);
+    _statusPolls += requests.size ();
+
+    bool published = false;
+    for (size_t i = 0; i < requests.size (); ++i) {
+        const std::string &nutName = requests[i].name;
+        const auto &result = results[i];
+        if (! result.ok) {
+            // the full read decides what a failure means
+            log_debug ("status of %s not read (%s)", nutName.c_str (), result.error.c_str ());
+            continue;
+        }
+        auto &statusValues = _statusValues[nutName];
+        for (const auto &item : result.vars) {
+            auto &values = statusValues[item.first];
+            if (values == item.second) continue;
+            values = item.second;
+            published = true;
+        }
+        for (const auto device : chains[nutName]) {
+            try {
+                if (device->updateStatus (s_chain_variables (result.vars, device->daisyPrefix ()), _mapping)) {
+                    ++_statusChanges;
+                    // a stretched interval must not delay the full read of the new state
+                    reschedule (*device, now);
+                    markChanged (*device);
+                    changed.push_back (device);
                 }
-                name = (char *)zlist_next(devices);
+            } catch ( std::exception &e ) {
+                log_error("Status update of %s failed (%s)", device->assetName().c_str(), e.what() );
             }
         }
-        zlist_destroy (&devices);
-    } catch (const std::exception& e) {
-        log_error ("exception while configuring device: %s", e.what ());
     }
+    if (published) {
+        auto snapshot = std::make_shared <NUTSnapshot> ();
+        snapshot->timestamp = now;
+        snapshot->devices.insert (_statusValues.begin (), _statusValues.end ());
+        NUTSnapshotBus::instance ().publishStatus (snapshot);
+    }
+    return changed;
 }
 
+void NUTDeviceList::learnSampling (const NUTDevice& device, const NUTVariables& vars, int64_t now)
+{
+    const std::string asset = device.assetName ();
+    const std::string prefix = device.daisyPrefix ();
+    std::map<std::string, std::string> variables;
+    if (_sampler.configured (asset)) {
+        for (const auto &item : vars) {
+            if (item.first.compare (0, prefix.size (), prefix) != 0) continue;
+            NUTKey key = _mapping.resolve (item.first.c_str () + prefix.size ()).physics;
+            if (key == NUT_KEY_NONE) continue;
+            const std::string &metric = NUTKeys::instance ().name (key);
+            if (_sampler.sampled (asset, metric)) variables.emplace (item.first, metric);
+        }
+    }
+    if (variables.empty ()) {
+        _samplingVariables.erase (asset);
+        return;
+    }
+    sample (asset, variables, vars, now);
+    _samplingVariables[asset].swap (variables);
+}
 
-void NUTDeviceList::updateDeviceStatus( bool forceUpdate ) {
-    for(auto &device : _devices ) {
+void NUTDeviceList::sample (const std::string& asset, const std::map <std::string, std::string>& variables,
+                            const NUTVariables& vars, int64_t now)
+{
+    for (const auto &variable : variables) {
+        auto value = vars.find (variable.first);
+        if (value == vars.end () || value->second.size () != 1) continue;
         try {
-            nutclient::Device nutDevice = nutClient.getDevice(device.second.nutName());
-            if (! nutDevice.isOk()) { throw std::runtime_error ("device " + device.second.assetName() + " is not configured in NUT yet"); }
-            std::function <const std::map <std::string, std::string>&(const char *)> x = std::bind (&NUTDeviceList::get_mapping, this, std::placeholders::_1);
-            device.second.update( nutDevice.getVariableValues(), x, forceUpdate );
-        } catch ( std::exception &e ) {
-            log_error("Communication problem with %s (%s)", device.first.c_str(), e.what() );
-            if( time(NULL) - device.second.lastUpdate() > NUT_MEASUREMENT_REPEAT_AFTER/2 ) {
-                // we are not communicating for a while. Let's drop the values.
-                device.second.clear();
-            }
+            _sampler.sample (asset, variable.second, std::stod (value->second[0]), now);
+        } catch (...) {
+            // not a number, nothing to aggregate
         }
     }
 }
 
-bool NUTDeviceList::connect() {
-    try {
-        nutClient.connect("localhost",3493);
-    } catch (...) {}
-    return nutClient.isConnected();
-}
+void NUTDeviceList::updateSamples ()
+{
+    int64_t now = zclock_mono ();
+    if (_samplingInterval <= 0 || _samplingVariables.empty () || now < _nextSample) return;
+    // samples are nice to have, they give way to the full reads
+    _nextSample = now + _samplingInterval * (_overload.level () >= NUTOverloadLevel::DEVICES ? NUT_OVERLOAD_STRETCH : 1);
+
+    // NUT device name | variables sampled for its members, and the members
+    std::map<std::string, std::set<std::string>> wanted;
+    std::map<std::string, std::vector<NUTDevice *>> chains;
+    for (auto it = _samplingVariables.begin (); it != _samplingVariables.end (); ) {
+        auto device = _devices.find (it->first);
+        if (device == _devices.end ()) {
+            it = _samplingVariables.erase (it);
+            continue;
+        }
+        for (const auto &variable : it->second) {
+            wanted[device->second.nutName ()].insert (variable.first);
+        }
+        chains[device->second.nutName ()].push_back (&device->second);
+        ++it;
+    }
 
-void NUTDeviceList::disconnect() {
-    try {
-        nutClient.disconnect();
-    } catch (...) {}
-}
+    // what driver sockets hold is as fresh as it gets, upsd is asked for the rest
+    auto &breaker = NUTCircuitBreaker::instance ();
+    auto &endpoints = NUTEndpoints::instance ();
+    std::map<std::string, NUTVariables> values;
+    std::vector<NUTPollRequest> requests;
+    for (const auto &item : wanted) {
+        auto driver = _driverSockets.find (item.first);
+        if (driver != _driverSockets.end () && driver->second && driver->second->ready ()) {
+            values[item.first] = driver->second->variables ();
+            continue;
+        }
+        if (breaker.state (item.first) != NUTCircuitState::CLOSED) continue;
+        // in the class of its most important sampled member, bulk ones keep their share
+        const auto &qos = s_chain_class (chains[item.first]);
+        requests.push_back (NUTPollRequest { item.first, { item.second.begin (), item.second.end () }, endpoints.lookup (item.first).toString (), qos.priority, qos.workerShare });
+    }
+    if (! requests.empty ()) {
+        auto results = _statusPoller.fetch (requests, std::min (_fetchDeadline, _samplingInterval), _samplingInterval);
+        _samplePolls += requests.size ();
+        for (size_t i = 0; i < requests.size (); ++i) {
+            if (results[i].ok) values[requests[i].name].swap (results[i].vars);
+        }
+    }
 
-void NUTDeviceList::update( bool forceUpdate ) {
-    if( connect() ) {
-        updateDeviceStatus(forceUpdate);
-        disconnect();
+    for (const auto &sampled : _samplingVariables) {
+        auto vars = values.find (_devices[sampled.first].nutName ());
+        if (vars == values.end ()) continue;
+        sample (sampled.first, sampled.second, vars->second, now);
     }
 }
 
+std::vector <NUTDevice *> NUTDeviceList::update( bool forceUpdate ) {
+    return updateDeviceStatus(forceUpdate);
+}
+
 size_t NUTDeviceList::size() const {
     return _devices.size();
 }
@@ -785,6 +1408,11 @@ NUTDevice& NUTDeviceList::operator[](const std::string &name) {
     return _devices[name];
 }
 
+std::string NUTDeviceList::nutName (const std::string &asset) const {
+    auto it = _devices.find (asset);
+    return it == _devices.end () ? std::string () : it->second.nutName ();
+}
+
 std::map<std::string, NUTDevice>::iterator NUTDeviceList::begin() {
     return _devices.begin();
 }
@@ -794,12 +1422,34 @@ std::map<std::string, NUTDevice>::iterator NUTDeviceList::end() {
 }
 
 bool NUTDeviceList::changed() const {
-    for(auto  &it : _devices ) {
-        if(it.second.changed() ) return true;
+    for( const auto &name : _changedDevices ) {
+        const auto it = _devices.find( name );
+        if( it != _devices.end() && it->second.changed() ) return true;
     }
     return false;
 }
 
+std::vector <NUTDevice *> NUTDeviceList::changedDevices ()
+{
+    std::vector <NUTDevice *> result;
+    for (auto it = _changedDevices.begin (); it != _changedDevices.end (); ) {
+        const auto device = _devices.find (*it);
+        if (device == _devices.end () || ! device->second.changed ()) {
+            // advertised since, or gone with the asset
+            it = _changedDevices.erase (it);
+            continue;
+        }
+        result.push_back (&device->second);
+        ++it;
+    }
+    return result;
+}
+
+void NUTDeviceList::markChanged (const NUTDevice& device)
+{
+    if (device.changed ()) _changedDevices.insert (device.assetName ());
+}
+
 static void
 s_deserialize_to_map (cxxtools::SerializationInfo& si, std::map <std::string, std::string>& m) {
     for (const auto& i : si) {
@@ -819,6 +1469,25 @@ s_deserialize_to_map (cxxtools::SerializationInfo& si, std::map <std::string, st
     }
 }
 
+static void
+s_deserialize_to_vector (cxxtools::SerializationInfo& si, std::vector <std::string>& v) {
+    for (const auto& i : si) {
+        std::string temp;
+        if (i.category () != cxxtools::SerializationInfo::Category::Value) {
+            log_warning ("While reading mapping configuration - item of '%s' is not json string.", si.name ().c_str ());
+            continue;
+        }
+        try {
+            i.getValue (temp);
+        }
+        catch (const cxxtools::SerializationError& e) {
+            log_error ("Error deserializing item of '%s'", si.name ().c_str ());
+            continue;
+        }
+        v.push_back (temp);
+    }
+}
+
 void NUTDeviceList::load_mapping (const char *path_to_file)
 {
     _mappingLoaded = false;
@@ -860,9 +1529,34 @@ void NUTDeviceList::load_mapping (const char *path_to_file)
         s_deserialize_to_map (*inventoryMappingMember, _inventoryMapping);
     }
 
+    // optional, without it every change of a number is published
+    std::map <std::string, std::string> deadbands;
+    cxxtools::SerializationInfo *deadbandsMember = si.findMember ("deadbands");
+    if (deadbandsMember != NULL) {
+        s_deserialize_to_map (*deadbandsMember, deadbands);
+    }
+
+    // without rules only what the devices give is published
+    std::vector <std::string> rules;
+    cxxtools::SerializationInfo *rulesMember = si.findMember ("derivedRules");
+    if (rulesMember == NULL) {
+        log_warning ("Configuration file for mapping '%s' does not contain property 'derivedRules'", path_to_file);
+    }
+    else {
+        s_deserialize_to_vector (*rulesMember, rules);
+    }
+
     log_debug ("Number of entries loaded for physicsMapping '%zu'", _physicsMapping.size ());
     log_debug ("Number of entries loaded for inventoryMapping '%zu'", _inventoryMapping.size ());
+    log_debug ("Number of entries loaded for deadbands '%zu'", deadbands.size ());
+    log_debug ("Number of entries loaded for derivedRules '%zu'", rules.size ());
+    // compiled once, updates then walk just the variables received
+    _mapping.compile (_physicsMapping, _inventoryMapping, deadbands, rules);
     _mappingLoaded = true;
+    // the same variables may map differently now
+    for (auto &device : _devices) {
+        device.second._payloadHash = 0;
+    }
 }
 
 bool NUTDeviceList::mappingLoaded () const
@@ -883,10 +1577,6 @@ const std::map <std::string, std::string>& NUTDeviceList::get_mapping (const cha
     throw std::invalid_argument ("mapping");
 }
 
-NUTDeviceList::~NUTDeviceList() {
-    disconnect();
-}
-
 } // namespace drivers::nut
 } // namespace drivers
 
@@ -908,6 +1598,248 @@ nut_device_test (bool verbose)
 
     self.load_mapping (path);
 
+    // test case: adaptive polling interval
+    drivers::nut::NUTDevice ups ("ups");
+    assert (ups.due (0));
+    ups.reschedule (0, 1000, 8000);
+    assert (ups.pollingInterval () == 1000);
+    assert (!ups.due (999) && ups.due (1000));
+    // quiet device is stretched up to the ceiling
+    for (int i = 0; i < 10; ++i) {
+        ups.reschedule (0, 1000, 8000);
+    }
+    assert (ups.pollingInterval () == 8000);
+    // changing values tighten it gradually ...
+    ups.updatePhysics ("load.default", "10");
+    ups.commitChanges ();
+    ups.reschedule (0, 1000, 8000);
+    assert (ups.pollingInterval () == 4000);
+    // ... and status change immediately
+    for (int i = 0; i < 10; ++i) {
+        ups.reschedule (0, 1000, 8000);
+    }
+    ups.updatePhysics ("status.ups", "OB");
+    ups.commitChanges ();
+    ups.reschedule (0, 1000, 8000);
+    assert (ups.pollingInterval () == 1000);
+    // failed read goes back to the base interval of its class, not below it
+    drivers::nut::NUTDevice bulk ("pdu-bulk");
+    bulk.qos (drivers::nut::NUTQosLevel::BULK);
+    int64_t bulkBase = self.pollingInterval () * drivers::nut::NUTQos::schedule (drivers::nut::NUTQosLevel::BULK).intervalFactor;
+    for (int i = 0; i < 10; ++i) {
+        self.reschedule (bulk, 0);
+    }
+    assert (bulk.pollingInterval () > bulkBase);
+    bulk.updatePhysics ("load.default", "10");
+    bulk.commitChanges ();
+    self.reschedule (bulk, 0, true);
+    assert (bulk.pollingInterval () == bulkBase);
+    self.reschedule (bulk, 0, true);
+    assert (bulk.pollingInterval () == bulkBase && bulk.lowPriority ());
+
+    // test case: learnt schema keeps only variables somebody reads
+    const drivers::nut::NUTMapping& mapping = self.mapping ();
+    std::map <std::string, std::vector <std::string>> vars = {
+        { "device.2.ups.load", { "10" } },              // mapping, own chain index
+        { "device.2.outlet.12.current", { "0.5" } },    // numbered mapping
+        { "device.2.output.L2.realpower", { "100" } },  // rule input
+        { "device.2.driver.parameter.pollinterval", { "2" } }, // nobody reads it
+        { "device.3.ups.load", { "20" } },              // other chain index
+        { "device.3.ambient.1.temperature", { "21" } }, // sensor on other device in chain
+        { "device.2.input.L1.voltage.high.warning", { "250" } }, // alert
+        { "driver.version", { "2.7.4" } },
+    };
+    drivers::nut::NUTDevice epdu ("epdu-2", "epdu", 2);
+    assert (!epdu.schemaValid (1000));
+    epdu.learnSchema (vars, mapping, 1000);
+    assert (epdu.schemaValid (1000));
+    assert (!epdu.schemaValid (1000 + NUT_SCHEMA_RELEARN_MS));
+    assert ((epdu.schema () == std::vector <std::string> {
+        "device.2.input.L1.voltage.high.warning",
+        "device.2.outlet.12.current",
+        "device.2.output.L2.realpower",
+        "device.2.ups.load",
+        "device.3.ambient.1.temperature" }));
+    epdu.forgetSchema ();
+    assert (!epdu.schemaValid (1000) && epdu.schema ().empty ());
+    // metrics nobody wants are left out, inputs of computations are not
+    epdu.learnSchema (vars, mapping, 1000, [] (const std::string& metric) { return metric != "current.outlet.12"; });
+    assert ((epdu.schema () == std::vector <std::string> {
+        "device.2.input.L1.voltage.high.warning",
+        "device.2.output.L2.realpower",
+        "device.2.ups.load",
+        "device.3.ambient.1.temperature" }));
+    epdu.forgetSchema ();
+
+    // test case: members of a daisy chain get their part of the master
+    auto chained = drivers::nut::s_chain_variables (vars, "device.2.");
+    assert (chained.size () == 5);
+    assert (chained.count ("device.2.ups.load") && !chained.count ("device.3.ups.load"));
+    assert (drivers::nut::s_chain_variables (vars, "").size () == vars.size ());
+
+    // test case: unchanged payload is not processed again
+    drivers::nut::NUTDevice pdu ("pdu");
+    std::map <std::string, std::vector <std::string>> payload = {
+        { "ups.load", { "10" } }, { "device.model", { "ePDU" } } };
+    assert (pdu.update (payload, mapping));
+    assert (pdu.property ("load.default") == "10");
+    assert (!pdu.update (payload, mapping));
+    payload["ups.load"] = { "11" };
+    assert (pdu.update (payload, mapping));
+    assert (pdu.property ("load.default") == "11");
+    pdu.clear ();
+    assert (pdu.update (payload, mapping));
+    assert (pdu.property ("load.default") == "11");
+    pdu.assetExtAttribute ("max_power", "2");
+    assert (pdu.update (payload, mapping));
+    assert (!pdu.update (payload, mapping));
+
+    // test case: commit and clear walk just what changed
+    drivers::nut::NUTDevice dirty ("dirty");
+    dirty.updatePhysics ("load.default", "10");
+    dirty.updatePhysics ("realpower.default", "100");
+    dirty.commitChanges ();
+    assert (dirty.physics (true).size () == 2 && dirty._pending.empty ());
+    dirty.setChanged (false);
+    assert (!dirty.changed () && dirty.physics (true).empty ());
+    dirty.updatePhysics ("load.default", "12");
+    dirty.updatePhysics ("realpower.default", "100");
+    assert (dirty._pending.size () == 1);
+    dirty.commitChanges ();
+    assert ((dirty.physics (true) == std::map <std::string, std::string> { { "load.default", "12" } }));
+    dirty.setChanged ("load.default", false);
+    assert (!dirty.changed ());
+
+    // test case: rules of mapping.conf derive what the device does not give
+    drivers::nut::NUTDevice feed ("feed");
+    feed.assetExtAttribute ("subtype", "epdu");
+    feed.assetExtAttribute ("max_current", "16");
+    assert (feed.update ({ { "input.L1.current", { "4" } },
+                           { "outlet.1.realpower", { "100" } }, { "outlet.2.realpower", { "50.5" } } }, mapping));
+    assert (feed.property ("realpower.default") == "150.5");
+    assert (feed.property ("load.default") == "25");
+    assert (feed.property ("phases.input") == "1");
+    assert (feed.update ({ { "input.L1.current", { "4" } }, { "input.load", { "30" } } }, mapping));
+    assert (feed.property ("load.default") == "30");
+
+    // test case: numbers count as changed only out of their deadband
+    drivers::nut::NUTDevice meter ("meter");
+    drivers::nut::NUTDeadband band;
+    assert (drivers::nut::NUTDeadband::parse ("0.5", band));
+    drivers::nut::NUTKey volts = drivers::nut::NUTKeys::instance ().intern ("voltage.input.L1");
+    meter.updatePhysics (volts, "230.1", band);
+    meter.commitChanges ();
+    assert (meter.property ("voltage.input.L1") == "230.1");
+    meter.setChanged (false);
+    meter.updatePhysics (volts, "230.10", band);
+    meter.commitChanges ();
+    assert (!meter.changed ());
+    meter.updatePhysics (volts, "230.5", band);
+    meter.commitChanges ();
+    assert (!meter.changed () && meter.property ("voltage.input.L1") == "230.1");
+    meter.updatePhysics (volts, "230.7", band);
+    meter.commitChanges ();
+    assert (meter.changed () && meter.property ("voltage.input.L1") == "230.7");
+    double number = 0;
+    assert (meter.physicsNumber ("voltage.input.L1", number) && number == 230.7);
+    // text is compared as text
+    meter.updatePhysics ("status.ups", "OL");
+    meter.commitChanges ();
+    assert (!meter.physicsNumber ("status.ups", number));
+
+    // test case: status lane changes status at once, the next full read
+    // of the old payload is not skipped
+    payload["ups.status"] = { "OL" };
+    payload["outlet.1.status"] = { "on" };
+    assert (pdu.update (payload, mapping));
+    assert (pdu.property ("status.ups") == "OL");
+    pdu.setChanged (false);
+    assert (!pdu.updateStatus ({ { "ups.status", { "OL" } } }, mapping));
+    assert (!pdu.changed ());
+    assert (pdu.updateStatus ({ { "ups.status", { "OB" } }, { "outlet.1.status", { "off" } } }, mapping));
+    assert (pdu.property ("status.ups") == "OB");
+    assert (pdu.property ("status.outlet.1") == "off");
+    assert (pdu.changed ("status.ups") && !pdu.changed ("load.default"));
+    assert (drivers::nut::s_is_status ("outlet.1.current.status"));
+    assert (!drivers::nut::s_is_status ("status") && !drivers::nut::s_is_status ("ups.load"));
+    assert (drivers::nut::s_is_outlet ("outlet.1.current") && drivers::nut::s_is_outlet ("device.2.outlet.12.realpower"));
+    assert (!drivers::nut::s_is_outlet ("outlet.count") && !drivers::nut::s_is_outlet ("outlet.realpower"));
+    assert (drivers::nut::s_is_alert ("outlet.1.current.status") && drivers::nut::s_is_alert ("outlet.1.current.high.warning"));
+    assert (!drivers::nut::s_is_alert ("outlet.1.current") && !drivers::nut::s_is_alert ("outlet.1.status.high.x"));
+    assert (pdu.update (payload, mapping));
+    assert (pdu.property ("status.ups") == "OL");
+    // transfer to battery seen by the lane ends a stretched interval
+    for (int i = 0; i < 10; ++i) pdu.reschedule (0, 1000, 8000);
+    assert (pdu.pollingInterval () == 8000);
+    assert (pdu.updateStatus ({ { "ups.status", { "OB" } } }, mapping));
+    pdu.reschedule (1000, 1000, 8000);
+    assert (pdu.pollingInterval () == 1000);
+    assert (!pdu.due (1999) && pdu.due (2000));
+
+    // test case: device list follows the assets, the devices kept keep their state
+    nut_t *config = nut_new ();
+    auto put = [config] (const char *name, const char *operation, const char *ip, const char *chain) {
+        fty_proto_t *asset = fty_proto_new (FTY_PROTO_ASSET);
+        fty_proto_set_name (asset, "%s", name);
+        fty_proto_set_operation (asset, "%s", operation);
+        fty_proto_aux_insert (asset, "type", "%s", "device");
+        fty_proto_aux_insert (asset, "subtype", "%s", "epdu");
+        fty_proto_ext_insert (asset, "ip.1", "%s", ip);
+        if (chain) fty_proto_ext_insert (asset, "daisy_chain", "%s", chain);
+        nut_put (config, &asset);
+    };
+    put ("epdu-1", FTY_PROTO_ASSET_OP_CREATE, "1.1.1.1", NULL);
+    put ("epdu-2", FTY_PROTO_ASSET_OP_CREATE, "1.1.1.2", "1");
+    put ("epdu-3", FTY_PROTO_ASSET_OP_CREATE, "1.1.1.2", "2");
+    drivers::nut::NUTDeviceList list;
+    list.updateDeviceList (config);
+    assert (list.size () == 3);
+    assert (list["epdu-3"].nutName () == "epdu-2" && list["epdu-3"].daisyChainIndex () == 2);
+    assert (list.nutName ("epdu-3") == "epdu-2" && list.nutName ("epdu-1") == "epdu-1" && list.nutName ("nobody").empty ());
+    assert (list["epdu-1"].assetExtAttribute ("subtype") == "epdu");
+    list["epdu-1"].updatePhysics ("load.default", "10");
+    list["epdu-1"].commitChanges ();
+    list["epdu-3"].updatePhysics ("load.default", "20");
+    list["epdu-3"].commitChanges ();
+    // an unrelated asset comes
+    put ("epdu-4", FTY_PROTO_ASSET_OP_CREATE, "1.1.1.4", NULL);
+    list.updateDeviceList (config);
+    assert (list.size () == 4);
+    assert (list["epdu-1"].property ("load.default") == "10" && list["epdu-1"].changed ("load.default"));
+    // a chain member moves to another index and starts anew
+    put ("epdu-3", FTY_PROTO_ASSET_OP_UPDATE, "1.1.1.2", "3");
+    list.updateDeviceList (config);
+    assert (list["epdu-3"].daisyChainIndex () == 3 && !list["epdu-3"].hasPhysics ("load.default"));
+    // the master moves, so does its chain; the old IP leaves the map
+    put ("epdu-2", FTY_PROTO_ASSET_OP_UPDATE, "1.1.1.5", "1");
+    put ("epdu-3", FTY_PROTO_ASSET_OP_UPDATE, "1.1.1.5", "3");
+    put ("epdu-5", FTY_PROTO_ASSET_OP_CREATE, "1.1.1.2", "2");
+    list.updateDeviceList (config);
+    assert (list["epdu-3"].nutName () == "epdu-2" && list._ip2master.count ("1.1.1.5"));
+    assert (!list._ip2master.count ("1.1.1.2") && list.size () == 4);
+    // gone ones are removed, their endpoint goes with them
+    {
+        fty_proto_t *asset = fty_proto_new (FTY_PROTO_ASSET);
+        fty_proto_set_name (asset, "%s", "epdu-4");
+        fty_proto_set_operation (asset, "%s", FTY_PROTO_ASSET_OP_UPDATE);
+        fty_proto_aux_insert (asset, "type", "%s", "device");
+        fty_proto_aux_insert (asset, "subtype", "%s", "epdu");
+        fty_proto_ext_insert (asset, "ip.1", "%s", "1.1.1.4");
+        fty_proto_ext_insert (asset, NUT_ENDPOINT_ATTRIBUTE, "%s", "upsd-9");
+        nut_put (config, &asset);
+    }
+    list.updateDeviceList (config);
+    assert (drivers::nut::NUTEndpoints::instance ().lookup ("epdu-4").host == "upsd-9");
+    auto &breaker = drivers::nut::NUTCircuitBreaker::instance ();
+    for (unsigned i = 0; i < NUT_BREAKER_THRESHOLD; ++i) breaker.failure ("epdu-4", "timeout", 0);
+    assert (breaker.state ("epdu-4") == drivers::nut::NUTCircuitState::OPEN);
+    put ("epdu-4", FTY_PROTO_ASSET_OP_DELETE, "1.1.1.4", NULL);
+    list.updateDeviceList (config);
+    assert (list.size () == 3 && list["epdu-1"].property ("load.default") == "10");
+    assert (drivers::nut::NUTEndpoints::instance ().lookup ("epdu-4").host != "upsd-9");
+    assert (breaker.state ("epdu-4") == drivers::nut::NUTCircuitState::CLOSED);
+    nut_destroy (&config);
+
     //  @end
     printf ("OK\n");
 }
@@ -26,33 +26,61 @@
 // Original authors: Tomas Halman, Karol Hrdina, Alena Chernikava
 
 #include <map>
+#include <set>
 #include <vector>
 #include <functional>
+#include <memory>
 #include <nutclient.h>
 #include <nut.h>
+#include "nut_connection_pool.h"
+#include "nut_poller.h"
+#include "nut_snapshot.h"
+#include "nut_timer_wheel.h"
+#include "nut_driver_socket.h"
+#include "nut_interest.h"
+#include "nut_sampler.h"
+#include "nut_overload.h"
+#include "nut_qos.h"
+#include "nut_keys.h"
+#include "nut_mapping.h"
+#include "nut_outlet_table.h"
 
 namespace nutclient = nut;
 
+#define NUT_POLLING_CEILING_FACTOR  8   //!< quiet devices are polled at most this many times less often
+#define NUT_SCHEMA_RELEARN_MS       3600000 //!< [ms] all variables are fetched again after this
+#define NUT_STATUS_DEFAULT_INTERVAL 2000    //!< [ms] status variables are read this often
+#define NUT_STATUS_WORKERS          2       //!< workers per endpoint reading status variables
+
+FTY_NUT_EXPORT void
+    nut_device_test (bool verbose);
+FTY_NUT_EXPORT void
+    nut_agent_test (bool verbose);
+
 namespace drivers
 {
 namespace nut
 {
 
 struct NUTInventoryValue {
-    bool changed;
     std::string value;
 };
 
 struct NUTPhysicalValue {
-    bool changed;
     std::string value;
     std::string candidate;
+    //! \brief value and candidate parsed once, valid if numeric
+    double number = 0;
+    double candidateNumber = 0;
+    bool numeric = false;
+    bool candidateNumeric = false;
 };
 
 // Class for keeping status information of one UPS/ePDU/...
 // Keeps inventory, status and measurement values of one device as it is presented by NUT.
 class NUTDevice {
     friend class NUTDeviceList;
+    friend void ::nut_device_test (bool verbose);
  public:
     // Creates new NUTDevice with empty set of values without name.
     NUTDevice();
@@ -71,6 +99,7 @@ class NUTDevice {
     // Returns true if property has changed since last check.
     bool changed(const char *name) const;
     bool changed(const std::string& name) const;
+    bool changed(NUTKey key) const;
 
     // Sets status of all properties
     void setChanged(const bool status);
@@ -78,6 +107,7 @@ class NUTDevice {
     // Set status of particular property
     void setChanged(const char *name, const bool status);
     void setChanged(const std::string& name,const bool status);
+    void setChanged(NUTKey key, const bool status);
 
     /**
      * \brief Produces a std::string with device status in JSON format.
@@ -120,6 +150,24 @@ class NUTDevice {
      */
     std::map<std::string,std::string> inventory(bool onlyChanged) const;
 
+    /**
+     * \brief Physics and inventory values in place, by interned key.
+     *
+     * What physics () and inventory () copy out, for publishers walking
+     * all values of many devices:
+     *
+     *    const auto& values = UPS.physicsValues ();
+     *    for (size_t i = 0; i < values.size (); ++i) {
+     *        if (values.changed (i)) send (NUTKeys::instance ().name (values.key (i)), values.value (i).value);
+     *    }
+     */
+    const NUTKeyedValues <NUTPhysicalValue>& physicsValues () const { return _physics; }
+    const NUTKeyedValues <NUTInventoryValue>& inventoryValues () const { return _inventory; }
+
+    //! \brief outlet variables of the last update () and status changes since, by outlet number
+    NUTOutletTable& outlets () { return _outlets; }
+    const NUTOutletTable& outlets () const { return _outlets; }
+
     /**
      * \brief method returns particular device property.
      * \return std::string, property value as a string or empty
@@ -134,12 +182,15 @@ class NUTDevice {
     std::string property(const char *name) const;
     std::string property(const std::string& name) const;
 
+    //! \brief value of physical property name as number, false if none or not a number
+    bool physicsNumber(const std::string& name, double& number) const;
+
     /**
      * \brief method returns all discovered properties of device.
      * \return std::map<std::string,std::string> property values
      *
      * Method transforms all properties (physical and inventory) to
-     * map. Numeric values are converted to strings using itof() method.
+     * map.
      */
     std::map<std::string,std::string> properties() const;
 
@@ -171,6 +222,68 @@ class NUTDevice {
 
     void assetExtAttribute (const std::string name, const std::string value);
     std::string assetExtAttribute (const std::string name) const;
+
+    /**
+     * \brief true if the device should be fetched at time now [ms]
+     *
+     * tolerance absorbs the jitter of the polling timer
+     */
+    bool due (int64_t now, int64_t tolerance = 0) const { return now + tolerance >= _nextPoll; }
+
+    /**
+     * \brief Adapt the polling interval to changes seen by last commitChanges ().
+     *
+     * Interval is reset to base when status.ups changed, halved (not below
+     * base) when other values changed and stretched by half up to ceiling
+     * when nothing changed. All values in [ms].
+     */
+    void reschedule (int64_t now, int64_t base, int64_t ceiling);
+
+    //! \brief [ms] current polling interval, 0 until first reschedule ()
+    int64_t pollingInterval () const { return _pollingInterval; }
+
+    //! \brief true if the device is read less often when polling is overloaded, see NUTQos::lowPriority ()
+    bool lowPriority () const;
+
+    //! \brief get/set QoS level, the class the device is polled and published in
+    void qos (NUTQosLevel level) { _qos = level; }
+    NUTQosLevel qos () const { return _qos; }
+
+    /**
+     * \brief Learn which variables of the NUT device are needed at time now [ms].
+     *
+     * Keeps variables of vars read by the mapping, by the values
+     * transformation and by the alert and sensor actors (which get them
+     * through the snapshot). If wanted is given, physics mapped to metrics
+     * it refuses are left out.
+     */
+    void learnSchema (const std::map <std::string, std::vector <std::string>>& vars,
+                      const NUTMapping& mapping,
+                      int64_t now,
+                      std::function <bool (const std::string& metric)> wanted = nullptr);
+
+    /**
+     * \brief Apply status variables read between full updates.
+     *
+     * vars hold a few variables only, so no transformation is done.
+     * Variables are mapped as by update () and stored right away, the
+     * next update () then takes its payload as changed. A changed
+     * status.ups counts as a committed change, so the next reschedule ()
+     * drops back to the base interval.
+     *
+     * \return true if some status changed
+     */
+    bool updateStatus (const std::map <std::string, std::vector <std::string>>& vars,
+                       const NUTMapping& mapping);
+
+    //! \brief fetch all variables next time, e.g. when the driver may have restarted
+    void forgetSchema () { _schema.clear (); _schemaLearned = 0; }
+    //! \brief true if the schema was learnt, no matter how long ago
+    bool schemaLearned () const { return _schemaLearned != 0; }
+    //! \brief true if the schema can be used at time now [ms]
+    bool schemaValid (int64_t now) const { return _schemaLearned && now - _schemaLearned < NUT_SCHEMA_RELEARN_MS; }
+    //! \brief variables to fetch, empty until learnt
+    const std::vector <std::string>& schema () const { return _schema; }
     ~NUTDevice();
  private:
     /**
@@ -181,10 +294,12 @@ class NUTDevice {
     /**
      * \brief Updates physical or measurement value (like current or load) from float.
      *
-     * Updates the value if new value is significantly differen (> threshold%). Flag _change is
-     * set if new value is saved.
+     * Numeric values are parsed once and updated only if the new value is
+     * out of deadband around the last committed one, other values if their
+     * text differs. Flag _change is set if new value is saved.
      */
     void updatePhysics(const std::string& varName, const std::string& newValue);
+    void updatePhysics(NUTKey key, const std::string& newValue, const NUTDeadband& deadband = NUTDeadband ());
 
     /**
      * \brief Updates physical or measurement value from vector.
@@ -193,6 +308,7 @@ class NUTDevice {
      * values).
      */
     void updatePhysics(const std::string& varName, std::vector<std::string>& values);
+    void updatePhysics(NUTKey key, const std::vector<std::string>& values, const NUTDeadband& deadband = NUTDeadband ());
 
     /**
      * \brief Updates inventory value.
@@ -202,20 +318,20 @@ class NUTDevice {
      * set if new value is different from old one.
      */
     void updateInventory(const std::string& varName, std::vector<std::string>& values);
+    void updateInventory(NUTKey key, const std::vector<std::string>& values);
 
     /**
      * \brief Updates all values from NUT.
-     */
-    void update (std::map<std::string,std::vector<std::string>> vars,
-                 std::function <const std::map <std::string, std::string>&(const char *)> mapping,
-                 bool forceUpdate = false );
-
-    /**
-     * \brief Set variable dst with value from src if dst not present and src is
      *
-     * This method is used to normalize the NUT output from different drivers/devices.
+     * Nothing is transformed nor mapped when vars are the same as last
+     * time (by hash of names and values). Otherwise vars are walked once,
+     * mapping tells where each of them goes.
+     *
+     * \return false if vars were empty or unchanged
      */
-    void NUTSetIfNotPresent (const std::string& prefix, std::map< std::string,std::vector<std::string> > &vars, const std::string &dst, const std::string &src);
+    bool update (std::map<std::string,std::vector<std::string>> vars,
+                 const NUTMapping& mapping,
+                 bool forceUpdate = false );
 
     /**
      * \brief Commit chages for changed calculated by updatePhysics.
@@ -229,14 +345,10 @@ class NUTDevice {
      */
     std::string daisyPrefix() const;
 
-    /**
-     * \brief map of physical values.
-     *
-     * Values are multiplied by 100 and stored as integer
-     */
-    std::map<std::string, NUTPhysicalValue> _physics;
-    //! \brief map of inventory values
-    std::map<std::string, NUTInventoryValue> _inventory;
+    //! \brief physical values by interned metric name
+    NUTKeyedValues <NUTPhysicalValue> _physics;
+    //! \brief inventory values by interned name
+    NUTKeyedValues <NUTInventoryValue> _inventory;
 
     //! \brief device name from assets
     std::string _assetName;
@@ -245,22 +357,37 @@ class NUTDevice {
     //! \brief daisy-chain index
     int _daisyChainIndex;
 
-    //! \brief Transformation of our integer (x100) back
-    std::string itof(const long int) const;
-    //! \brief calculate ups.load if not present
-    void NUTFixMissingLoad (const std::string& prefix, std::map< std::string,std::vector<std::string> > &vars);
-    //! \brief calculate ups.realpower from output.Lx.realpower if not present
-    void NUTRealpowerFromOutput (const std::string& prefix,  std::map< std::string,std::vector<std::string> > &vars);
-    //! \brief NUT values transformation function
-    void NUTValuesTransformation (const std::string& prefix, std::map< std::string,std::vector<std::string> > &vars);
     //! \brief last succesfull communication timestamp
     time_t _lastUpdate = 0;
+
+    //! \brief number of physics changed by last commitChanges ()
+    size_t _committedChanges = 0;
+    //! \brief status.ups changed in last commitChanges ()
+    bool _statusChanged = false;
+    //! \brief [ms] adaptive polling interval
+    int64_t _pollingInterval = 0;
+    //! \brief [ms] zclock_mono when the device is due for polling
+    int64_t _nextPoll = 0;
+    //! \brief variables of NUT device needed by this device
+    std::vector <std::string> _schema;
+    //! \brief [ms] zclock_mono when _schema was learnt, 0 if not
+    int64_t _schemaLearned = 0;
+    //! \brief hash of variables of last update (), 0 if they have to be processed
+    uint64_t _payloadHash = 0;
+    //! \brief physics slots given a candidate since the last commitChanges (), may repeat
+    std::vector <uint32_t> _pending;
+    //! \brief variables derived by mapping rules, reused while their inputs stay
+    NUTRulesState _rulesState;
+    NUTOutletTable _outlets;
+    NUTQosLevel _qos = NUTQosLevel::STANDARD;
 };
 
 /**
  * \brief NUTDeviceList is class for holding list of NUTDevice objects.
  */
 class NUTDeviceList {
+    friend void ::nut_device_test (bool verbose);
+    friend void ::nut_agent_test (bool verbose);
  public:
     NUTDeviceList();
 
@@ -277,21 +404,67 @@ class NUTDeviceList {
      * \brief Returns requested mapping
      */
     const std::map <std::string, std::string>& get_mapping (const char *mapping) const;
+    //! \brief both mappings compiled by load_mapping ()
+    const NUTMapping& mapping () const { return _mapping; }
 
     /**
      * \brief Reads status information from NUT daemon.
      *
-     * Method reads values from NUT and updates information of particular
-     * devices. Newly discovered davices are added to list, removed devices
-     * are also removed from list.
+     * Every NUT device has its own phase within the polling interval, derived
+     * from its name. Method handles devices whose phase has come since the
+     * last call, of those it reads the ones due by their adaptive interval.
+     * Members of a daisy chain come together and their master is read once.
+     *
+     * \return devices handled in this call, to be advertised
      */
-    void update( bool forceUpdate = false );
+    std::vector <NUTDevice *> update( bool forceUpdate = false );
+
+    /**
+     * \brief Reads status variables from NUT daemon if their time came.
+     *
+     * Between the full reads of update (), ups.status and the *.status
+     * alert variables seen by the last full read are asked by GET VAR
+     * every status interval, so a transfer to battery or a breached
+     * threshold does not wait for the next phase of its device. Changes
+     * go to the devices at once and to the status lane of the snapshot
+     * bus. Devices refused by their circuit breaker and those read from
+     * a driver socket are left out, a device whose status changed is
+     * rescheduled at once.
+     *
+     * Runs on the caller's thread: the caller asks before update (), but
+     * a full read in progress (bounded by cycleBudget ()) delays it.
+     *
+     * \return devices whose status changed, to be advertised
+     */
+    std::vector <NUTDevice *> updateStatus ();
+
+    /**
+     * \brief Samples the metrics selected by asset attribute if their time came.
+     *
+     * Variables mapped to the metrics selected by NUT_SAMPLER_ATTRIBUTE
+     * (learnt by the last full read) are asked by GET VAR every sampling
+     * interval, or taken from the driver socket, and go to sampler ().
+     * Nothing is advertised, the windows go with the next full read.
+     * Runs on the caller's thread, delayed by a full read in progress
+     * like updateStatus ().
+     */
+    void updateSamples ();
+
+    //! \brief [ms] until the phase of next device or a lane comes, for zpoller_wait
+    int64_t pollTimeout ();
 
     /**
      * \brief Returns true if there is at least one device claiming change.
+     *
+     * Only the devices marked by the updates since they were last found
+     * clean are looked at.
      */
     bool changed() const;
 
+    //! \brief devices with values not advertised yet, by asset name, those read
+    //!        earlier and still dirty (e.g. nobody wanted them then) too
+    std::vector <NUTDevice *> changedDevices ();
+
     /**
      * \brief returns the size of device list (number of devices)
      */
@@ -299,35 +472,241 @@ class NUTDeviceList {
 
     //! \brief get the NUTDevice object by name
     NUTDevice& operator[](const std::string &name);
+    //! \brief NUT device name of asset, the master for a daisy chain member;
+    //!        empty if asset is not in the list
+    std::string nutName (const std::string &asset) const;
 
     //! \brief get the iterators, to be able to go trough list of devices
     std::map<std::string, NUTDevice>::iterator begin();
     std::map<std::string, NUTDevice>::iterator end();
 
-    //! \brief update list of NUT devices
+    /**
+     * \brief update list of NUT devices
+     *
+     * Reconciled with the power devices of deviceState: new assets are
+     * added and scheduled, gone ones removed, and the ones that moved to
+     * another NUT device or daisy chain index start anew. The rest keep
+     * their values, change flags and schedule, only their attributes are
+     * refreshed.
+     */
     void updateDeviceList(nut_t * deviceState);
 
-    ~NUTDeviceList();
+    //! \brief get/set number of parallel polling workers
+    void pollingWorkers (size_t count) { _poller.workers (count); }
+    size_t pollingWorkers () const { return _poller.workers (); }
+
+    /**
+     * \brief get/set base polling interval [ms]
+     *
+     * Quiet devices are stretched up to NUT_POLLING_CEILING_FACTOR times
+     * this interval.
+     */
+    void pollingInterval (int64_t interval);
+    int64_t pollingInterval () const { return _pollingInterval; }
+
+    /**
+     * \brief get/set [ms] to wait for one device and to start the devices
+     *        of one update
+     *
+     * A device not answering within the deadline keeps its last values
+     * and is asked again at its next phase. Devices not started within
+     * the budget (capped to the polling interval) are carried over and
+     * fetched first by the next update.
+     */
+    void fetchDeadline (int64_t deadline) { _fetchDeadline = deadline; }
+    int64_t fetchDeadline () const { return _fetchDeadline; }
+    void cycleBudget (int64_t budget) { _cycleBudget = budget; }
+    int64_t cycleBudget () const { return _cycleBudget; }
+
+    /**
+     * \brief get/set selective fetching
+     *
+     * When on, all variables of a device are fetched only to learn its
+     * schema (at first, hourly and after failures), otherwise just the
+     * variables of the schema are.
+     */
+    void selectiveFetch (bool enabled) { _selectiveFetch = enabled; }
+    bool selectiveFetch () const { return _selectiveFetch; }
+
+    /**
+     * \brief get/set reading of NUT driver state sockets in stateDir
+     *
+     * When on, the variables of a NUT device come from the socket of its
+     * driver as they change and upsd is not asked for them. Devices without
+     * a socket, with a socket still dumping or with stale data are polled
+     * from upsd as usual. Missing sockets are looked for every
+     * NUT_DRIVER_RECONNECT_MS, by the driver.name of the device, so a
+     * device is read from upsd at least once before.
+     */
+    void driverSockets (bool enabled, const std::string& stateDir = NUT_DRIVER_STATE_PATH);
+    bool driverSockets () const { return _driverSocketsEnabled; }
+    const std::string& driverStatePath () const { return _driverStatePath; }
+
+    //! \brief connected driver sockets, to be watched by zpoller
+    std::vector <int *> driverHandles ();
+    /**
+     * \brief Driver sockets given up since closeRetiredDrivers ().
+     *
+     * They stay open until closeRetiredDrivers (), so the caller can take
+     * them out of zpoller first:
+     *
+     *    for (auto handle : list.retiredDriverHandles ()) zpoller_remove (poller, handle);
+     *    list.closeRetiredDrivers ();
+     */
+    std::vector <int *> retiredDriverHandles ();
+    void closeRetiredDrivers ();
+
+    /**
+     * \brief Read what the driver of handle sent.
+     * \return devices whose variables changed, to be advertised
+     */
+    std::vector <NUTDevice *> onDriverEvent (int *handle);
+
+    //! \brief number of driver sockets connected now / driver updates applied since start
+    uint64_t driverConnected () const;
+    uint64_t driverEvents () const { return _driverEvents; }
+
+    //! \brief get/set [ms] between reads of status variables, 0 turns the status lane off
+    void statusInterval (int64_t interval) { _statusInterval = interval > 0 ? interval : 0; _nextStatus = 0; }
+    int64_t statusInterval () const { return _statusInterval; }
+    //! \brief number of status reads of NUT devices / status changes found since start
+    uint64_t statusPolls () const { return _statusPolls; }
+    uint64_t statusChanges () const { return _statusChanges; }
+
+    //! \brief degradation level under sustained overruns, see NUTOverload
+    const NUTOverload& overload () const { return _overload; }
+
+    //! \brief get/set [ms] between samples of selected metrics, 0 turns sampling off
+    void samplingInterval (int64_t interval) { _samplingInterval = interval > 0 ? interval : 0; _nextSample = 0; }
+    int64_t samplingInterval () const { return _samplingInterval; }
+    //! \brief samples of the metrics selected per asset
+    NUTSampler& sampler () { return _sampler; }
+    const NUTSampler& sampler () const { return _sampler; }
+    //! \brief number of sampling reads of NUT devices since start
+    uint64_t samplePolls () const { return _samplePolls; }
+
+    //! \brief metrics consumers want, schemas leave out the rest; NULL for all
+    void interest (NUTInterest *interest) { _interest = interest; }
+
+    //! \brief number of device updates / skips of quiet devices since start
+    uint64_t polledCount () const { return _polledCount; }
+    //! \brief number of NUT devices fetched since start, once per daisy chain
+    uint64_t fetchCount () const { return _fetchCount; }
+    uint64_t deferredCount () const { return _deferredCount; }
+    //! \brief number of devices missing the deadline / skipped by the budget,
+    //!        updates exceeding the budget since start
+    uint64_t timeoutCount () const { return _timeoutCount; }
+    uint64_t skippedCount () const { return _skippedCount; }
+    uint64_t overrunCount () const { return _overrunCount; }
+    //! \brief number of schemas learnt / variables fetched since start
+    uint64_t learnCount () const { return _learnCount; }
+    uint64_t variableCount () const { return _variableCount; }
+    //! \brief number of updates skipped / processed because payload was the same / differed
+    uint64_t payloadHits () const { return _payloadHits; }
+    uint64_t payloadMisses () const { return _payloadMisses; }
 
  private:
     // see http://www.networkupstools.org/docs/user-manual.chunked/apcs01.html
     std::map <std::string, std::string> _physicsMapping; //!< physics mapping
     std::map <std::string, std::string> _inventoryMapping; //!< inventory mapping
-
-    //! \brief Connection to NUT daemon
-    nutclient::TcpClient nutClient;
+    NUTMapping _mapping; //!< both of them compiled
 
     //! \brief list of NUT devices
     std::map<std::string, NUTDevice> _devices;
-
-    //! \brief connect to NUT daemon
-    bool connect();
-
-    //! \brief disconnect from NUT daemon
-    void disconnect();
+    //! \brief ip | asset name of daisy chain master, kept along the device list
+    std::map<std::string, std::string> _ip2master;
+    //! \brief asset name of daisy chain master | its ip in _ip2master
+    std::map<std::string, std::string> _masterIps;
+    //! \brief asset names of devices updated with changes, some may be advertised since
+    std::set <std::string> _changedDevices;
+    //! \brief remember device in _changedDevices if it has values not advertised
+    void markChanged (const NUTDevice& device);
+
+    //! \brief workers fetching the devices from upsd
+    NUTPoller _poller;
+
+    //! \brief [ms] base polling interval
+    int64_t _pollingInterval = 30000;
+    int64_t _fetchDeadline = NUT_POLLER_DEFAULT_DEADLINE;
+    int64_t _cycleBudget = NUT_POLLER_DEFAULT_BUDGET;
+    uint64_t _polledCount = 0;
+    uint64_t _fetchCount = 0;
+    uint64_t _deferredCount = 0;
+    uint64_t _timeoutCount = 0;
+    uint64_t _skippedCount = 0;
+    uint64_t _overrunCount = 0;
+    bool _selectiveFetch = false;
+    uint64_t _learnCount = 0;
+    uint64_t _variableCount = 0;
+    uint64_t _payloadHits = 0;
+    uint64_t _payloadMisses = 0;
+    //! \brief asset names of devices skipped by the budget, first in next update
+    std::vector <std::string> _carriedOver;
+
+    NUTOverload _overload;
+    //! \brief NUT device name | [ms] its outlet variables were last read while degraded
+    std::map <std::string, int64_t> _outletsRead;
+
+    //! \brief true if the schema of device does for a read at now [ms], old ones do when degraded
+    bool schemaUsable (const NUTDevice& device, int64_t now) const;
+    //! \brief adapt polling interval of device read at now [ms] by its QoS class and the overload level,
+    //!        failed back to the base interval of its class
+    void reschedule (NUTDevice& device, int64_t now, bool failed = false) const;
+
+    //! \brief next phase of every device
+    NUTTimerWheel _wheel;
+    //! \brief devices read since _cycleStart, published once per interval
+    std::shared_ptr <NUTSnapshot> _cycleSnapshot;
+    int64_t _cycleStart = 0;
+
+    NUTInterest *_interest = NULL;
+    uint64_t _interestGeneration = 0;
+
+    //! \brief workers of the status and sampling lanes, apart so their requests do not queue behind a full read
+    NUTPoller _statusPoller { NUT_STATUS_WORKERS };
+    int64_t _statusInterval = NUT_STATUS_DEFAULT_INTERVAL;
+    int64_t _nextStatus = 0;            //!< [ms] next read of status variables
+    uint64_t _statusPolls = 0;
+    uint64_t _statusChanges = 0;
+    //! \brief NUT device name | its status variables seen by the last full read
+    std::map <std::string, std::set <std::string>> _statusVariables;
+    //! \brief NUT device name | status variables, what the status lane publishes
+    std::map <std::string, std::map <std::string, std::vector <std::string>>> _statusValues;
+
+    NUTSampler _sampler;
+    int64_t _samplingInterval = NUT_SAMPLER_DEFAULT_INTERVAL;
+    int64_t _nextSample = 0;            //!< [ms] next sampling read
+    uint64_t _samplePolls = 0;
+    //! \brief asset name | NUT variable | sampled metric it maps to
+    std::map <std::string, std::map <std::string, std::string>> _samplingVariables;
+
+    //! \brief learn which of vars are sampled for device, sample them at now [ms]
+    void learnSampling (const NUTDevice& device, const NUTVariables& vars, int64_t now);
+    //! \brief sample variables of asset found in vars at now [ms]
+    void sample (const std::string& asset, const std::map <std::string, std::string>& variables,
+                 const NUTVariables& vars, int64_t now);
+
+    bool _driverSocketsEnabled = false;
+    std::string _driverStatePath = NUT_DRIVER_STATE_PATH;
+    //! \brief NUT device name | its driver socket, addresses stay for zpoller
+    std::map <std::string, std::unique_ptr <NUTDriverSocket>> _driverSockets;
+    //! \brief sockets given up, open until closeRetiredDrivers ()
+    std::vector <std::unique_ptr <NUTDriverSocket>> _retiredDrivers;
+    //! \brief NUT device name | driver.name seen by the last read from upsd
+    std::map <std::string, std::string> _driverNames;
+    //! \brief move driver to _retiredDrivers if it holds a descriptor, reset it anyway
+    void retireDriver (std::unique_ptr <NUTDriverSocket> &driver);
+    int64_t _driverScan = 0;            //!< [ms] last look for missing sockets
+    uint64_t _driverEvents = 0;
+
+    //! \brief drop sockets of gone devices, look for missing ones once in a while
+    void syncDriverSockets (int64_t now);
+
+    //! \brief put all devices to the wheel at their phase
+    void scheduleAll (int64_t now);
 
     //! \brief update status of NUT devices
-    void updateDeviceStatus( bool forceUpdate = false );
+    std::vector <NUTDevice *> updateDeviceStatus( bool forceUpdate = false );
 
     bool _mappingLoaded = false;
 };
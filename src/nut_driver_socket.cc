@@ -0,0 +1,333 @@
+/*  =========================================================================
+    nut_driver_socket - connection to the state socket of a NUT driver
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_driver_socket - connection to the state socket of a NUT driver
+@discuss
+    The driver answers DUMPALL with its whole state and then keeps
+    sending changes, the same lines in both cases:
+
+        SETINFO <var> "<value>"         variable set or changed
+        DELINFO <var>                   variable gone
+        DATAOK / DATASTALE              driver (lost) contact with device
+        DUMPDONE                        end of the dump
+        PING                            answered by PONG
+
+    Lines about enums, ranges, flags and commands are ignored, they are
+    of no use for monitoring.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTDriverSocket::NUTDriverSocket (const std::string& path) :
+    _path (path)
+{
+}
+
+NUTDriverSocket::~NUTDriverSocket ()
+{
+    disconnect ();
+}
+
+bool NUTDriverSocket::connect ()
+{
+    if (_lost) disconnect ();
+    if (_fd >= 0) return true;
+    if (_path.empty ()) return false;
+
+    struct sockaddr_un address;
+    memset (&address, 0, sizeof (address));
+    address.sun_family = AF_UNIX;
+    if (_path.size () >= sizeof (address.sun_path)) {
+        log_error ("driver socket path %s is too long", _path.c_str ());
+        return false;
+    }
+    strncpy (address.sun_path, _path.c_str (), sizeof (address.sun_path) - 1);
+
+    int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    // unix sockets connect at once or not at all
+    if (::connect (fd, (struct sockaddr *) &address, sizeof (address)) != 0) {
+        log_debug ("connect to driver socket %s failed (%s)", _path.c_str (), strerror (errno));
+        ::close (fd);
+        return false;
+    }
+    _fd = fd;
+    _dumped = false;
+    _stale = false;
+    _variables.clear ();
+    log_debug ("connected to driver socket %s", _path.c_str ());
+    send ("DUMPALL\n");
+    return isConnected ();
+}
+
+void NUTDriverSocket::disconnect ()
+{
+    if (_fd >= 0) {
+        ::close (_fd);
+        _fd = -1;
+    }
+    _lost = false;
+    _input.clear ();
+    _dumped = false;
+}
+
+void NUTDriverSocket::lose ()
+{
+    _lost = true;
+    _input.clear ();
+    _dumped = false;
+}
+
+void NUTDriverSocket::send (const char *line)
+{
+    // short lines fit in any socket buffer
+    size_t length = strlen (line);
+    ssize_t n;
+    do {
+        n = ::send (_fd, line, length, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t) length) {
+        log_error ("write to driver socket %s failed (%s)", _path.c_str (), strerror (errno));
+        lose ();
+    }
+}
+
+bool NUTDriverSocket::receive ()
+{
+    if (!isConnected ()) return false;
+
+    char buffer [4096];
+    while (true) {
+        ssize_t n = ::recv (_fd, buffer, sizeof (buffer), 0);
+        if (n == 0) {
+            log_warning ("driver closed its socket %s", _path.c_str ());
+            lose ();
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            log_error ("read from driver socket %s failed (%s)", _path.c_str (), strerror (errno));
+            lose ();
+            return false;
+        }
+
+        // complete lines are parsed in place, only the tail is kept
+        const char *data = buffer;
+        const char *end = buffer + n;
+        while (data < end) {
+            const char *eol = static_cast <const char *> (memchr (data, '\n', end - data));
+            if (!eol) {
+                _input.append (data, end - data);
+                break;
+            }
+            const char *line = data;
+            size_t length = eol - data;
+            if (!_input.empty ()) {
+                _input.append (data, length);
+                line = _input.data ();
+                length = _input.size ();
+            }
+            dispatch (line, length);
+            _input.clear ();
+            if (_lost) return false;
+            data = eol + 1;
+        }
+    }
+}
+
+void NUTDriverSocket::dispatch (const char *line, size_t length)
+{
+    if (!NUTAsyncClient::tokenize (line, length, _words) || _words.empty ()) {
+        log_debug ("malformed line from driver socket %s", _path.c_str ());
+        return;
+    }
+    const std::string& command = _words [0];
+    if (command == "SETINFO" && _words.size () >= 3) {
+        auto& values = _variables [_words [1]];
+        if (values.size () != 1 || values [0] != _words [2]) {
+            values = { _words [2] };
+            _changed = true;
+        }
+        ++_updates;
+    }
+    else
+    if (command == "DELINFO" && _words.size () >= 2) {
+        if (_variables.erase (_words [1])) _changed = true;
+        ++_updates;
+    }
+    else
+    if (command == "DATAOK") {
+        _stale = false;
+    }
+    else
+    if (command == "DATASTALE") {
+        _stale = true;
+    }
+    else
+    if (command == "DUMPDONE") {
+        _dumped = true;
+        _changed = true;
+    }
+    else
+    if (command == "PING") {
+        send ("PONG\n");
+    }
+}
+
+bool NUTDriverSocket::takeChanged ()
+{
+    bool changed = _changed && ready ();
+    if (changed) _changed = false;
+    return changed;
+}
+
+std::string NUTDriverSocket::find (const std::string& stateDir, const std::string& driver, const std::string& nutName)
+{
+    if (driver.empty () || nutName.empty ()) return "";
+    std::string path = stateDir + "/" + driver + "-" + nutName;
+    struct stat info;
+    if (stat (path.c_str (), &info) != 0 || !S_ISSOCK (info.st_mode)) return "";
+    return path;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+static void
+s_write_driver (int fd, const char *data)
+{
+    size_t length = strlen (data);
+    assert (write (fd, data, length) == (ssize_t) length);
+}
+
+void
+nut_driver_socket_test (bool verbose)
+{
+    printf (" * nut_driver_socket: ");
+
+    //  @selftest
+    using drivers::nut::NUTDriverSocket;
+
+    // fake driver in a private state directory
+    char stateDir [] = "/tmp/fty-nut-driver-XXXXXX";
+    assert (mkdtemp (stateDir));
+    std::string path = std::string (stateDir) + "/snmp-ups-epdu-1";
+    int server = socket (AF_UNIX, SOCK_STREAM, 0);
+    assert (server >= 0);
+    struct sockaddr_un address;
+    memset (&address, 0, sizeof (address));
+    address.sun_family = AF_UNIX;
+    strncpy (address.sun_path, path.c_str (), sizeof (address.sun_path) - 1);
+    assert (bind (server, (struct sockaddr *) &address, sizeof (address)) == 0);
+    assert (listen (server, 1) == 0);
+
+    assert (NUTDriverSocket::find (stateDir, "snmp-ups", "epdu-1") == path);
+    assert (NUTDriverSocket::find (stateDir, "snmp-ups", "ups-1").empty ());
+    assert (NUTDriverSocket::find ("/nonexistent", "snmp-ups", "epdu-1").empty ());
+    // no suffix match, pdu-1 is not served by snmp-ups-epdu-1
+    assert (NUTDriverSocket::find (stateDir, "snmp-ups-e", "pdu-1").empty ());
+    assert (NUTDriverSocket::find (stateDir, "", "epdu-1").empty ());
+
+    NUTDriverSocket driver (path);
+    assert (!driver.ready ());
+    assert (driver.connect ());
+    int session = accept (server, NULL, NULL);
+    assert (session >= 0);
+    char buffer [256];
+    ssize_t n = read (session, buffer, sizeof (buffer) - 1);
+    assert (n == 8);
+    buffer [n] = 0;
+    assert (streq (buffer, "DUMPALL\n"));
+
+    // dump split in the middle of a line is not used before DUMPDONE
+    s_write_driver (session, "SETINFO device.model \"ePDU \\\"G3\\\"\"\nADDENUM input.transfer.low \"100\"\nSETINFO ups.st");
+    zclock_sleep (50);
+    assert (driver.receive ());
+    assert (!driver.ready ());
+    assert (!driver.takeChanged ());
+    s_write_driver (session, "atus \"OL\"\nSETINFO outlet.1.current \"0.5\"\nDATAOK\nDUMPDONE\n");
+    zclock_sleep (50);
+    assert (driver.receive ());
+    assert (driver.ready ());
+    assert (driver.takeChanged ());
+    assert (!driver.takeChanged ());
+    assert (driver.variables ().size () == 3);
+    assert (driver.variables ().at ("device.model")[0] == "ePDU \"G3\"");
+    assert (driver.variables ().at ("ups.status")[0] == "OL");
+
+    // incremental updates, the same value is no change
+    s_write_driver (session, "SETINFO ups.status \"OL\"\n");
+    zclock_sleep (50);
+    assert (driver.receive ());
+    assert (!driver.takeChanged ());
+    s_write_driver (session, "SETINFO ups.status \"OB\"\nDELINFO outlet.1.current\nPING\n");
+    zclock_sleep (50);
+    assert (driver.receive ());
+    assert (driver.takeChanged ());
+    assert (driver.variables ().at ("ups.status")[0] == "OB");
+    assert (driver.variables ().count ("outlet.1.current") == 0);
+    assert (driver.updates () == 6);
+    n = read (session, buffer, sizeof (buffer) - 1);
+    assert (n == 5);
+    buffer [n] = 0;
+    assert (streq (buffer, "PONG\n"));
+
+    // stale data is not ready
+    s_write_driver (session, "DATASTALE\n");
+    zclock_sleep (50);
+    assert (driver.receive ());
+    assert (!driver.ready ());
+
+    // driver exits
+    close (session);
+    zclock_sleep (50);
+    assert (!driver.receive ());
+    assert (!driver.isConnected ());
+    // descriptor stays for zpoller_remove () until disconnect ()
+    assert (driver.isLost () && *driver.handle () >= 0);
+    driver.disconnect ();
+    assert (!driver.isLost () && *driver.handle () == -1);
+
+    close (server);
+    unlink (path.c_str ());
+    rmdir (stateDir);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,136 @@
+/*  =========================================================================
+    nut_driver_socket - connection to the state socket of a NUT driver
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_DRIVER_SOCKET_H_INCLUDED
+#define NUT_DRIVER_SOCKET_H_INCLUDED
+
+#include <string>
+
+#include "nut_snapshot.h"
+
+#define NUT_DRIVER_STATE_PATH           "/var/run/nut"  //!< where drivers create their sockets
+#define NUT_DRIVER_RECONNECT_MS         30000           //!< missing sockets are looked for again after this
+
+namespace drivers
+{
+namespace nut
+{
+
+/**
+ * \brief Client of the state socket of one NUT driver.
+ *
+ * Drivers tell upsd about every change of their variables over a unix
+ * socket. This client speaks the same protocol: it asks for DUMPALL once
+ * and then keeps the variables up to date from SETINFO/DELINFO lines as
+ * the driver pushes them. The session plugs into a zpoller loop:
+ *
+ *    NUTDriverSocket driver (NUTDriverSocket::find (NUT_DRIVER_STATE_PATH, "usbhid-ups", "ups"));
+ *    driver.connect ();
+ *    zpoller_add (poller, driver.handle ());
+ *    ...
+ *    if (which == driver.handle ()) {
+ *        if (!driver.receive ()) {
+ *            zpoller_remove (poller, driver.handle ());
+ *            driver.disconnect ();
+ *        }
+ *        else if (driver.takeChanged ()) use (driver.variables ());
+ *    }
+ *
+ * A lost session keeps its descriptor open until disconnect (), so the
+ * handle can still be taken out of the poller and its number is not
+ * reused meanwhile.
+ */
+class NUTDriverSocket {
+ public:
+    explicit NUTDriverSocket (const std::string& path);
+    NUTDriverSocket (const NUTDriverSocket&) = delete;
+    NUTDriverSocket& operator= (const NUTDriverSocket&) = delete;
+    ~NUTDriverSocket ();
+
+    //! \brief connect and ask for all variables, returns true when connected
+    bool connect ();
+    void disconnect ();
+    bool isConnected () const { return _fd >= 0 && !_lost; }
+    //! \brief true if the session was lost and the descriptor waits for disconnect ()
+    bool isLost () const { return _fd >= 0 && _lost; }
+
+    //! \brief file descriptor for zpoller_add (), -1 when disconnected
+    int *handle () { return &_fd; }
+    const std::string& path () const { return _path; }
+
+    /**
+     * \brief Read what is available on the socket and apply it.
+     * \return false if the session was lost, the caller disconnect ()s it
+     */
+    bool receive ();
+
+    //! \brief true when the whole dump arrived and the driver has fresh data
+    bool ready () const { return _dumped && !_stale; }
+
+    //! \brief variables as the driver has them now
+    const NUTVariables& variables () const { return _variables; }
+
+    //! \brief true if variables changed since last call
+    bool takeChanged ();
+
+    //! \brief number of SETINFO/DELINFO applied since connect
+    uint64_t updates () const { return _updates; }
+
+    /**
+     * \brief Path of the socket of driver serving nutName in stateDir.
+     *
+     * Drivers name their socket <driver>-<nutName>, driver being the
+     * driver.name variable of the device. The name is matched exactly,
+     * a suffix would take snmp-ups-epdu-1 for device pdu-1. Returns empty
+     * string if there is none or driver is not known.
+     */
+    static std::string find (const std::string& stateDir, const std::string& driver, const std::string& nutName);
+
+ private:
+    void send (const char *line);
+    //! \brief process one complete line of input
+    void dispatch (const char *line, size_t length);
+
+    std::string _path;
+    int _fd = -1;
+
+    std::string _input;                 //!< incomplete line
+    std::vector <std::string> _words;   //!< reused tokenizer output
+    NUTVariables _variables;
+    bool _dumped = false;               //!< DUMPDONE seen
+    bool _stale = false;                //!< DATASTALE seen, not followed by DATAOK
+    bool _changed = false;
+    bool _lost = false;                 //!< session lost, _fd still open
+    uint64_t _updates = 0;
+
+    //! \brief session lost, stop using it but keep _fd for the caller
+    void lose ();
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_driver_socket_test (bool verbose);
+//  @end
+
+#endif
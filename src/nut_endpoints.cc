@@ -0,0 +1,282 @@
+/*  =========================================================================
+    nut_endpoints - upsd endpoints and assignment of NUT devices to them
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_endpoints - upsd endpoints and assignment of NUT devices to them
+@discuss
+    Every endpoint has NUT_ENDPOINT_VNODES points on a ring of 32 bit
+    hashes, a device belongs to the first point at or after the hash of
+    its NUT name. The points are spread well enough to keep the load of
+    a few endpoints even.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <algorithm>
+
+namespace drivers
+{
+namespace nut
+{
+
+// FNV-1a
+static uint32_t
+s_hash (const std::string& text)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    // FNV alone clusters similar names, finish with a murmur mix
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// port number of text, false if it is not one
+static bool
+s_port (const std::string& text, int& port)
+{
+    try {
+        size_t end;
+        port = std::stoi (text, &end);
+        if (end != text.size ()) return false;
+    } catch (...) {
+        return false;
+    }
+    return port > 0 && port <= 65535;
+}
+
+bool NUTEndpoint::parse (const std::string& text, NUTEndpoint& endpoint)
+{
+    if (text.empty ()) return false;
+    NUTEndpoint result;
+    if (text[0] == '[') {
+        // IPv6 literal with a port is put in brackets
+        size_t bracket = text.find (']');
+        if (bracket == std::string::npos) return false;
+        result.host = text.substr (1, bracket - 1);
+        if (bracket + 1 < text.size ()) {
+            if (text[bracket + 1] != ':' || !s_port (text.substr (bracket + 2), result.port)) return false;
+        }
+    }
+    else
+    if (text.find (':') != text.rfind (':')) {
+        // bare IPv6 literal, no port
+        result.host = text;
+    }
+    else {
+        size_t colon = text.rfind (':');
+        result.host = text.substr (0, colon);
+        if (colon != std::string::npos && !s_port (text.substr (colon + 1), result.port)) return false;
+    }
+    if (result.host.empty ()) return false;
+    endpoint = result;
+    return true;
+}
+
+std::string NUTEndpoint::toString () const
+{
+    if (host.find (':') != std::string::npos) return "[" + host + "]:" + std::to_string (port);
+    return host + ":" + std::to_string (port);
+}
+
+NUTEndpoints::NUTEndpoints ()
+{
+    configure ({});
+}
+
+NUTEndpoints& NUTEndpoints::instance ()
+{
+    static NUTEndpoints endpoints;
+    return endpoints;
+}
+
+void NUTEndpoints::configure (const std::vector <std::string>& endpoints)
+{
+    std::vector <NUTEndpoint> parsed;
+    for (const auto& text : endpoints) {
+        NUTEndpoint endpoint;
+        if (! NUTEndpoint::parse (text, endpoint)) {
+            log_error ("invalid upsd endpoint '%s' ignored", text.c_str ());
+            continue;
+        }
+        if (std::find (parsed.begin (), parsed.end (), endpoint) == parsed.end ()) {
+            parsed.push_back (endpoint);
+        }
+    }
+    if (parsed.empty ()) parsed.push_back (NUTEndpoint ());
+
+    std::map <uint32_t, size_t> ring;
+    for (size_t i = 0; i < parsed.size (); ++i) {
+        std::string key = parsed[i].toString ();
+        for (int point = 0; point < NUT_ENDPOINT_VNODES; ++point) {
+            ring.emplace (s_hash (key + "#" + std::to_string (point)), i);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock (_mutex);
+    if (parsed.size () != _endpoints.size () || ! std::equal (parsed.begin (), parsed.end (), _endpoints.begin ())) {
+        log_info ("devices are read from %zu upsd endpoint(s)", parsed.size ());
+    }
+    _endpoints.swap (parsed);
+    _ring.swap (ring);
+}
+
+std::vector <NUTEndpoint> NUTEndpoints::endpoints () const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    return _endpoints;
+}
+
+std::vector <NUTEndpoint> NUTEndpoints::inUse () const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    std::vector <NUTEndpoint> endpoints = _endpoints;
+    for (const auto& assigned : _assigned) {
+        if (std::find (endpoints.begin (), endpoints.end (), assigned.second) == endpoints.end ()) {
+            endpoints.push_back (assigned.second);
+        }
+    }
+    return endpoints;
+}
+
+void NUTEndpoints::assign (const std::string& nutName, const std::string& endpoint)
+{
+    NUTEndpoint parsed;
+    bool valid = NUTEndpoint::parse (endpoint, parsed);
+    if (! valid && ! endpoint.empty ()) {
+        log_error ("invalid upsd endpoint '%s' of %s ignored", endpoint.c_str (), nutName.c_str ());
+    }
+    std::lock_guard<std::mutex> lock (_mutex);
+    if (valid) {
+        _assigned[nutName] = parsed;
+    }
+    else {
+        _assigned.erase (nutName);
+    }
+}
+
+NUTEndpoint NUTEndpoints::lookup (const std::string& nutName) const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto assigned = _assigned.find (nutName);
+    if (assigned != _assigned.end ()) return assigned->second;
+    if (_endpoints.size () == 1) return _endpoints.front ();
+    auto point = _ring.lower_bound (s_hash (nutName));
+    if (point == _ring.end ()) point = _ring.begin ();
+    return _endpoints[point->second];
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_endpoints_test (bool verbose)
+{
+    printf (" * nut_endpoints: ");
+
+    //  @selftest
+    using drivers::nut::NUTEndpoint;
+    using drivers::nut::NUTEndpoints;
+
+    NUTEndpoint endpoint;
+    assert (NUTEndpoint::parse ("10.0.0.2", endpoint));
+    assert (endpoint.host == "10.0.0.2" && endpoint.port == 3493);
+    assert (NUTEndpoint::parse ("upsd-2:3494", endpoint));
+    assert (endpoint.host == "upsd-2" && endpoint.port == 3494);
+    assert (endpoint.toString () == "upsd-2:3494");
+    assert (!NUTEndpoint::parse ("", endpoint));
+    assert (!NUTEndpoint::parse (":3493", endpoint));
+    assert (!NUTEndpoint::parse ("upsd-2:", endpoint));
+    assert (!NUTEndpoint::parse ("upsd-2:34x", endpoint));
+    assert (!NUTEndpoint::parse ("upsd-2:70000", endpoint));
+    // IPv6 literals, with a port in brackets only
+    assert (NUTEndpoint::parse ("::1", endpoint));
+    assert (endpoint.host == "::1" && endpoint.port == 3493);
+    assert (endpoint.toString () == "[::1]:3493");
+    assert (NUTEndpoint::parse ("[fd00::2]:3494", endpoint));
+    assert (endpoint.host == "fd00::2" && endpoint.port == 3494);
+    assert (NUTEndpoint::parse (endpoint.toString (), endpoint) && endpoint.host == "fd00::2");
+    assert (NUTEndpoint::parse ("[fd00::2]", endpoint) && endpoint.port == 3493);
+    assert (!NUTEndpoint::parse ("[fd00::2", endpoint));
+    assert (!NUTEndpoint::parse ("[fd00::2]3494", endpoint));
+    assert (!NUTEndpoint::parse ("[]:3494", endpoint));
+
+    // default is the local upsd
+    NUTEndpoints endpoints;
+    assert (endpoints.endpoints ().size () == 1);
+    assert (endpoints.lookup ("ups").toString () == "localhost:3493");
+
+    // devices are spread evenly and stay where they are
+    endpoints.configure ({ "localhost:3493", "localhost:3494", "bogus:port", "localhost:3494" });
+    assert (endpoints.endpoints ().size () == 2);
+    std::map <std::string, std::string> before;
+    std::map <std::string, int> load;
+    for (int i = 0; i < 1000; ++i) {
+        std::string name = "epdu-" + std::to_string (i);
+        before[name] = endpoints.lookup (name).toString ();
+        ++load[before[name]];
+        assert (endpoints.lookup (name).toString () == before[name]);
+    }
+    assert (load.size () == 2);
+    assert (load["localhost:3493"] > 300 && load["localhost:3494"] > 300);
+
+    // new endpoint takes about a third, the rest does not move
+    endpoints.configure ({ "localhost:3493", "localhost:3494", "localhost:3495" });
+    int moved = 0;
+    for (const auto& it : before) {
+        std::string now = endpoints.lookup (it.first).toString ();
+        if (now == it.second) continue;
+        assert (now == "localhost:3495");
+        ++moved;
+    }
+    assert (moved > 200 && moved < 500);
+
+    // asset attribute wins over hashing, empty one releases the device
+    endpoints.assign ("epdu-1", "upsd-9");
+    assert (endpoints.lookup ("epdu-1").toString () == "upsd-9:3493");
+    endpoints.assign ("epdu-1", "");
+    assert (endpoints.lookup ("epdu-1").toString () != "upsd-9:3493");
+    endpoints.assign ("epdu-1", "upsd-9:x");
+    assert (endpoints.lookup ("epdu-1").toString () != "upsd-9:3493");
+
+    // endpoints in use are the configured ones and those devices are pinned to
+    endpoints.assign ("epdu-2", "upsd-9");
+    endpoints.assign ("epdu-3", "upsd-9");
+    endpoints.assign ("epdu-4", "localhost:3494");
+    auto inUse = endpoints.inUse ();
+    assert (inUse.size () == 4 && inUse.back ().toString () == "upsd-9:3493");
+    endpoints.assign ("epdu-2", "");
+    endpoints.assign ("epdu-3", "");
+    assert (endpoints.inUse ().size () == 3);
+    //  @end
+    printf ("OK\n");
+}
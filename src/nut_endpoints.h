@@ -0,0 +1,110 @@
+/*  =========================================================================
+    nut_endpoints - upsd endpoints and assignment of NUT devices to them
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_ENDPOINTS_H_INCLUDED
+#define NUT_ENDPOINTS_H_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define NUT_ENDPOINT_DEFAULT_HOST   "localhost"
+#define NUT_ENDPOINT_DEFAULT_PORT   3493
+#define NUT_ENDPOINT_VNODES         64      //!< points of one endpoint on the hash ring
+#define NUT_ENDPOINT_ATTRIBUTE      "upsd"  //!< asset ext attribute pinning a device to an endpoint
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief one upsd instance
+struct NUTEndpoint {
+    std::string host = NUT_ENDPOINT_DEFAULT_HOST;
+    int port = NUT_ENDPOINT_DEFAULT_PORT;
+
+    //! \brief "host" or "host:port", an IPv6 literal bare or as "[addr]:port";
+    //!        false if port is not a number
+    static bool parse (const std::string& text, NUTEndpoint& endpoint);
+    //! \brief "host:port" ("[addr]:port" for IPv6), the key used by pollers and sessions
+    std::string toString () const;
+
+    bool operator== (const NUTEndpoint& other) const { return host == other.host && port == other.port; }
+    bool operator!= (const NUTEndpoint& other) const { return !(*this == other); }
+};
+
+/**
+ * \brief Process wide list of upsd endpoints serving NUT devices.
+ *
+ * A device pinned by the asset attribute NUT_ENDPOINT_ATTRIBUTE is read
+ * from that endpoint, others are spread by consistent hashing of their
+ * NUT name, so adding an endpoint moves only the devices it takes over.
+ * Without configuration everything goes to localhost:3493.
+ *
+ *    auto endpoint = NUTEndpoints::instance ().lookup ("ups");
+ *    auto conn = NUTConnectionPool::instance ().acquire (endpoint.host, endpoint.port);
+ */
+class NUTEndpoints {
+ public:
+    NUTEndpoints ();
+    NUTEndpoints (const NUTEndpoints&) = delete;
+    NUTEndpoints& operator= (const NUTEndpoints&) = delete;
+
+    //! \brief the endpoints shared by all actors of the process
+    static NUTEndpoints& instance ();
+
+    /**
+     * \brief Set the list of endpoints ("host[:port]").
+     *
+     * Invalid entries are logged and left out, an empty list means the
+     * default endpoint.
+     */
+    void configure (const std::vector <std::string>& endpoints);
+    std::vector <NUTEndpoint> endpoints () const;
+    //! \brief configured endpoints and the others devices are pinned to,
+    //!        what actors reading all devices have to ask
+    std::vector <NUTEndpoint> inUse () const;
+
+    //! \brief pin nutName to endpoint ("host[:port]"), empty string unpins
+    void assign (const std::string& nutName, const std::string& endpoint);
+
+    //! \brief endpoint serving nutName
+    NUTEndpoint lookup (const std::string& nutName) const;
+
+ private:
+    mutable std::mutex _mutex;
+    std::vector <NUTEndpoint> _endpoints;
+    //! \brief hash ring, point | index to _endpoints
+    std::map <uint32_t, size_t> _ring;
+    //! \brief nutName | endpoint given by asset
+    std::map <std::string, NUTEndpoint> _assigned;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_endpoints_test (bool verbose);
+//  @end
+
+#endif
@@ -0,0 +1,234 @@
+/*  =========================================================================
+    nut_interest - registry of metrics wanted by consumers
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_interest - registry of metrics wanted by consumers
+@discuss
+    Answers are cached per metric@asset, so the patterns are matched once
+    per metric after every change of the registry, not once per publish.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <algorithm>
+
+namespace drivers
+{
+namespace nut
+{
+
+const std::vector <std::string>& NUTInterest::core ()
+{
+    // what the UI, alerts and power computations rely on everywhere
+    static const std::vector <std::string> metrics = {
+        "status.*", "load.default", "load.input.*", "realpower.default", "power.default",
+        "current.input.*", "voltage.input.*", "charge.battery", "runtime.battery", "temperature.default"
+    };
+    return metrics;
+}
+
+bool NUTInterest::matches (const char *pattern, const char *text)
+{
+    // iterative glob, backtracks to the last '*' only
+    const char *star = NULL;
+    const char *resume = NULL;
+    while (*text) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        }
+        else if (*pattern == '?' || *pattern == *text) {
+            ++pattern;
+            ++text;
+        }
+        else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') ++pattern;
+    return *pattern == '\0';
+}
+
+void NUTInterest::enabled (bool enabled)
+{
+    if (enabled == _enabled) return;
+    _enabled = enabled;
+    changed ();
+}
+
+void NUTInterest::changed ()
+{
+    ++_generation;
+    _cache.clear ();
+}
+
+bool NUTInterest::add (const std::string& consumer, const std::string& metric, const std::string& asset, int64_t now)
+{
+    if (consumer.empty () || metric.empty () || asset.empty ()) return false;
+    if (now < 0) now = zclock_mono ();
+    Consumer& entry = _consumers[consumer];
+    entry.renewed = now;
+    NUTInterestPattern pattern (metric, asset);
+    if (std::find (entry.patterns.begin (), entry.patterns.end (), pattern) == entry.patterns.end ()) {
+        log_debug ("%s wants %s@%s", consumer.c_str (), metric.c_str (), asset.c_str ());
+        entry.patterns.push_back (pattern);
+        changed ();
+    }
+    return true;
+}
+
+void NUTInterest::remove (const std::string& consumer, const std::string& metric, const std::string& asset)
+{
+    auto it = _consumers.find (consumer);
+    if (it == _consumers.end ()) return;
+    auto& patterns = it->second.patterns;
+    auto pattern = std::find (patterns.begin (), patterns.end (), NUTInterestPattern (metric, asset));
+    if (pattern == patterns.end ()) return;
+    patterns.erase (pattern);
+    if (patterns.empty ()) _consumers.erase (it);
+    changed ();
+}
+
+void NUTInterest::clear (const std::string& consumer)
+{
+    if (_consumers.erase (consumer)) changed ();
+}
+
+std::vector <NUTInterestPattern> NUTInterest::list (const std::string& consumer) const
+{
+    auto it = _consumers.find (consumer);
+    if (it == _consumers.end ()) return std::vector <NUTInterestPattern> ();
+    return it->second.patterns;
+}
+
+bool NUTInterest::expire (int64_t now)
+{
+    if (now < 0) now = zclock_mono ();
+    bool expired = false;
+    for (auto it = _consumers.begin (); it != _consumers.end (); ) {
+        if (now - it->second.renewed < NUT_INTEREST_LEASE_MS) {
+            ++it;
+            continue;
+        }
+        log_info ("interest of %s expired", it->first.c_str ());
+        it = _consumers.erase (it);
+        expired = true;
+    }
+    if (expired) changed ();
+    return expired;
+}
+
+bool NUTInterest::wanted (const std::string& metric, const std::string& asset)
+{
+    if (!_enabled) return true;
+    std::string key = metric + "@" + asset;
+    auto cached = _cache.find (key);
+    if (cached != _cache.end ()) return cached->second;
+
+    bool result = false;
+    for (const auto& pattern : core ()) {
+        if (matches (pattern.c_str (), metric.c_str ())) {
+            result = true;
+            break;
+        }
+    }
+    for (auto it = _consumers.cbegin (); !result && it != _consumers.cend (); ++it) {
+        for (const auto& pattern : it->second.patterns) {
+            if (matches (pattern.first.c_str (), metric.c_str ()) && matches (pattern.second.c_str (), asset.c_str ())) {
+                result = true;
+                break;
+            }
+        }
+    }
+    _cache.emplace (key, result);
+    return result;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_interest_test (bool verbose)
+{
+    printf (" * nut_interest: ");
+
+    //  @selftest
+    using drivers::nut::NUTInterest;
+
+    assert (NUTInterest::matches ("*", ""));
+    assert (NUTInterest::matches ("realpower.*", "realpower.outlet.1"));
+    assert (NUTInterest::matches ("*.outlet.?", "current.outlet.1"));
+    assert (!NUTInterest::matches ("*.outlet.?", "current.outlet.10"));
+    assert (NUTInterest::matches ("epdu-*-a*", "epdu-12-ab"));
+    assert (!NUTInterest::matches ("epdu-*", "ups-1"));
+
+    // disabled wants everything
+    NUTInterest interest;
+    assert (interest.wanted ("current.outlet.1", "epdu-1"));
+
+    // enabled wants the core set and what was registered
+    interest.enabled (true);
+    uint64_t generation = interest.generation ();
+    assert (interest.wanted ("status.ups", "ups-1"));
+    assert (interest.wanted ("load.default", "epdu-1"));
+    assert (!interest.wanted ("current.outlet.1", "epdu-1"));
+    int64_t now = 1000000;
+    assert (interest.add ("fty-outage", "current.outlet.*", "epdu-*", now));
+    assert (!interest.add ("fty-outage", "", "epdu-*", now));
+    assert (interest.generation () != generation);
+    assert (interest.wanted ("current.outlet.1", "epdu-1"));
+    assert (!interest.wanted ("current.outlet.1", "rackcontroller-0"));
+    assert (!interest.wanted ("realpower.outlet.1", "epdu-1"));
+    assert (interest.list ("fty-outage").size () == 1);
+    assert (interest.consumers () == 1);
+
+    // same pattern again just renews the lease
+    generation = interest.generation ();
+    assert (interest.add ("fty-outage", "current.outlet.*", "epdu-*", now + NUT_INTEREST_LEASE_MS / 2));
+    assert (interest.generation () == generation);
+    assert (!interest.expire (now + NUT_INTEREST_LEASE_MS));
+    assert (interest.expire (now + NUT_INTEREST_LEASE_MS * 3 / 2));
+    assert (!interest.wanted ("current.outlet.1", "epdu-1"));
+    assert (interest.consumers () == 0);
+
+    // remove and clear
+    interest.add ("a", "realpower.*", "*", now);
+    interest.add ("a", "voltage.outlet.*", "*", now);
+    interest.add ("b", "realpower.*", "*", now);
+    interest.remove ("a", "realpower.*", "*");
+    assert (interest.wanted ("realpower.outlet.1", "epdu-1"));
+    interest.clear ("b");
+    assert (!interest.wanted ("realpower.outlet.1", "epdu-1"));
+    assert (interest.wanted ("voltage.outlet.1", "epdu-1"));
+    interest.remove ("a", "voltage.outlet.*", "*");
+    assert (interest.consumers () == 0);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,105 @@
+/*  =========================================================================
+    nut_interest - registry of metrics wanted by consumers
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_INTEREST_H_INCLUDED
+#define NUT_INTEREST_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define NUT_INTEREST_SUBJECT        "INTEREST"  //!< mailbox subject of registrations
+#define NUT_INTEREST_LEASE_MS       3600000     //!< registrations not renewed within this are dropped
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief metric and asset glob patterns ('*' and '?')
+typedef std::pair <std::string, std::string> NUTInterestPattern;
+
+/**
+ * \brief Which metrics of which assets someone listens to.
+ *
+ * Consumers register metric@asset patterns over the mailbox and renew
+ * them within NUT_INTEREST_LEASE_MS. When enabled, only the metrics
+ * matching some pattern and the core set (status, load, ...) needed by
+ * every site are fetched and published, otherwise everything is.
+ *
+ *    NUTInterest interest;
+ *    interest.enabled (true);
+ *    interest.add ("fty-metric-composite", "realpower.*", "epdu-*");
+ *    if (interest.wanted ("realpower.outlet.1", "epdu-1")) publish ();
+ */
+class NUTInterest {
+ public:
+    //! \brief get/set demand driven publishing, off wants everything
+    void enabled (bool enabled);
+    bool enabled () const { return _enabled; }
+
+    //! \brief register patterns of consumer at time now [ms], false if invalid
+    bool add (const std::string& consumer, const std::string& metric, const std::string& asset, int64_t now = -1);
+    void remove (const std::string& consumer, const std::string& metric, const std::string& asset);
+    void clear (const std::string& consumer);
+    std::vector <NUTInterestPattern> list (const std::string& consumer) const;
+
+    //! \brief drop registrations not renewed since now - NUT_INTEREST_LEASE_MS, true if any was
+    bool expire (int64_t now = -1);
+
+    //! \brief true if metric of asset is to be published
+    bool wanted (const std::string& metric, const std::string& asset);
+
+    //! \brief changes with every change of what is wanted
+    uint64_t generation () const { return _generation; }
+    size_t consumers () const { return _consumers.size (); }
+
+    //! \brief metrics published even if nobody registered them
+    static const std::vector <std::string>& core ();
+    //! \brief glob match of text, '*' is any string, '?' any character
+    static bool matches (const char *pattern, const char *text);
+
+ private:
+    struct Consumer {
+        std::vector <NUTInterestPattern> patterns;
+        int64_t renewed = 0;    //!< [ms] zclock_mono
+    };
+
+    void changed ();
+
+    bool _enabled = false;
+    std::map <std::string, Consumer> _consumers;
+    uint64_t _generation = 0;
+    //! \brief metric@asset | wanted, cleared on every change
+    std::unordered_map <std::string, bool> _cache;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_interest_test (bool verbose);
+//  @end
+
+#endif
@@ -0,0 +1,142 @@
+/*  =========================================================================
+    nut_keys - interned metric names and values addressed by them
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_keys - interned metric names and values addressed by them
+@discuss
+    The set of names is bounded by the mapping and the outlet counts of
+    the devices, so the table only grows during the first reads.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTKeys& NUTKeys::instance ()
+{
+    static NUTKeys keys;
+    return keys;
+}
+
+NUTKey NUTKeys::intern (const std::string& name)
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto it = _keys.find (name);
+    if (it != _keys.end ()) return it->second;
+    NUTKey key = static_cast <NUTKey> (_names.size ());
+    _names.push_back (name);
+    _keys.emplace (name, key);
+    return key;
+}
+
+NUTKey NUTKeys::find (const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    auto it = _keys.find (name);
+    return it == _keys.end () ? NUT_KEY_NONE : it->second;
+}
+
+const std::string& NUTKeys::name (NUTKey key) const
+{
+    static const std::string none;
+    std::lock_guard<std::mutex> lock (_mutex);
+    return key < _names.size () ? _names[key] : none;
+}
+
+size_t NUTKeys::size () const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    return _names.size ();
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_keys_test (bool verbose)
+{
+    printf (" * nut_keys: ");
+
+    //  @selftest
+    using drivers::nut::NUTKey;
+    using drivers::nut::NUTKeys;
+    using drivers::nut::NUTKeyedValues;
+
+    auto &keys = NUTKeys::instance ();
+    NUTKey load = keys.intern ("test.load.default");
+    NUTKey power = keys.intern ("test.realpower.default");
+    assert (load != power);
+    assert (keys.intern ("test.load.default") == load);
+    assert (keys.find ("test.realpower.default") == power);
+    assert (keys.find ("test.never.interned") == NUT_KEY_NONE);
+    assert (keys.name (power) == "test.realpower.default");
+    assert (keys.name (NUT_KEY_NONE).empty ());
+    // names stay in place while the table grows
+    const std::string &name = keys.name (load);
+    for (int i = 0; i < 1000; ++i) {
+        keys.intern ("test.outlet.realpower." + std::to_string (i));
+    }
+    assert (name == "test.load.default");
+
+    NUTKeyedValues <std::string> values;
+    assert (values.empty () && values.find (load) == NULL);
+    bool inserted = false;
+    values.insert (power, &inserted) = "100";
+    assert (inserted);
+    values.insert (load) = "42";
+    values.insert (power, &inserted) = "120";
+    assert (!inserted);
+    assert (values.size () == 2);
+    assert (*values.find (power) == "120" && *values.find (load) == "42");
+    // in order of arrival, new values are changed
+    assert (values.key (0) == power && values.key (1) == load);
+    assert (values.changed (0) && values.changed (1));
+    values.setChanged (false);
+    assert (!values.anyChanged ());
+    values.setChanged (values.slot (load), true);
+    assert (values.anyChanged () && values.changed (1) && !values.changed (0));
+    // dirty list keeps up with flags set and cleared in any order
+    NUTKeyedValues <int> many;
+    for (int i = 0; i < 10; ++i) many.insert (keys.intern ("test.outlet.realpower." + std::to_string (i))) = i;
+    assert (many.changedCount () == 10);
+    many.setChanged (false);
+    assert (!many.anyChanged () && many.changedSlots ().empty ());
+    for (size_t i : { 7, 2, 9, 4 }) many.setChanged (i, true);
+    many.setChanged (2, true);
+    many.setChanged (9, false);
+    assert ((many.changedSlots () == std::vector <size_t> { 2, 4, 7 }));
+    for (size_t i : many.changedSlots ()) many.setChanged (i, false);
+    assert (!many.anyChanged () && !many.changed (4));
+    many.setChanged (true);
+    assert (many.changedCount () == 10 && many.changed (9));
+    values.clear ();
+    assert (values.empty () && !values.contains (power));
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,189 @@
+/*  =========================================================================
+    nut_keys - interned metric names and values addressed by them
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_KEYS_H_INCLUDED
+#define NUT_KEYS_H_INCLUDED
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define NUT_KEY_NONE    UINT32_MAX  //!< key of a name never interned
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief dense id of an interned name
+typedef uint32_t NUTKey;
+
+/**
+ * \brief Process wide table of interned metric and inventory names.
+ *
+ * Names of the mapping are interned when mapping.conf is loaded, names
+ * expanded from '#' patterns (outlet.realpower.12) when first seen. Ids
+ * are dense and never reused, so per device values can be kept in arrays
+ * indexed by them.
+ *
+ *    NUTKey key = NUTKeys::instance ().intern ("load.default");
+ *    const std::string& name = NUTKeys::instance ().name (key);
+ */
+class NUTKeys {
+ public:
+    NUTKeys () = default;
+    NUTKeys (const NUTKeys&) = delete;
+    NUTKeys& operator= (const NUTKeys&) = delete;
+
+    //! \brief the table shared by all actors of the process
+    static NUTKeys& instance ();
+
+    //! \brief key of name, a new one if name was not interned yet
+    NUTKey intern (const std::string& name);
+    //! \brief key of name, NUT_KEY_NONE if name was not interned
+    NUTKey find (const std::string& name) const;
+    //! \brief name of key, it stays in place for the life of the process
+    const std::string& name (NUTKey key) const;
+    //! \brief number of interned names
+    size_t size () const;
+
+ private:
+    mutable std::mutex _mutex;
+    //! \brief key | name, deque does not move names when growing
+    std::deque <std::string> _names;
+    std::unordered_map <std::string, NUTKey> _keys;
+};
+
+/**
+ * \brief Values of one device addressed by interned key.
+ *
+ * Values are contiguous in the order they first came, so publishing is a
+ * linear scan; key to slot is one array lookup. Changed values are kept
+ * in a dirty list as well, so walking or clearing just them costs what
+ * changed, not what the device has.
+ *
+ *    NUTKeyedValues <std::string> values;
+ *    values.insert (key) = "230";
+ *    for (size_t i : values.changedSlots ()) ...
+ */
+template <typename T>
+class NUTKeyedValues {
+ public:
+    //! \brief slot of key, SIZE_MAX if there is no value
+    size_t slot (NUTKey key) const {
+        return key < _slots.size () && _slots[key] ? _slots[key] - 1 : SIZE_MAX;
+    }
+    T *find (NUTKey key) {
+        size_t i = slot (key);
+        return i == SIZE_MAX ? NULL : &_values[i];
+    }
+    const T *find (NUTKey key) const {
+        size_t i = slot (key);
+        return i == SIZE_MAX ? NULL : &_values[i];
+    }
+    bool contains (NUTKey key) const { return slot (key) != SIZE_MAX; }
+
+    //! \brief value of key, default constructed and flagged changed if new
+    T& insert (NUTKey key, bool *inserted = NULL) {
+        if (key >= _slots.size ()) _slots.resize (key + 1, 0);
+        bool added = _slots[key] == 0;
+        if (added) {
+            _keys.push_back (key);
+            _values.emplace_back ();
+            _dirtyAt.push_back (0);
+            _slots[key] = static_cast <uint32_t> (_values.size ());
+            setChanged (_values.size () - 1, true);
+        }
+        if (inserted) *inserted = added;
+        return _values[_slots[key] - 1];
+    }
+
+    size_t size () const { return _values.size (); }
+    bool empty () const { return _values.empty (); }
+    NUTKey key (size_t i) const { return _keys[i]; }
+    T& value (size_t i) { return _values[i]; }
+    const T& value (size_t i) const { return _values[i]; }
+
+    bool changed (size_t i) const { return _dirtyAt[i] != 0; }
+    void setChanged (size_t i, bool status) {
+        if (status == changed (i)) return;
+        if (status) {
+            _dirty.push_back (static_cast <uint32_t> (i));
+            _dirtyAt[i] = static_cast <uint32_t> (_dirty.size ());
+        }
+        else {
+            // the last one takes the place of the one leaving
+            uint32_t at = _dirtyAt[i] - 1;
+            _dirty[at] = _dirty.back ();
+            _dirtyAt[_dirty[at]] = at + 1;
+            _dirty.pop_back ();
+            _dirtyAt[i] = 0;
+        }
+    }
+    void setChanged (bool status) {
+        if (status) {
+            for (size_t i = 0; i < _values.size (); ++i) setChanged (i, true);
+            return;
+        }
+        for (uint32_t i : _dirty) _dirtyAt[i] = 0;
+        _dirty.clear ();
+    }
+    bool anyChanged () const { return !_dirty.empty (); }
+    size_t changedCount () const { return _dirty.size (); }
+    //! \brief slots of the changed values in the order they came, a copy to
+    //!        clear flags while walking it
+    std::vector <size_t> changedSlots () const {
+        std::vector <size_t> result (_dirty.begin (), _dirty.end ());
+        std::sort (result.begin (), result.end ());
+        return result;
+    }
+
+    void clear () {
+        _slots.clear ();
+        _keys.clear ();
+        _values.clear ();
+        _dirty.clear ();
+        _dirtyAt.clear ();
+    }
+
+ private:
+    //! \brief key | slot + 1, 0 if key has no value
+    std::vector <uint32_t> _slots;
+    std::vector <NUTKey> _keys;
+    std::vector <T> _values;
+    //! \brief slots of changed values, in no particular order
+    std::vector <uint32_t> _dirty;
+    //! \brief slot | its place in _dirty + 1, 0 if not changed
+    std::vector <uint32_t> _dirtyAt;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_keys_test (bool verbose);
+//  @end
+
+#endif
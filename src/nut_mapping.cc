@@ -0,0 +1,261 @@
+/*  =========================================================================
+    nut_mapping - mapping.conf compiled into a lookup by NUT variable name
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_mapping - mapping.conf compiled into a lookup by NUT variable name
+@discuss
+    Names of NUT variables are bounded by the drivers and outlet counts,
+    so remembering every name seen costs little and saves walking the
+    patterns on every update.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace drivers
+{
+namespace nut
+{
+
+bool NUTMapping::matches (const std::string& pattern, const char *name)
+{
+    for (char c : pattern) {
+        if (c == '#') {
+            if (!isdigit (*name)) return false;
+            while (isdigit (*name)) ++name;
+        }
+        else if (c != *name++) {
+            return false;
+        }
+    }
+    return *name == '\0';
+}
+
+std::string NUTMapping::expand (const std::string& pattern, const char *name, const std::string& metric)
+{
+    std::vector <std::string> numbers;
+    for (char c : pattern) {
+        if (c == '#') {
+            const char *start = name;
+            while (isdigit (*name)) ++name;
+            numbers.emplace_back (start, name);
+        }
+        else {
+            ++name;
+        }
+    }
+    std::string result;
+    size_t next = 0;
+    for (char c : metric) {
+        if (c == '#' && next < numbers.size ()) result += numbers[next++];
+        else result += c;
+    }
+    return result;
+}
+
+bool NUTDeadband::parse (const std::string& text, NUTDeadband& deadband)
+{
+    NUTDeadband result;
+    size_t start = 0;
+    while (start < text.size ()) {
+        size_t end = text.find (',', start);
+        if (end == std::string::npos) end = text.size ();
+        std::string part = text.substr (start, end - start);
+        start = end + 1;
+        part.erase (0, part.find_first_not_of (" \t"));
+        part.erase (part.find_last_not_of (" \t") + 1);
+        if (part.empty ()) continue;
+        bool percent = part.back () == '%';
+        if (percent) part.pop_back ();
+        char *rest = NULL;
+        double number = strtod (part.c_str (), &rest);
+        if (part.empty () || *rest != '\0' || number < 0) return false;
+        (percent ? result.percent : result.absolute) = number;
+    }
+    deadband = result;
+    return true;
+}
+
+bool NUTDeadband::exceeded (double old, double value) const
+{
+    double band = std::max (absolute, std::fabs (old) * percent / 100);
+    return std::fabs (value - old) > band;
+}
+
+void NUTMapping::compile (const std::map <std::string, std::string>& physicsMapping,
+                          const std::map <std::string, std::string>& inventoryMapping,
+                          const std::map <std::string, std::string>& deadbands,
+                          const std::vector <std::string>& rules)
+{
+    auto &keys = NUTKeys::instance ();
+    auto split = [&keys] (const std::map <std::string, std::string>& mapping,
+                          std::unordered_map <std::string, NUTKey>& exact, Patterns& patterns) {
+        exact.clear ();
+        patterns.clear ();
+        for (const auto& item : mapping) {
+            if (item.first.find ('#') != std::string::npos) {
+                patterns.emplace_back (item.first, item.second);
+            }
+            else {
+                exact.emplace (item.first, keys.intern (item.second));
+            }
+        }
+    };
+    split (physicsMapping, _physicsExact, _physicsPatterns);
+    split (inventoryMapping, _inventoryExact, _inventoryPatterns);
+    _resolved.clear ();
+    _deadbands.clear ();
+    _deadbandOf.clear ();
+    for (const auto& item : deadbands) {
+        NUTDeadband deadband;
+        if (!NUTDeadband::parse (item.second, deadband)) {
+            log_error ("deadband '%s' of %s is not like \"0.5\", \"1%%\" or \"0.5, 1%%\"", item.second.c_str (), item.first.c_str ());
+            continue;
+        }
+        _deadbands.emplace (item.first, deadband);
+    }
+    _rules.compile (rules);
+    log_debug ("mapping compiled to %zu exact entries and %zu patterns",
+               _physicsExact.size () + _inventoryExact.size (), _physicsPatterns.size () + _inventoryPatterns.size ());
+}
+
+NUTKey NUTMapping::lookup (const std::unordered_map <std::string, NUTKey>& exact, const Patterns& patterns,
+                           const std::string& name)
+{
+    auto it = exact.find (name);
+    if (it != exact.end ()) return it->second;
+    for (const auto& pattern : patterns) {
+        if (matches (pattern.first, name.c_str ())) {
+            return NUTKeys::instance ().intern (expand (pattern.first, name.c_str (), pattern.second));
+        }
+    }
+    return NUT_KEY_NONE;
+}
+
+const NUTDeadband& NUTMapping::deadband (NUTKey key) const
+{
+    static const NUTDeadband none;
+    if (key == NUT_KEY_NONE) return none;
+    if (key >= _deadbandOf.size ()) _deadbandOf.resize (key + 1);
+    auto &entry = _deadbandOf[key];
+    if (!entry.first) {
+        const std::string &name = NUTKeys::instance ().name (key);
+        auto it = _deadbands.find (name);
+        if (it == _deadbands.end ()) it = _deadbands.find (name.substr (0, name.find ('.')));
+        entry.second = it == _deadbands.end () ? none : it->second;
+        entry.first = true;
+    }
+    return entry.second;
+}
+
+NUTMappedVariable NUTMapping::resolve (const std::string& name) const
+{
+    auto it = _resolved.find (name);
+    if (it != _resolved.end ()) return it->second;
+    if (_resolved.size () >= NUT_MAPPING_RESOLVED_MAX) {
+        // some driver makes names up, do not grow without bound
+        _resolved.clear ();
+    }
+    NUTMappedVariable target;
+    target.physics = lookup (_physicsExact, _physicsPatterns, name);
+    target.inventory = lookup (_inventoryExact, _inventoryPatterns, name);
+    return _resolved.emplace (name, target).first->second;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_mapping_test (bool verbose)
+{
+    printf (" * nut_mapping: ");
+
+    //  @selftest
+    using drivers::nut::NUTKey;
+    using drivers::nut::NUTKeys;
+    using drivers::nut::NUTMapping;
+
+    assert (NUTMapping::matches ("outlet.#.current", "outlet.12.current"));
+    assert (!NUTMapping::matches ("outlet.#.current", "outlet.x.current"));
+    assert (!NUTMapping::matches ("outlet.#.current", "outlet.1.current.status"));
+    assert (NUTMapping::expand ("outlet.#.current", "outlet.12.current", "current.outlet.#") == "current.outlet.12");
+
+    NUTMapping mapping;
+    mapping.compile (
+        { { "ups.load", "load.default" }, { "outlet.#.current", "current.outlet.#" }, { "ups.status", "status.ups" } },
+        { { "device.model", "model" }, { "outlet.#.desc", "outlet.#.label" }, { "ups.status", "status.ups" } });
+    auto &keys = NUTKeys::instance ();
+
+    auto load = mapping.resolve ("ups.load");
+    assert (keys.name (load.physics) == "load.default" && load.inventory == NUT_KEY_NONE);
+    auto model = mapping.resolve ("device.model");
+    assert (model.physics == NUT_KEY_NONE && keys.name (model.inventory) == "model");
+    // one variable may feed both
+    auto status = mapping.resolve ("ups.status");
+    assert (status.physics == status.inventory && keys.name (status.physics) == "status.ups");
+    // any number, not just the ones in a row from 1
+    assert (keys.name (mapping.resolve ("outlet.7.current").physics) == "current.outlet.7");
+    assert (keys.name (mapping.resolve ("outlet.7.desc").inventory) == "outlet.7.label");
+    auto none = mapping.resolve ("driver.version");
+    assert (none.physics == NUT_KEY_NONE && none.inventory == NUT_KEY_NONE);
+    // unmapped names are remembered too
+    size_t resolved = mapping.resolved ();
+    mapping.resolve ("driver.version");
+    mapping.resolve ("outlet.7.current");
+    assert (mapping.resolved () == resolved);
+
+    // a new mapping forgets what was resolved by the old one
+    mapping.compile ({ { "ups.load", "load.input" } }, {});
+    assert (mapping.resolved () == 0);
+    assert (keys.name (mapping.resolve ("ups.load").physics) == "load.input");
+    assert (mapping.resolve ("outlet.7.current").physics == NUT_KEY_NONE);
+
+    // deadbands
+    drivers::nut::NUTDeadband band;
+    assert (drivers::nut::NUTDeadband::parse ("0.5", band) && band.absolute == 0.5 && band.percent == 0);
+    assert (drivers::nut::NUTDeadband::parse (" 0.5, 1% ", band) && band.absolute == 0.5 && band.percent == 1);
+    assert (!drivers::nut::NUTDeadband::parse ("half", band) && !drivers::nut::NUTDeadband::parse ("-1", band));
+    assert (band.exceeded (10, 10.6) && !band.exceeded (10, 10.5));
+    assert (band.exceeded (230, 232.4) && !band.exceeded (230, 232.2));
+    assert (!drivers::nut::NUTDeadband ().exceeded (230.1, 230.10));
+
+    mapping.compile ({ { "input.voltage", "voltage.input.L1" }, { "input.frequency", "frequency.input" } }, {},
+                     { { "voltage", "1" }, { "voltage.input.L1", "2%" }, { "current", "bogus" } });
+    NUTKey voltage = mapping.resolve ("input.voltage").physics;
+    assert (mapping.deadband (voltage).percent == 2 && mapping.deadband (voltage).absolute == 0);
+    assert (mapping.deadband (keys.intern ("voltage.output.L1")).absolute == 1);
+    NUTKey frequency = mapping.resolve ("input.frequency").physics;
+    assert (mapping.deadband (frequency).absolute == 0 && mapping.deadband (frequency).percent == 0);
+    assert (mapping.deadband (keys.intern ("current.input.L1")).absolute == 0);
+
+    // rules come along, malformed ones left out
+    mapping.compile ({}, {}, {}, { "input.phases = 1", "input.phases =" });
+    assert (mapping.rules ().size () == 1 && mapping.rules ().input ("input.phases"));
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,141 @@
+/*  =========================================================================
+    nut_mapping - mapping.conf compiled into a lookup by NUT variable name
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_MAPPING_H_INCLUDED
+#define NUT_MAPPING_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nut_keys.h"
+#include "nut_rules.h"
+
+#define NUT_MAPPING_RESOLVED_MAX    65536   //!< variable names remembered, all are forgotten above
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief where one NUT variable goes, NUT_KEY_NONE for nowhere
+struct NUTMappedVariable {
+    NUTKey physics = NUT_KEY_NONE;
+    NUTKey inventory = NUT_KEY_NONE;
+};
+
+/**
+ * \brief How far a numeric metric may move before it counts as changed.
+ *
+ * The band is the larger of absolute and percent of the last published
+ * value, so "0.5, 1%" lets 230 V move by 2.3 V and 10 V by 0.5 V. No band
+ * still ignores changes of the text only, like 230.1 and 230.10.
+ */
+struct NUTDeadband {
+    double absolute = 0;
+    double percent = 0;
+
+    //! \brief parse "0.5", "1%" or both separated by a comma, false if malformed
+    static bool parse (const std::string& text, NUTDeadband& deadband);
+    //! \brief true if value moved from old by more than the band
+    bool exceeded (double old, double value) const;
+};
+
+/**
+ * \brief Physics and inventory mapping compiled for a single pass over
+ *        the variables of a device.
+ *
+ * Exact entries go to hash tables by variable name. Patterns, where '#'
+ * stands for a number (outlet.#.current -> current.outlet.#), are tried
+ * the first time a variable name is seen; the outcome, mapped or not, is
+ * remembered by name, so a device update costs one lookup per variable
+ * received whatever the size of the mapping.
+ *
+ *    mapping.compile (physicsMapping, inventoryMapping);
+ *    for (const auto& item : vars) {
+ *        auto target = mapping.resolve (item.first);
+ *        if (target.physics != NUT_KEY_NONE) updatePhysics (target.physics, item.second);
+ *    }
+ */
+class NUTMapping {
+ public:
+    /**
+     * \brief take both mappings, names they map to are interned
+     *
+     * deadbands are given by metric name ("voltage.input.L1") or by
+     * quantity, its first part ("voltage"); the metric name wins.
+     * rules derive variables the device does not give, see NUTRules.
+     */
+    void compile (const std::map <std::string, std::string>& physicsMapping,
+                  const std::map <std::string, std::string>& inventoryMapping,
+                  const std::map <std::string, std::string>& deadbands = {},
+                  const std::vector <std::string>& rules = {});
+
+    //! \brief targets of NUT variable name, daisy chain prefix removed
+    NUTMappedVariable resolve (const std::string& name) const;
+
+    //! \brief number of variable names resolved so far
+    size_t resolved () const { return _resolved.size (); }
+
+    //! \brief deadband of metric key, remembered by key
+    const NUTDeadband& deadband (NUTKey key) const;
+
+    //! \brief rules deriving variables before they are mapped
+    const NUTRules& rules () const { return _rules; }
+
+    //! \brief true if name matches pattern, where # stands for a number
+    static bool matches (const std::string& pattern, const char *name);
+    //! \brief name variable name matching pattern maps to, '#' of metric
+    //!        gets the number matched by '#' of pattern
+    static std::string expand (const std::string& pattern, const char *name, const std::string& metric);
+
+ private:
+    typedef std::vector <std::pair <std::string, std::string>> Patterns;
+
+    //! \brief metric of name by exact entry or pattern, NUT_KEY_NONE if none
+    static NUTKey lookup (const std::unordered_map <std::string, NUTKey>& exact, const Patterns& patterns,
+                          const std::string& name);
+
+    std::unordered_map <std::string, NUTKey> _physicsExact;
+    std::unordered_map <std::string, NUTKey> _inventoryExact;
+    //! \brief variable pattern | metric pattern, in order of mapping.conf keys
+    Patterns _physicsPatterns;
+    Patterns _inventoryPatterns;
+    //! \brief variable name | its targets, filled as names come
+    mutable std::unordered_map <std::string, NUTMappedVariable> _resolved;
+    //! \brief metric name or quantity | its deadband
+    std::unordered_map <std::string, NUTDeadband> _deadbands;
+    //! \brief key | its deadband, known once first asked for
+    mutable std::vector <std::pair <bool, NUTDeadband>> _deadbandOf;
+    NUTRules _rules;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_mapping_test (bool verbose);
+//  @end
+
+#endif
@@ -0,0 +1,225 @@
+/*  =========================================================================
+    nut_outlet_table - outlet values of one device in columns by outlet number
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_outlet_table - outlet values of one device in columns by outlet number
+@discuss
+    Loops over the columns have no early exit and keep independent
+    partial results, so the compiler can vectorize them without
+    reassociating floating point math.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace drivers
+{
+namespace nut
+{
+
+static const double s_missing = std::numeric_limits <double>::quiet_NaN ();
+
+// column of outlet.N.<field>, COLUMNS if none
+static size_t
+s_column (const char *field)
+{
+    static const char *fields [] = { "current", "realpower", "voltage", "status" };
+    for (size_t i = 0; i < sizeof (fields) / sizeof (fields[0]); ++i) {
+        if (strcmp (field, fields[i]) == 0) return i;
+    }
+    return sizeof (fields) / sizeof (fields[0]);
+}
+
+void NUTOutletTable::reset ()
+{
+    for (auto &column : _values) {
+        std::fill (column.begin (), column.end (), s_missing);
+    }
+}
+
+void NUTOutletTable::clear ()
+{
+    for (size_t i = 0; i < COLUMNS; ++i) {
+        _values[i].clear ();
+        _committed[i].clear ();
+    }
+}
+
+bool NUTOutletTable::take (const char *name, const std::vector <std::string>& value)
+{
+    if (strncmp (name, "outlet.", 7) != 0 || !isdigit (name[7])) return false;
+    char *rest = NULL;
+    unsigned long outlet = strtoul (name + 7, &rest, 10);
+    if (*rest != '.' || outlet == 0 || outlet > NUT_OUTLET_TABLE_MAX) return false;
+    size_t column = s_column (rest + 1);
+    if (column == COLUMNS) return false;
+
+    double number = s_missing;
+    if (value.size () == 1) {
+        const std::string &text = value[0];
+        if (column == static_cast <size_t> (NUTOutletColumn::STATUS)) {
+            number = text == "on" ? NUT_OUTLET_ON : text == "off" ? NUT_OUTLET_OFF : NUT_OUTLET_OTHER;
+        }
+        else if (!text.empty ()) {
+            number = strtod (text.c_str (), &rest);
+            if (*rest != '\0') number = s_missing;
+        }
+    }
+    auto &values = _values[column];
+    if (values.size () <= outlet) values.resize (outlet + 1, s_missing);
+    values[outlet] = number;
+    return true;
+}
+
+double NUTOutletTable::value (NUTOutletColumn column, size_t outlet) const
+{
+    const auto &values = _values[static_cast <size_t> (column)];
+    return outlet < values.size () ? values[outlet] : s_missing;
+}
+
+size_t NUTOutletTable::outlets (NUTOutletColumn column) const
+{
+    const auto &values = _values[static_cast <size_t> (column)];
+    size_t count = 0;
+    while (count + 1 < values.size () && !std::isnan (values[count + 1])) ++count;
+    return count;
+}
+
+double NUTOutletTable::sum (NUTOutletColumn column, size_t limit) const
+{
+    size_t count = std::min (limit, outlets (column));
+    if (count == 0) return s_missing;
+    const double *values = _values[static_cast <size_t> (column)].data () + 1;
+    // four partial sums, one per lane
+    double partial [4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        partial[0] += values[i];
+        partial[1] += values[i + 1];
+        partial[2] += values[i + 2];
+        partial[3] += values[i + 3];
+    }
+    for (; i < count; ++i) partial[0] += values[i];
+    return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+size_t NUTOutletTable::changed (NUTOutletColumn column) const
+{
+    const auto &values = _values[static_cast <size_t> (column)];
+    const auto &committed = _committed[static_cast <size_t> (column)];
+    size_t common = std::min (values.size (), committed.size ());
+    size_t count = 0;
+    for (size_t i = 1; i < common; ++i) {
+        // NaN equals NaN here, a missing value stays missing
+        double a = values[i], b = committed[i];
+        count += (a != b) & ((a == a) | (b == b));
+    }
+    // outlets seen on one side only
+    const auto &longer = values.size () > committed.size () ? values : committed;
+    for (size_t i = std::max <size_t> (common, 1); i < longer.size (); ++i) {
+        count += !std::isnan (longer[i]);
+    }
+    return count;
+}
+
+void NUTOutletTable::commit (NUTOutletColumn column)
+{
+    _committed[static_cast <size_t> (column)] = _values[static_cast <size_t> (column)];
+}
+
+NUTKey NUTOutletTable::statusKey (size_t outlet)
+{
+    if (outlet >= _statusKeys.size ()) _statusKeys.resize (outlet + 1, NUT_KEY_NONE);
+    NUTKey &key = _statusKeys[outlet];
+    if (key == NUT_KEY_NONE) key = NUTKeys::instance ().intern ("status.outlet." + std::to_string (outlet));
+    return key;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_outlet_table_test (bool verbose)
+{
+    printf (" * nut_outlet_table: ");
+
+    //  @selftest
+    using drivers::nut::NUTOutletColumn;
+    using drivers::nut::NUTOutletTable;
+
+    NUTOutletTable table;
+    assert (table.outlets (NUTOutletColumn::REALPOWER) == 0);
+    assert (std::isnan (table.sum (NUTOutletColumn::REALPOWER)) && std::isnan (table.value (NUTOutletColumn::CURRENT, 1)));
+
+    assert (!table.take ("outlet.count", { "10" }));
+    assert (!table.take ("outlet.1.desc", { "PSU A" }));
+    assert (!table.take ("outlet.0.realpower", { "1" }));
+    assert (!table.take ("outlet.realpower", { "1" }));
+    assert (!table.take ("outlet.1.current.status", { "good" }));
+    for (int i = 1; i <= 10; ++i) {
+        assert (table.take (("outlet." + std::to_string (i) + ".realpower").c_str (), { std::to_string (i * 10) }));
+        table.take (("outlet." + std::to_string (i) + ".status").c_str (), { i % 2 ? "on" : "off" });
+    }
+    table.take ("outlet.3.current", { "0.5" });
+    table.take ("outlet.1.current", { "0.25" });
+    table.take ("outlet.12.realpower", { "1000" });
+    table.take ("outlet.2.voltage", { "n/a" });
+
+    // sums stop at the first missing outlet, values past it are kept
+    assert (table.outlets (NUTOutletColumn::REALPOWER) == 10);
+    assert (table.sum (NUTOutletColumn::REALPOWER) == 550);
+    assert (table.sum (NUTOutletColumn::REALPOWER, 3) == 60);
+    assert (table.value (NUTOutletColumn::REALPOWER, 12) == 1000);
+    assert (table.outlets (NUTOutletColumn::CURRENT) == 1 && table.sum (NUTOutletColumn::CURRENT) == 0.25);
+    assert (table.value (NUTOutletColumn::CURRENT, 3) == 0.5);
+    assert (std::isnan (table.value (NUTOutletColumn::VOLTAGE, 2)) && std::isnan (table.value (NUTOutletColumn::VOLTAGE, 99)));
+    assert (table.value (NUTOutletColumn::STATUS, 1) == NUT_OUTLET_ON && table.value (NUTOutletColumn::STATUS, 2) == NUT_OUTLET_OFF);
+
+    // changes against the last commit
+    assert (table.changed (NUTOutletColumn::STATUS) == 10);
+    table.commit (NUTOutletColumn::STATUS);
+    assert (table.changed (NUTOutletColumn::STATUS) == 0);
+    table.take ("outlet.4.status", { "on" });
+    table.take ("outlet.11.status", { "off" });
+    assert (table.changed (NUTOutletColumn::STATUS) == 2);
+    table.commit (NUTOutletColumn::STATUS);
+    table.reset ();
+    assert (table.outlets (NUTOutletColumn::REALPOWER) == 0);
+    assert (table.changed (NUTOutletColumn::STATUS) == 11);
+    table.commit (NUTOutletColumn::STATUS);
+    assert (table.changed (NUTOutletColumn::STATUS) == 0);
+
+    // keys are interned once
+    drivers::nut::NUTKey key = table.statusKey (7);
+    assert (drivers::nut::NUTKeys::instance ().name (key) == "status.outlet.7" && table.statusKey (7) == key);
+    table.clear ();
+    assert (table.changed (NUTOutletColumn::STATUS) == 0 && std::isnan (table.value (NUTOutletColumn::REALPOWER, 12)));
+    //  @end
+    printf ("OK\n");
+}
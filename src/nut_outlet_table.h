@@ -0,0 +1,111 @@
+/*  =========================================================================
+    nut_outlet_table - outlet values of one device in columns by outlet number
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_OUTLET_TABLE_H_INCLUDED
+#define NUT_OUTLET_TABLE_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "nut_keys.h"
+
+#define NUT_OUTLET_TABLE_MAX    1024    //!< highest outlet number kept, ePDUs have up to 48
+
+#define NUT_OUTLET_OFF          0       //!< STATUS column of outlet.N.status "off"
+#define NUT_OUTLET_ON           1       //!< STATUS column of outlet.N.status "on"
+#define NUT_OUTLET_OTHER        2       //!< STATUS column of any other outlet.N.status
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief CURRENT, REALPOWER and VOLTAGE are there for sum () of the derived rules
+enum class NUTOutletColumn {
+    CURRENT,        //!< outlet.N.current
+    REALPOWER,      //!< outlet.N.realpower
+    VOLTAGE,        //!< outlet.N.voltage
+    STATUS,         //!< outlet.N.status, as NUT_OUTLET_ON, NUT_OUTLET_OFF or NUT_OUTLET_OTHER
+};
+
+/**
+ * \brief Outlet variables of one device as arrays indexed by outlet number.
+ *
+ * ePDUs give tens of outlets with the same few variables each. Kept as
+ * one array of doubles per variable, a missing or non numeric value
+ * being NaN, sums and comparison with the last commit are plain loops
+ * over contiguous memory instead of a lookup by name per outlet.
+ *
+ * Only the derived rules (sums) and the status.outlet.N advertisement
+ * read it. Per-outlet metrics like current.outlet.N stay string keyed in
+ * the physics of NUTDevice, they need its deadbands and per key dirty
+ * flags.
+ *
+ *    table.reset ();
+ *    for (const auto& item : vars) table.take (item.first.c_str (), item.second);
+ *    double power = table.sum (NUTOutletColumn::REALPOWER);
+ *    if (table.changed (NUTOutletColumn::STATUS)) ...; table.commit (NUTOutletColumn::STATUS);
+ */
+class NUTOutletTable {
+ public:
+    //! \brief mark all values missing, outlets seen keep their place
+    void reset ();
+    //! \brief forget everything, committed values too
+    void clear ();
+
+    /**
+     * \brief keep value of NUT variable name (daisy chain prefix removed)
+     * \return true if name is outlet.N.current, realpower, voltage or status
+     */
+    bool take (const char *name, const std::vector <std::string>& value);
+
+    //! \brief value of outlet number, NaN if missing
+    double value (NUTOutletColumn column, size_t outlet) const;
+    //! \brief number of outlets from 1 with a value, up to the first missing
+    size_t outlets (NUTOutletColumn column) const;
+    //! \brief sum over the first min (limit, outlets ()) outlets, NaN if there is none
+    double sum (NUTOutletColumn column, size_t limit = SIZE_MAX) const;
+
+    //! \brief number of outlets whose value differs from the last commit ()
+    size_t changed (NUTOutletColumn column) const;
+    void commit (NUTOutletColumn column);
+
+    //! \brief key of metric status.outlet.N
+    NUTKey statusKey (size_t outlet);
+
+ private:
+    static const size_t COLUMNS = 4;
+    //! \brief column | outlet number | value, slot 0 unused
+    std::vector <double> _values [COLUMNS];
+    std::vector <double> _committed [COLUMNS];
+    //! \brief outlet number | key of status.outlet.N, NUT_KEY_NONE until asked
+    std::vector <NUTKey> _statusKeys;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_outlet_table_test (bool verbose);
+//  @end
+
+#endif
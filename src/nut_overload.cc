@@ -0,0 +1,144 @@
+/*  =========================================================================
+    nut_overload - degradation level of polling under sustained overruns
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_overload - degradation level of polling under sustained overruns
+@discuss
+    A single overrun is carried over by the next update anyway, only
+    overruns in several polling intervals in a row mean the devices can
+    not be read at the configured pace. Steps up and down are counted in
+    whole windows, so the level does not flap with every update.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+const char *NUTOverload::name (NUTOverloadLevel level)
+{
+    switch (level) {
+        case NUTOverloadLevel::NONE:      return "none";
+        case NUTOverloadLevel::INVENTORY: return "inventory";
+        case NUTOverloadLevel::DEVICES:   return "devices";
+        case NUTOverloadLevel::OUTLETS:   return "outlets";
+    }
+    return "unknown";
+}
+
+void NUTOverload::record (bool overrun, int64_t now, int64_t interval)
+{
+    if (_windowStart == 0) _windowStart = now;
+    _windowOverrun = _windowOverrun || overrun;
+    if (now - _windowStart < interval) return;
+
+    // window closed, one step at most
+    NUTOverloadLevel level = _level;
+    if (_windowOverrun) {
+        _quietWindows = 0;
+        if (++_overrunWindows >= NUT_OVERLOAD_ESCALATE && _level != NUTOverloadLevel::OUTLETS) {
+            level = static_cast <NUTOverloadLevel> (static_cast <int> (_level) + 1);
+            _overrunWindows = 0;
+        }
+    }
+    else {
+        _overrunWindows = 0;
+        if (++_quietWindows >= NUT_OVERLOAD_RECOVER && _level != NUTOverloadLevel::NONE) {
+            level = static_cast <NUTOverloadLevel> (static_cast <int> (_level) - 1);
+            _quietWindows = 0;
+        }
+    }
+    if (level > _level) {
+        log_warning ("polling can not keep up, degradation level raised to %s", name (level));
+    }
+    else if (level < _level) {
+        log_info ("polling keeps up again, degradation level lowered to %s", name (level));
+    }
+    if (level != _level) {
+        _level = level;
+        ++_changes;
+    }
+    _windowStart = now;
+    _windowOverrun = false;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_overload_test (bool verbose)
+{
+    printf (" * nut_overload: ");
+
+    //  @selftest
+    using drivers::nut::NUTOverload;
+    using drivers::nut::NUTOverloadLevel;
+
+    NUTOverload overload;
+    assert (overload.level () == NUTOverloadLevel::NONE);
+    assert (streq (NUTOverload::name (NUTOverloadLevel::DEVICES), "devices"));
+
+    // overruns within one window count once
+    int64_t now = 1000;
+    for (int i = 0; i < 10; ++i) {
+        overload.record (true, now, 1000);
+        now += 10;
+    }
+    assert (overload.level () == NUTOverloadLevel::NONE);
+
+    // sustained overruns go up one level per NUT_OVERLOAD_ESCALATE windows
+    for (int window = 0; window < NUT_OVERLOAD_ESCALATE; ++window) {
+        now += 1000;
+        overload.record (true, now, 1000);
+    }
+    assert (overload.level () == NUTOverloadLevel::INVENTORY);
+    for (int window = 0; window < 10 * NUT_OVERLOAD_ESCALATE; ++window) {
+        now += 1000;
+        overload.record (true, now, 1000);
+    }
+    assert (overload.level () == NUTOverloadLevel::OUTLETS);
+    assert (overload.changes () == 3);
+
+    // a quiet window in between starts escalation over, recovery is slower
+    now += 1000;
+    overload.record (false, now, 1000);
+    assert (overload.level () == NUTOverloadLevel::OUTLETS);
+    for (int window = 1; window < NUT_OVERLOAD_RECOVER; ++window) {
+        now += 1000;
+        overload.record (false, now, 1000);
+    }
+    assert (overload.level () == NUTOverloadLevel::DEVICES);
+    for (int window = 0; window < 10 * NUT_OVERLOAD_RECOVER; ++window) {
+        now += 1000;
+        overload.record (false, now, 1000);
+    }
+    assert (overload.level () == NUTOverloadLevel::NONE);
+    assert (overload.changes () == 6);
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,83 @@
+/*  =========================================================================
+    nut_overload - degradation level of polling under sustained overruns
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_OVERLOAD_H_INCLUDED
+#define NUT_OVERLOAD_H_INCLUDED
+
+#define NUT_OVERLOAD_ESCALATE   3   //!< polling intervals in a row with overruns to go one level up
+#define NUT_OVERLOAD_RECOVER    5   //!< polling intervals in a row without overruns to go one level down
+#define NUT_OVERLOAD_STRETCH    4   //!< degraded reads are done this many times less often
+#define NUT_OVERLOAD_METRIC     "degradation.level" //!< metric of the agent carrying the level
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief what is given up, every level includes the ones below
+enum class NUTOverloadLevel {
+    NONE = 0,   //!< everything on time
+    INVENTORY,  //!< inventory and schema refresh deferred
+    DEVICES,    //!< low priority devices read NUT_OVERLOAD_STRETCH times less often
+    OUTLETS     //!< outlet variables read NUT_OVERLOAD_STRETCH times less often, not their alert ones
+};
+
+/**
+ * \brief Degradation policy of the polling actor.
+ *
+ * Every update reports whether it overran its budget. After
+ * NUT_OVERLOAD_ESCALATE polling intervals in a row with an overrun the
+ * level goes one step up, after NUT_OVERLOAD_RECOVER intervals in a row
+ * without one it goes one step down. Status and alert variables are
+ * never degraded, they have the status lane.
+ *
+ *    overload.record (skipped > 0, now, pollingInterval);
+ *    if (overload.level () >= NUTOverloadLevel::DEVICES) stretch ();
+ */
+class NUTOverload {
+ public:
+    //! \brief account one update at now [ms], interval [ms] is the length of a window
+    void record (bool overrun, int64_t now, int64_t interval);
+
+    NUTOverloadLevel level () const { return _level; }
+    //! \brief number of level changes since start
+    uint64_t changes () const { return _changes; }
+
+    static const char *name (NUTOverloadLevel level);
+
+ private:
+    NUTOverloadLevel _level = NUTOverloadLevel::NONE;
+    int64_t _windowStart = 0;       //!< [ms] start of the current window, 0 before first record
+    bool _windowOverrun = false;
+    int _overrunWindows = 0;        //!< windows in a row with an overrun
+    int _quietWindows = 0;          //!< windows in a row without
+    uint64_t _changes = 0;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_overload_test (bool verbose);
+//  @end
+
+#endif
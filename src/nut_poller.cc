@@ -0,0 +1,508 @@
+/*  =========================================================================
+    nut_poller - parallel polling of NUT devices
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_poller - parallel polling of NUT devices
+@discuss
+    Worker threads take device names from the queue of their endpoint and
+    store the variables in the slot of the caller's result vector. Merging the
+    results into NUTDevice objects is left to the calling thread, so the
+    device list itself is never touched by the workers.
+
+    A worker stuck on a hung driver can't be interrupted. The caller just
+    stops waiting for it at the deadline, and the worker drops its late
+    result (the batch is shared, so it is still there). The upsd session
+    has the same timeout, so the worker is not lost for long.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTPoller::NUTPoller (size_t workers, NUTFetchFunction fetchFunction) :
+    _workerCount (std::max<size_t> (1, std::min<size_t> (workers, NUT_POLLER_MAX_WORKERS))),
+    _fetchFunction (fetchFunction)
+{
+}
+
+NUTPoller::~NUTPoller ()
+{
+    stop ();
+}
+
+void NUTPoller::workers (size_t count)
+{
+    count = std::max<size_t> (1, std::min<size_t> (count, NUT_POLLER_MAX_WORKERS));
+    if (count == _workerCount) return;
+    log_info ("number of polling workers changed from %zu to %zu", _workerCount, count);
+    stop ();
+    _workerCount = count;
+}
+
+NUTPoller::Lane& NUTPoller::lane (const std::string& endpoint)
+{
+    auto it = _lanes.find (endpoint);
+    if (it != _lanes.end ()) return it->second;
+    Lane& lane = _lanes[endpoint];
+    _stop = false;
+    for (size_t i = 0; i < _workerCount; ++i) {
+        lane.threads.emplace_back (&NUTPoller::run, this, &lane);
+    }
+    return lane;
+}
+
+void NUTPoller::stop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        _stop = true;
+    }
+    _jobReady.notify_all ();
+    for (auto& lane : _lanes) {
+        for (auto& thread : lane.second.threads) {
+            thread.join ();
+        }
+    }
+    _lanes.clear ();
+}
+
+void NUTPoller::retain (const std::set <std::string>& endpoints)
+{
+    std::vector <std::string> retired;
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        for (auto& lane : _lanes) {
+            if (endpoints.count (lane.first) || ! lane.second.jobs.empty ()) continue;
+            bool running = false;
+            for (const auto& priority : lane.second.running) {
+                if (priority.second > 0) running = true;
+            }
+            if (running) continue;
+            lane.second.stop = true;
+            retired.push_back (lane.first);
+        }
+    }
+    if (retired.empty ()) return;
+    _jobReady.notify_all ();
+    // fetch () runs on the caller thread, nothing is queued to these meanwhile
+    for (const auto& endpoint : retired) {
+        for (auto& thread : _lanes[endpoint].threads) {
+            thread.join ();
+        }
+    }
+    std::lock_guard<std::mutex> lock (_mutex);
+    for (const auto& endpoint : retired) {
+        _lanes.erase (endpoint);
+    }
+    log_debug ("workers of %zu upsd endpoint(s) not used anymore stopped", retired.size ());
+}
+
+size_t NUTPoller::lanes () const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    return _lanes.size ();
+}
+
+std::deque <NUTPoller::Job>::iterator NUTPoller::next (Lane *lane)
+{
+    auto best = lane->jobs.end ();
+    for (auto it = lane->jobs.begin (); it != lane->jobs.end (); ++it) {
+        const auto& request = it->batch->requests[it->index];
+        if (best != lane->jobs.end () && request.priority <= best->batch->requests[best->index].priority) continue;
+        if (request.workerShare > 0) {
+            size_t share = std::max<size_t> (1, _workerCount * request.workerShare / 100);
+            if (lane->running[request.priority] >= share) continue;
+        }
+        best = it;
+    }
+    return best;
+}
+
+void NUTPoller::run (Lane *lane)
+{
+    while (true) {
+        Job job;
+        int64_t deadline;
+        int priority;
+        {
+            std::unique_lock<std::mutex> lock (_mutex);
+            auto it = lane->jobs.end ();
+            _jobReady.wait (lock, [this, lane, &it] { return _stop || lane->stop || (it = next (lane)) != lane->jobs.end (); });
+            if (_stop || lane->stop) return;
+            job = std::move (*it);
+            lane->jobs.erase (it);
+            priority = job.batch->requests[job.index].priority;
+            ++lane->running[priority];
+            job.batch->states[job.index] = JobState::RUNNING;
+            job.batch->started[job.index] = zclock_mono ();
+            deadline = _deadline;
+        }
+        NUTPollResult result;
+        _fetchFunction (job.batch->requests[job.index], result, deadline);
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock (_mutex);
+            --lane->running[priority];
+            // the caller may have given up on us meanwhile
+            if (job.batch->states[job.index] == JobState::RUNNING) {
+                job.batch->results[job.index] = std::move (result);
+                job.batch->states[job.index] = JobState::DONE;
+                --job.batch->pending;
+                done = true;
+            }
+        }
+        // a job held back by its share may go now
+        _jobReady.notify_all ();
+        if (done) _jobDone.notify_one ();
+    }
+}
+
+void NUTPoller::fetchOne (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline)
+{
+    if (request.variables.empty ()) {
+        fetchAll (request, result, deadline);
+    }
+    else {
+        fetchSelected (request, result, deadline);
+    }
+}
+
+void NUTPoller::fetchAll (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline)
+{
+    const std::string& name = request.name;
+    NUTEndpoint endpoint;
+    NUTEndpoint::parse (request.endpoint, endpoint);
+    auto connection = NUTConnectionPool::instance ().acquire (endpoint.host, endpoint.port);
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!connection) {
+            result.error = "upsd " + endpoint.toString () + " is not reachable";
+            result.unreachable = true;
+            return;
+        }
+        try {
+            // nutclient counts in whole seconds
+            connection->setTimeout ((deadline + 999) / 1000);
+            nutclient::Device nutDevice = connection->getDevice (name);
+            if (! nutDevice.isOk ()) {
+                result.error = "device " + name + " is not configured in NUT yet";
+                return;
+            }
+            result.vars = nutDevice.getVariableValues ();
+            result.ok = true;
+            return;
+        } catch (nutclient::TimeoutException& e) {
+            // late answer would confuse the next request, drop the session
+            result.error = e.what ();
+            result.timedOut = true;
+            connection.reconnect ();
+            return;
+        } catch (nutclient::IOException& e) {
+            // broken session, one more try on a fresh one
+            result.error = e.what ();
+            result.unreachable = true;
+            connection.reconnect ();
+        } catch (std::exception& e) {
+            result.error = e.what ();
+            return;
+        }
+    }
+}
+
+void NUTPoller::fetchSelected (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline)
+{
+    // one session per worker and endpoint, kept for the life of the thread
+    static thread_local std::map <std::string, std::unique_ptr <NUTAsyncClient>> clients;
+    NUTEndpoint endpoint;
+    NUTEndpoint::parse (request.endpoint, endpoint);
+    auto& session = clients[request.endpoint];
+    if (!session) {
+        session.reset (new NUTAsyncClient (endpoint.host, endpoint.port));
+    }
+    NUTAsyncClient& client = *session;
+    if (!client.isConnected () && !client.connect ()) {
+        result.error = "upsd " + endpoint.toString () + " is not reachable";
+        result.unreachable = true;
+        return;
+    }
+    std::string error;
+    for (const auto& variable : request.variables) {
+        client.getVar (request.name, variable,
+            [&result, &error] (const NUTAsyncReply& reply) {
+                if (reply.ok) {
+                    result.vars[reply.vars[0].first] = { reply.vars[0].second };
+                }
+                else if (reply.error != "VAR-NOT-SUPPORTED" && error.empty ()) {
+                    error = reply.error;
+                }
+            });
+    }
+    if (!client.wait (deadline)) {
+        // late answers would be taken for the next device, start over
+        bool timedOut = client.isConnected ();
+        client.disconnect ();
+        result.vars.clear ();
+        result.error = timedOut ? "no answer within " + std::to_string (deadline) + " ms" : "connection lost";
+        result.timedOut = timedOut;
+        result.unreachable = !timedOut;
+        return;
+    }
+    if (!error.empty ()) {
+        result.vars.clear ();
+        result.error = error;
+        return;
+    }
+    result.ok = true;
+}
+
+std::vector <NUTPollResult> NUTPoller::fetch (const std::vector <std::string>& names, int64_t deadline, int64_t budget)
+{
+    std::vector <NUTPollRequest> requests;
+    requests.reserve (names.size ());
+    for (const auto& name : names) {
+        requests.emplace_back (name);
+    }
+    return fetch (requests, deadline, budget);
+}
+
+std::vector <NUTPollResult> NUTPoller::fetch (const std::vector <NUTPollRequest>& requests, int64_t deadline, int64_t budget)
+{
+    if (requests.empty ()) return std::vector <NUTPollResult> ();
+
+    const size_t count = requests.size ();
+    auto batch = std::make_shared <Batch> ();
+    batch->requests = requests;
+    batch->results.resize (count);
+    batch->states.resize (count, JobState::QUEUED);
+    batch->started.resize (count, 0);
+    batch->pending = count;
+
+    std::unique_lock<std::mutex> lock (_mutex);
+    _deadline = deadline;
+    for (size_t i = 0; i < count; ++i) {
+        lane (requests[i].endpoint).jobs.push_back (Job { batch, i });
+    }
+    _jobReady.notify_all ();
+
+    int64_t end = budget > 0 ? zclock_mono () + budget : INT64_MAX;
+    while (batch->pending > 0) {
+        // wake up for the budget or the first running device to give up
+        int64_t wakeup = end;
+        for (size_t i = 0; i < count; ++i) {
+            if (batch->states[i] == JobState::RUNNING) {
+                wakeup = std::min (wakeup, batch->started[i] + deadline);
+            }
+        }
+        if (wakeup == INT64_MAX) {
+            _jobDone.wait (lock);
+        }
+        else {
+            int64_t timeout = wakeup - zclock_mono ();
+            if (timeout > 0) {
+                _jobDone.wait_for (lock, std::chrono::milliseconds (timeout));
+            }
+        }
+
+        int64_t now = zclock_mono ();
+        for (size_t i = 0; i < count; ++i) {
+            if (batch->states[i] == JobState::RUNNING && now >= batch->started[i] + deadline) {
+                // the worker comes back by itself, its answer is thrown away
+                auto& result = batch->results[i];
+                result.timedOut = true;
+                result.error = "no answer within " + std::to_string (deadline) + " ms";
+                batch->states[i] = JobState::DONE;
+                --batch->pending;
+            }
+        }
+        if (now >= end) {
+            // devices not started yet wait for the next fetch
+            for (auto& lane : _lanes) {
+                auto& jobs = lane.second.jobs;
+                for (auto it = jobs.begin (); it != jobs.end (); ) {
+                    if (it->batch != batch) { ++it; continue; }
+                    auto& result = batch->results[it->index];
+                    result.skipped = true;
+                    result.error = "polling budget exhausted";
+                    batch->states[it->index] = JobState::DONE;
+                    --batch->pending;
+                    it = jobs.erase (it);
+                }
+            }
+            end = INT64_MAX;
+        }
+    }
+    return std::move (batch->results);
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_poller_test (bool verbose)
+{
+    printf (" * nut_poller: ");
+
+    //  @selftest
+    drivers::nut::NUTPoller poller (3);
+    assert (poller.workers () == 3);
+    poller.workers (0);
+    assert (poller.workers () == 1);
+    poller.workers (2);
+
+    // no upsd in test environment, every device must come back as failed,
+    // each in its own slot
+    std::vector <std::string> names = { "ups-1", "epdu-1", "sts-1" };
+    auto results = poller.fetch (names);
+    assert (results.size () == names.size ());
+    for (const auto& result : results) {
+        assert (!result.ok);
+        assert (!result.error.empty ());
+    }
+    assert (poller.fetch (std::vector <std::string> ()).empty ());
+
+    // devices stuck in a fetch wait for the gate, the test opens it when
+    // done, so no outcome depends on how fast the machine is
+    struct Gate {
+        std::mutex mutex;
+        std::condition_variable opened;
+        bool open = false;
+        void wait () {
+            std::unique_lock<std::mutex> lock (mutex);
+            opened.wait (lock, [this] { return open; });
+        }
+        void release () {
+            { std::lock_guard<std::mutex> lock (mutex); open = true; }
+            opened.notify_all ();
+        }
+    } gate;
+
+    // hung device is given up at the deadline, the others still answer
+    auto fake = [&gate] (const drivers::nut::NUTPollRequest& request, drivers::nut::NUTPollResult& result, int64_t) {
+        if (request.name == "hung") gate.wait ();
+        result.ok = true;
+    };
+    drivers::nut::NUTPoller fakePoller (2, fake);
+    results = fakePoller.fetch ({ "hung", "ups-1", "ups-2" }, 1000);
+    assert (!results[0].ok && results[0].timedOut);
+    assert (results[1].ok && results[2].ok);
+
+    // one free worker (the other is still hung) is taken by the next hung
+    // device, devices not started within the budget are skipped
+    results = fakePoller.fetch ({ "ups-1", "hung", "ups-3", "ups-4" }, 1000, 200);
+    assert (results[0].ok);
+    assert (!results[1].ok && results[1].timedOut);
+    assert (!results[2].ok && results[2].skipped && !results[2].timedOut);
+    assert (!results[3].ok && results[3].skipped && !results[3].timedOut);
+
+    // every endpoint has its own workers, a hung upsd does not hold back the others
+    std::mutex seenMutex;
+    std::map <std::string, std::string> seen;
+    auto perEndpoint = [&seen, &seenMutex, &gate] (const drivers::nut::NUTPollRequest& request, drivers::nut::NUTPollResult& result, int64_t) {
+        if (request.endpoint == "upsd-1:3493") gate.wait ();
+        std::lock_guard<std::mutex> lock (seenMutex);
+        seen[request.name] = request.endpoint;
+        result.ok = true;
+    };
+    drivers::nut::NUTPoller lanePoller (1, perEndpoint);
+    std::vector <drivers::nut::NUTPollRequest> requests = {
+        { "ups-1", {}, "upsd-1:3493" },
+        { "ups-2", {}, "upsd-1:3493" },
+        { "ups-3", {}, "upsd-2:3493" },
+        { "ups-4", {}, "upsd-2:3493" },
+    };
+    results = lanePoller.fetch (requests, 1000, 200);
+    assert (!results[0].ok && results[0].timedOut);
+    assert (!results[1].ok && results[1].skipped);
+    assert (results[2].ok && results[3].ok);
+    {
+        std::lock_guard<std::mutex> lock (seenMutex);
+        assert (seen.size () == 2 && seen["ups-3"] == "upsd-2:3493");
+    }
+
+    // higher priority starts first, a share keeps a priority from taking
+    // all workers
+    std::vector <std::string> order;
+    auto ordered = [&order, &seenMutex, &gate] (const drivers::nut::NUTPollRequest& request, drivers::nut::NUTPollResult& result, int64_t) {
+        {
+            std::lock_guard<std::mutex> lock (seenMutex);
+            order.push_back (request.name);
+        }
+        if (request.name == "bulk-hung") gate.wait ();
+        result.ok = true;
+    };
+    drivers::nut::NUTPoller classPoller (1, ordered);
+    requests = {
+        { "bulk-1", {}, "", -1, 0 },
+        { "std-1", {}, "", 0, 0 },
+        { "crit-1", {}, "", 1, 0 },
+    };
+    results = classPoller.fetch (requests, 1000);
+    assert (results[0].ok && results[1].ok && results[2].ok);
+    assert ((order == std::vector <std::string> { "crit-1", "std-1", "bulk-1" }));
+
+    order.clear ();
+    classPoller.workers (2);
+    requests = {
+        { "bulk-hung", {}, "", -1, 50 },
+        { "bulk-2", {}, "", -1, 50 },
+        { "std-1", {}, "", 0, 0 },
+    };
+    results = classPoller.fetch (requests, 1000, 200);
+    // one worker only for bulk, bulk-2 waits for the hung one although
+    // the other worker is free once std-1 is done
+    assert (!results[0].ok && results[0].timedOut);
+    assert (!results[1].ok && results[1].skipped);
+    assert (results[2].ok);
+    {
+        std::lock_guard<std::mutex> lock (seenMutex);
+        assert ((order == std::vector <std::string> { "std-1", "bulk-hung" }) ||
+                (order == std::vector <std::string> { "bulk-hung", "std-1" }));
+    }
+
+    // workers of endpoints gone are stopped once idle
+    assert (lanePoller.lanes () == 2);
+    lanePoller.retain ({ "upsd-2:3493" });
+    // upsd-1 still has its worker stuck
+    assert (lanePoller.lanes () == 2);
+
+    // let the hung workers go before the pollers join them
+    gate.release ();
+    // the stuck worker comes back and drops its late answer
+    for (int i = 0; i < 500 && lanePoller.lanes () == 2; ++i) {
+        lanePoller.retain ({ "upsd-2:3493" });
+        if (lanePoller.lanes () == 2) zclock_sleep (10);
+    }
+    assert (lanePoller.lanes () == 1);
+    lanePoller.retain ({});
+    assert (lanePoller.lanes () == 0);
+    results = lanePoller.fetch ({ { "ups-1", {}, "upsd-1:3493" }, { "ups-3", {}, "upsd-2:3493" } }, 1000);
+    assert (results[0].ok && results[1].ok);
+    assert (lanePoller.lanes () == 2);
+    //  @end
+    printf ("OK\n");
+}
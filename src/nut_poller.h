@@ -0,0 +1,190 @@
+/*  =========================================================================
+    nut_poller - parallel polling of NUT devices
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_POLLER_H_INCLUDED
+#define NUT_POLLER_H_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NUT_POLLER_DEFAULT_WORKERS  4
+#define NUT_POLLER_MAX_WORKERS      64
+#define NUT_POLLER_DEFAULT_DEADLINE 5000    //!< [ms] to wait for one device
+#define NUT_POLLER_DEFAULT_BUDGET   15000   //!< [ms] to start the devices of one fetch
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief outcome of fetching one NUT device
+struct NUTPollResult {
+    bool ok = false;
+    std::string error;
+    std::map <std::string, std::vector <std::string>> vars;
+    bool timedOut = false;  //!< device did not answer within the deadline
+    bool skipped = false;   //!< not even asked, the budget ran out first
+    bool unreachable = false;   //!< upsd itself failed, says nothing about the device
+};
+
+//! \brief what to fetch from one NUT device
+struct NUTPollRequest {
+    //! \brief member initializers end aggregate init in C++11, so brace init goes through here
+    NUTPollRequest () = default;
+    NUTPollRequest (const std::string& name_, const std::vector <std::string>& variables_ = {},
+                    const std::string& endpoint_ = "", int priority_ = 0, unsigned workerShare_ = 0) :
+        name (name_), variables (variables_), endpoint (endpoint_), priority (priority_), workerShare (workerShare_) {}
+
+    std::string name;
+    //! \brief variables to read by GET VAR, all variables (LIST VAR) if empty
+    std::vector <std::string> variables;
+    //! \brief "host:port" of upsd serving the device, default one if empty
+    std::string endpoint;
+    //! \brief requests of higher priority are started first
+    int priority = 0;
+    //! \brief percent of the workers of the endpoint requests of this priority
+    //!        may take at once, 0 for all
+    unsigned workerShare = 0;
+};
+
+//! \brief fetch of one device, has to give up after deadline [ms]
+typedef std::function <void (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline)> NUTFetchFunction;
+
+/**
+ * \brief Bounded pool of workers fetching NUT devices in parallel.
+ *
+ * Each worker leases its own upsd session from NUTConnectionPool, so one
+ * slow driver only blocks its worker. A cycle takes roughly the sum of
+ * device latencies divided by the number of workers.
+ *
+ * Every upsd endpoint has its own queue and workers, so a slow upsd does
+ * not hold back the devices of the others. Within an endpoint, requests
+ * of higher priority are started first and a priority can be kept from
+ * taking all workers.
+ */
+class NUTPoller {
+ public:
+    explicit NUTPoller (size_t workers = NUT_POLLER_DEFAULT_WORKERS, NUTFetchFunction fetchFunction = NUTPoller::fetchOne);
+    NUTPoller (const NUTPoller&) = delete;
+    NUTPoller& operator= (const NUTPoller&) = delete;
+    ~NUTPoller ();
+
+    //! \brief get/set the number of workers per endpoint (threads are restarted on change)
+    void workers (size_t count);
+    size_t workers () const { return _workerCount; }
+
+    /**
+     * \brief Stop the workers of endpoints not in endpoints ("host:port").
+     *
+     * Lanes with queued or running jobs (a worker stuck on a hung driver)
+     * are kept until a later call finds them idle.
+     */
+    void retain (const std::set <std::string>& endpoints);
+    //! \brief number of endpoints with workers
+    size_t lanes () const;
+
+    /**
+     * \brief Fetch all variables of given NUT devices.
+     *
+     * Result i belongs to requests[i]. A device not answering within deadline
+     * [ms] is given up (timedOut). Devices not started within budget [ms]
+     * are not asked at all (skipped), so the call returns after budget +
+     * deadline at worst. Zero budget waits for all devices.
+     */
+    std::vector <NUTPollResult> fetch (const std::vector <NUTPollRequest>& requests,
+                                       int64_t deadline = NUT_POLLER_DEFAULT_DEADLINE,
+                                       int64_t budget = 0);
+    //! \brief fetch all variables of given NUT devices
+    std::vector <NUTPollResult> fetch (const std::vector <std::string>& names,
+                                       int64_t deadline = NUT_POLLER_DEFAULT_DEADLINE,
+                                       int64_t budget = 0);
+
+    /**
+     * \brief Default fetch of a device from upsd.
+     *
+     * All variables are listed through NUTConnectionPool. Selected ones are
+     * asked by GET VAR pipelined on a NUTAsyncClient of the worker thread,
+     * variables the device does not support are left out of the result.
+     */
+    static void fetchOne (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline);
+
+ private:
+    enum class JobState { QUEUED, RUNNING, DONE };
+    //! \brief one fetch () call, outlives it if a worker is given up
+    struct Batch {
+        std::vector <NUTPollRequest> requests;
+        std::vector <NUTPollResult> results;
+        std::vector <JobState> states;
+        std::vector <int64_t> started;  //!< [ms] zclock_mono
+        size_t pending = 0;
+    };
+    struct Job {
+        std::shared_ptr <Batch> batch;
+        size_t index;
+    };
+
+    //! \brief jobs and workers of one endpoint
+    struct Lane {
+        std::deque <Job> jobs;
+        std::vector <std::thread> threads;
+        //! \brief priority | jobs of it running now
+        std::map <int, size_t> running;
+        bool stop = false;  //!< workers of this lane only are to return
+    };
+
+    //! \brief lane of endpoint, workers are started with it, _mutex held
+    Lane& lane (const std::string& endpoint);
+    //! \brief first queued job of lane of the highest priority within its worker share, _mutex held
+    std::deque <Job>::iterator next (Lane *lane);
+    void stop ();
+    void run (Lane *lane);
+    static void fetchAll (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline);
+    static void fetchSelected (const NUTPollRequest& request, NUTPollResult& result, int64_t deadline);
+
+    size_t _workerCount;
+    NUTFetchFunction _fetchFunction;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _jobReady;
+    std::condition_variable _jobDone;
+    //! \brief endpoint | its lane, map keeps lanes in place for their workers
+    std::map <std::string, Lane> _lanes;
+    int64_t _deadline = NUT_POLLER_DEFAULT_DEADLINE;    //!< [ms] of the current fetch ()
+    bool _stop = false;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_poller_test (bool verbose);
+//  @end
+
+#endif
@@ -0,0 +1,102 @@
+/*  =========================================================================
+    nut_qos - polling classes of devices given by asset attribute
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_qos - polling classes of devices given by asset attribute
+@discuss
+    A daisy chain is read once for all its members, so it is polled in
+    the class of its most important member.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <strings.h>
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTQosLevel NUTQos::parse (const char *text)
+{
+    if (!text || streq (text, "")) return NUTQosLevel::STANDARD;
+    for (auto level : { NUTQosLevel::CRITICAL, NUTQosLevel::STANDARD, NUTQosLevel::BULK }) {
+        if (strcasecmp (text, name (level)) == 0) return level;
+    }
+    log_error ("unknown QoS '%s', using %s", text, name (NUTQosLevel::STANDARD));
+    return NUTQosLevel::STANDARD;
+}
+
+const NUTQosClass& NUTQos::schedule (NUTQosLevel level)
+{
+    static const NUTQosClass classes [] = {
+        { "critical", 1, 1, 100, 1 },
+        { "standard", 1, NUT_POLLING_CEILING_FACTOR, 100, 0 },
+        { "bulk", 2, NUT_POLLING_CEILING_FACTOR, 50, -1 },
+    };
+    return classes [static_cast <int> (level)];
+}
+
+bool NUTQos::lowPriority (NUTQosLevel level, const char *subtype)
+{
+    return level == NUTQosLevel::BULK ||
+        (level == NUTQosLevel::STANDARD && (!subtype || !streq (subtype, "ups")));
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_qos_test (bool verbose)
+{
+    printf (" * nut_qos: ");
+
+    //  @selftest
+    using drivers::nut::NUTQos;
+    using drivers::nut::NUTQosLevel;
+
+    assert (NUTQos::parse (NULL) == NUTQosLevel::STANDARD);
+    assert (NUTQos::parse ("") == NUTQosLevel::STANDARD);
+    assert (NUTQos::parse ("critical") == NUTQosLevel::CRITICAL);
+    assert (NUTQos::parse ("Bulk") == NUTQosLevel::BULK);
+    assert (streq (NUTQos::name (NUTQosLevel::BULK), "bulk"));
+
+    // classes are ordered by importance
+    const auto& critical = NUTQos::schedule (NUTQosLevel::CRITICAL);
+    const auto& standard = NUTQos::schedule (NUTQosLevel::STANDARD);
+    const auto& bulk = NUTQos::schedule (NUTQosLevel::BULK);
+    assert (critical.priority > standard.priority && standard.priority > bulk.priority);
+    assert (critical.ceilingFactor <= standard.ceilingFactor);
+    assert (bulk.intervalFactor > standard.intervalFactor);
+    assert (bulk.workerShare < critical.workerShare);
+
+    // critical ones never wait, UPSes only when bulk
+    assert (!NUTQos::lowPriority (NUTQosLevel::CRITICAL, "epdu"));
+    assert (!NUTQos::lowPriority (NUTQosLevel::STANDARD, "ups") && NUTQos::lowPriority (NUTQosLevel::BULK, "ups"));
+    assert (NUTQos::lowPriority (NUTQosLevel::STANDARD, "epdu") && NUTQos::lowPriority (NUTQosLevel::STANDARD, NULL));
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,80 @@
+/*  =========================================================================
+    nut_qos - polling classes of devices given by asset attribute
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_QOS_H_INCLUDED
+#define NUT_QOS_H_INCLUDED
+
+#define NUT_QOS_ATTRIBUTE   "qos"   //!< asset ext attribute, critical, standard or bulk
+
+namespace drivers
+{
+namespace nut
+{
+
+enum class NUTQosLevel {
+    CRITICAL,   //!< e.g. UPSes feeding core racks
+    STANDARD,   //!< devices without the attribute
+    BULK        //!< e.g. outlet heavy PDUs nobody watches closely
+};
+
+//! \brief how devices of one QoS level are polled and published
+struct NUTQosClass {
+    const char *name;
+    int intervalFactor;     //!< polling interval is this many base intervals
+    int ceilingFactor;      //!< quiet devices are stretched up to this many base intervals
+    unsigned workerShare;   //!< percent of the workers of an endpoint its devices may take at once
+    int priority;           //!< higher is fetched and published first
+};
+
+/**
+ * \brief Scheduling classes of the QoS levels.
+ *
+ *    critical  every base interval, never stretched, all workers, first
+ *    standard  every base interval, stretched up to 8 times, all workers
+ *    bulk      every other base interval, stretched up to 8 times, half
+ *              of the workers, last
+ *
+ * So the devices of one class never wait for the queue of a lower one,
+ * and bulk devices can not take all workers of an endpoint.
+ *
+ *    auto level = NUTQos::parse (nut_asset_get_string (state, name, NUT_QOS_ATTRIBUTE));
+ *    device.reschedule (now, base * NUTQos::schedule (level).intervalFactor, ...);
+ */
+class NUTQos {
+ public:
+    //! \brief level named by text, STANDARD if text is NULL, empty or unknown
+    static NUTQosLevel parse (const char *text);
+    static const NUTQosClass& schedule (NUTQosLevel level);
+    static const char *name (NUTQosLevel level) { return schedule (level).name; }
+    //! \brief true if devices of level and asset subtype wait when polling is overloaded:
+    //!        bulk ones and standard ones but UPSes, which feed the loads
+    static bool lowPriority (NUTQosLevel level, const char *subtype);
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_qos_test (bool verbose);
+//  @end
+
+#endif
@@ -0,0 +1,751 @@
+/*  =========================================================================
+    nut_rules - derived variables computed by rules of mapping.conf
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_rules - derived variables computed by rules of mapping.conf
+@discuss
+    Rules are parsed into expression trees once, when mapping.conf is
+    loaded. A device whose rule inputs did not move since the last update
+    gets the variables derived last time, nothing is evaluated.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <set>
+
+#define NUT_RULES_SUM_MAX   1000    //!< items a sum adds at most, whatever its count says
+
+namespace drivers
+{
+namespace nut
+{
+
+struct NUTRules::Node {
+    enum Kind { NUMBER, TEXT, VARIABLE, ATTRIBUTE, UNARY, BINARY, EXISTS, SUM, ROUND };
+    Kind kind;
+    std::string text;   //!< literal, name or operator
+    double number = 0;
+    int column = -1;    //!< NUTOutletColumn a SUM of outlet.#.<column> can take from the outlet table
+    std::shared_ptr <const Node> left;
+    std::shared_ptr <const Node> right;
+};
+
+namespace {
+
+typedef std::shared_ptr <const NUTRules::Node> NodePtr;
+
+// value of an expression, variables keep what NUT gave
+struct Value {
+    bool present = false;
+    bool numeric = false;
+    double number = 0;
+    std::string text;
+    const std::vector <std::string> *raw = NULL;
+};
+
+struct Context {
+    const std::string& prefix;
+    const std::map <std::string, std::string>& attributes;
+    const NUTVariables& vars;
+    int index;      //!< what '#' stands for, 0 outside of sum
+    const NUTOutletTable *outlets;  //!< NULL if sums have to read vars
+};
+
+struct Token {
+    enum Kind { END, NAME, ATTRIBUTE, NUMBER, TEXT, OPERATOR };
+    Kind kind;
+    std::string text;
+};
+
+// the way NUT gives numbers, two decimals at most and no trailing zeros
+std::string
+s_format (double number)
+{
+    long int x = std::lround (number * 100);
+    std::string sign = x < 0 ? "-" : "";
+    x = std::labs (x);
+    std::string result = sign + std::to_string (x / 100);
+    if (x % 100) {
+        result += '.' + std::to_string (x % 100 / 10);
+        if (x % 10) result += std::to_string (x % 10);
+    }
+    return result;
+}
+
+bool
+s_number (const std::string& text, double& number)
+{
+    if (text.empty ()) return false;
+    char *rest = NULL;
+    number = strtod (text.c_str (), &rest);
+    return *rest == '\0' && std::isfinite (number);
+}
+
+bool
+s_name_char (char c)
+{
+    return isalnum (c) || c == '_' || c == '.' || c == '#' || c == '-';
+}
+
+// column of the outlet table holding variable node, -1 if none
+int
+s_outlet_column (const NUTRules::Node& node)
+{
+    static const std::vector <std::pair <std::string, NUTOutletColumn>> columns = {
+        { "outlet.#.current", NUTOutletColumn::CURRENT },
+        { "outlet.#.realpower", NUTOutletColumn::REALPOWER },
+        { "outlet.#.voltage", NUTOutletColumn::VOLTAGE }
+    };
+    if (node.kind != NUTRules::Node::VARIABLE) return -1;
+    for (const auto& column : columns) {
+        if (node.text == column.first) return static_cast <int> (column.second);
+    }
+    return -1;
+}
+
+bool
+s_tokenize (const std::string& rule, std::vector <Token>& tokens)
+{
+    static const std::vector <std::string> operators = {
+        "??", "==", "!=", "<=", ">=", "&&", "||", "<", ">", "+", "-", "*", "/", "!", "(", ")", ",", "="
+    };
+    size_t i = 0;
+    while (i < rule.size ()) {
+        char c = rule[i];
+        if (isspace (c)) {
+            ++i;
+        }
+        else if (isalpha (c) || c == '_' || (c == '$' && i + 1 < rule.size () && (isalpha (rule[i + 1]) || rule[i + 1] == '_'))) {
+            size_t start = c == '$' ? i + 1 : i;
+            i = start + 1;
+            while (i < rule.size () && s_name_char (rule[i])) ++i;
+            tokens.push_back ({ c == '$' ? Token::ATTRIBUTE : Token::NAME, rule.substr (start, i - start) });
+        }
+        else if (isdigit (c) || (c == '.' && i + 1 < rule.size () && isdigit (rule[i + 1]))) {
+            const char *start = rule.c_str () + i;
+            char *end = NULL;
+            strtod (start, &end);
+            tokens.push_back ({ Token::NUMBER, std::string (start, static_cast <const char *> (end)) });
+            i += end - start;
+        }
+        else if (c == '"') {
+            size_t end = rule.find ('"', i + 1);
+            if (end == std::string::npos) return false;
+            tokens.push_back ({ Token::TEXT, rule.substr (i + 1, end - i - 1) });
+            i = end + 1;
+        }
+        else {
+            auto op = std::find_if (operators.begin (), operators.end (),
+                [&] (const std::string& o) { return rule.compare (i, o.size (), o) == 0; });
+            if (op == operators.end ()) return false;
+            tokens.push_back ({ Token::OPERATOR, *op });
+            i += op->size ();
+        }
+    }
+    tokens.push_back ({ Token::END, "" });
+    return true;
+}
+
+// recursive descent, from the loosest binding: || && comparisons + - * / ?? unary
+class Parser {
+ public:
+    Parser (const std::vector <Token>& tokens, std::vector <std::string>& inputs, std::vector <std::string>& attributes) :
+        _tokens (tokens), _inputs (inputs), _attributes (attributes) { }
+
+    const Token& peek () const { return _tokens[_next]; }
+    bool accept (const char *op) {
+        if (peek ().kind != Token::OPERATOR || peek ().text != op) return false;
+        ++_next;
+        return true;
+    }
+    bool acceptName (const char *name) {
+        if (peek ().kind != Token::NAME || peek ().text != name) return false;
+        ++_next;
+        return true;
+    }
+
+    NodePtr expression () { return binary (0); }
+
+ private:
+    const std::vector <Token>& _tokens;
+    size_t _next = 0;
+    std::vector <std::string>& _inputs;
+    std::vector <std::string>& _attributes;
+
+    static NodePtr node (NUTRules::Node::Kind kind, const std::string& text, NodePtr left = NULL, NodePtr right = NULL) {
+        auto result = std::make_shared <NUTRules::Node> ();
+        result->kind = kind;
+        result->text = text;
+        result->left = left;
+        result->right = right;
+        return result;
+    }
+
+    NodePtr binary (size_t level) {
+        static const std::vector <std::vector <const char *>> levels = {
+            { "||" }, { "&&" }, { "==", "!=", "<=", ">=", "<", ">" }, { "+", "-" }, { "*", "/" }, { "??" }
+        };
+        if (level == levels.size ()) return unary ();
+        NodePtr left = binary (level + 1);
+        while (left) {
+            const char *op = NULL;
+            for (const char *candidate : levels[level]) {
+                if (accept (candidate)) { op = candidate; break; }
+            }
+            if (!op) break;
+            NodePtr right = binary (level + 1);
+            if (!right) return NULL;
+            left = node (NUTRules::Node::BINARY, op, left, right);
+        }
+        return left;
+    }
+
+    NodePtr unary () {
+        for (const char *op : { "-", "!" }) {
+            if (accept (op)) {
+                NodePtr operand = unary ();
+                return operand ? node (NUTRules::Node::UNARY, op, operand) : NULL;
+            }
+        }
+        return primary ();
+    }
+
+    NodePtr primary () {
+        Token token = peek ();
+        if (token.kind == Token::END) return NULL;
+        ++_next;
+        switch (token.kind) {
+            case Token::NUMBER: {
+                auto result = std::make_shared <NUTRules::Node> ();
+                result->kind = NUTRules::Node::NUMBER;
+                result->text = token.text;
+                result->number = strtod (token.text.c_str (), NULL);
+                return result;
+            }
+            case Token::TEXT:
+                return node (NUTRules::Node::TEXT, token.text);
+            case Token::ATTRIBUTE:
+                _attributes.push_back (token.text);
+                return node (NUTRules::Node::ATTRIBUTE, token.text);
+            case Token::NAME:
+                if (accept ("(")) return call (token.text);
+                _inputs.push_back (token.text);
+                return node (NUTRules::Node::VARIABLE, token.text);
+            case Token::OPERATOR:
+                if (token.text == "(") {
+                    NodePtr result = expression ();
+                    return result && accept (")") ? result : NULL;
+                }
+                return NULL;
+            default:
+                return NULL;
+        }
+    }
+
+    NodePtr call (const std::string& function) {
+        NodePtr result;
+        if (function == "exists") {
+            if (peek ().kind != Token::NAME) return NULL;
+            _inputs.push_back (peek ().text);
+            result = node (NUTRules::Node::EXISTS, _tokens[_next++].text);
+        }
+        else if (function == "round") {
+            NodePtr operand = expression ();
+            if (!operand) return NULL;
+            result = node (NUTRules::Node::ROUND, function, operand);
+        }
+        else if (function == "sum") {
+            NodePtr item = expression ();
+            if (!item || !accept (",")) return NULL;
+            NodePtr count = expression ();
+            if (!count) return NULL;
+            auto sum = std::make_shared <NUTRules::Node> ();
+            sum->kind = NUTRules::Node::SUM;
+            sum->text = function;
+            sum->left = item;
+            sum->right = count;
+            sum->column = s_outlet_column (*item);
+            result = sum;
+        }
+        return result && accept (")") ? result : NULL;
+    }
+};
+
+const std::vector <std::string> *
+s_variable (const Context& context, const std::string& name)
+{
+    std::string key = context.prefix;
+    for (char c : name) {
+        if (c != '#') key += c;
+        else if (context.index) key += std::to_string (context.index);
+        else return NULL;
+    }
+    auto it = context.vars.find (key);
+    return it == context.vars.end () || it->second.empty () ? NULL : &it->second;
+}
+
+Value
+s_text (const std::string& text)
+{
+    Value result;
+    result.present = true;
+    result.text = text;
+    result.numeric = s_number (text, result.number);
+    return result;
+}
+
+Value
+s_number_value (double number)
+{
+    Value result;
+    result.present = std::isfinite (number);
+    result.numeric = true;
+    result.number = number;
+    return result;
+}
+
+bool
+s_true (const Value& value)
+{
+    return value.present && (value.numeric ? value.number != 0 : !value.text.empty ());
+}
+
+Value
+s_evaluate (const NUTRules::Node& node, const Context& context)
+{
+    switch (node.kind) {
+        case NUTRules::Node::NUMBER:
+            return s_number_value (node.number);
+        case NUTRules::Node::TEXT: {
+            Value result;
+            result.present = true;
+            result.text = node.text;
+            return result;
+        }
+        case NUTRules::Node::VARIABLE: {
+            const auto *raw = s_variable (context, node.text);
+            if (!raw) return Value ();
+            Value result = s_text ((*raw)[0]);
+            result.raw = raw;
+            return result;
+        }
+        case NUTRules::Node::ATTRIBUTE: {
+            auto it = context.attributes.find (node.text);
+            return it == context.attributes.end () ? Value () : s_text (it->second);
+        }
+        case NUTRules::Node::EXISTS:
+            return s_number_value (s_variable (context, node.text) ? 1 : 0);
+        case NUTRules::Node::ROUND: {
+            Value operand = s_evaluate (*node.left, context);
+            return operand.present && operand.numeric ? s_number_value (std::round (operand.number)) : Value ();
+        }
+        case NUTRules::Node::SUM: {
+            Value count = s_evaluate (*node.right, context);
+            if (!count.present || !count.numeric) return Value ();
+            int n = static_cast <int> (std::min (count.number, static_cast <double> (NUT_RULES_SUM_MAX)));
+            if (node.column >= 0 && context.outlets) {
+                if (n <= 0) return Value ();
+                double sum = context.outlets->sum (static_cast <NUTOutletColumn> (node.column), n);
+                return std::isnan (sum) ? Value () : s_number_value (sum);
+            }
+            Context item = context;
+            double sum = 0;
+            int added = 0;
+            for (item.index = 1; item.index <= n; ++item.index) {
+                Value value = s_evaluate (*node.left, item);
+                if (!value.present || !value.numeric) break;
+                sum += value.number;
+                ++added;
+            }
+            return added ? s_number_value (sum) : Value ();
+        }
+        case NUTRules::Node::UNARY: {
+            Value operand = s_evaluate (*node.left, context);
+            if (node.text == "!") return s_number_value (s_true (operand) ? 0 : 1);
+            return operand.present && operand.numeric ? s_number_value (-operand.number) : Value ();
+        }
+        case NUTRules::Node::BINARY:
+            break;
+    }
+
+    const std::string& op = node.text;
+    Value left = s_evaluate (*node.left, context);
+    if (op == "??") return left.present ? left : s_evaluate (*node.right, context);
+    if (op == "&&") return s_number_value (s_true (left) && s_true (s_evaluate (*node.right, context)) ? 1 : 0);
+    if (op == "||") return s_number_value (s_true (left) || s_true (s_evaluate (*node.right, context)) ? 1 : 0);
+
+    Value right = s_evaluate (*node.right, context);
+    if (!left.present || !right.present) return Value ();
+    bool numbers = left.numeric && right.numeric;
+    if (op == "==" || op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=") {
+        int order;
+        if (numbers) order = left.number < right.number ? -1 : left.number > right.number ? 1 : 0;
+        else order = left.text.compare (right.text);
+        bool result =
+            op == "==" ? order == 0 :
+            op == "!=" ? order != 0 :
+            op == "<"  ? order < 0 :
+            op == ">"  ? order > 0 :
+            op == "<=" ? order <= 0 : order >= 0;
+        return s_number_value (result ? 1 : 0);
+    }
+    if (!numbers) return Value ();
+    if (op == "+") return s_number_value (left.number + right.number);
+    if (op == "-") return s_number_value (left.number - right.number);
+    if (op == "*") return s_number_value (left.number * right.number);
+    // division by zero is not worth a value
+    if (right.number == 0) return Value ();
+    return s_number_value (left.number / right.number);
+}
+
+// FNV-1a, 0 is left for "never evaluated"
+void
+s_hash (uint64_t& hash, const std::string& text)
+{
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+}
+
+} // namespace
+
+size_t NUTRules::compile (const std::vector <std::string>& rules)
+{
+    static std::atomic <uint64_t> generations (0);
+
+    _rules.clear ();
+    _inputs.clear ();
+    for (const auto& text : rules) {
+        Rule rule;
+        rule.text = text;
+        std::vector <Token> tokens;
+        bool ok = s_tokenize (text, tokens) && tokens[0].kind == Token::NAME &&
+            tokens[0].text.find ('#') == std::string::npos;
+        if (ok) {
+            rule.target = tokens[0].text;
+            Parser parser (tokens, rule.inputs, rule.attributes);
+            parser.acceptName (rule.target.c_str ());
+            ok = parser.accept ("=") && (rule.value = parser.expression ());
+            if (ok && parser.acceptName ("if")) {
+                ok = static_cast <bool> (rule.condition = parser.expression ());
+            }
+            ok = ok && parser.peek ().kind == Token::END;
+        }
+        if (!ok) {
+            log_error ("rule '%s' is not like 'variable = expression [if condition]', left out", text.c_str ());
+            continue;
+        }
+        _rules.push_back (std::move (rule));
+    }
+    plan ();
+    _outletTargets = std::any_of (_rules.begin (), _rules.end (),
+        [] (const Rule& rule) { return rule.target.compare (0, 7, "outlet.") == 0; });
+    _generation = ++generations;
+    log_debug ("%zu of %zu rules compiled", _rules.size (), rules.size ());
+    return _rules.size ();
+}
+
+void NUTRules::plan ()
+{
+    // targets, a rule of one depends on the ones it reads
+    std::vector <std::string> targets;
+    std::map <std::string, size_t> target;
+    for (const auto& rule : _rules) {
+        if (target.emplace (rule.target, targets.size ()).second) targets.push_back (rule.target);
+    }
+    std::vector <std::set <size_t>> depends (targets.size ());
+    for (const auto& rule : _rules) {
+        for (const auto& input : rule.inputs) {
+            for (size_t i = 0; i < targets.size (); ++i) {
+                if (NUTMapping::matches (input, targets[i].c_str ())) depends[target[rule.target]].insert (i);
+            }
+        }
+    }
+
+    // Tarjan, components come out after the ones they depend on
+    std::vector <int> index (targets.size (), -1), low (targets.size (), 0);
+    std::vector <bool> stacked (targets.size (), false);
+    std::vector <size_t> stack;
+    std::vector <size_t> order (targets.size ());   //!< target | its component in order of evaluation
+    int next = 0;
+    size_t components = 0;
+    std::function <void (size_t)> visit = [&] (size_t v) {
+        index[v] = low[v] = next++;
+        stack.push_back (v);
+        stacked[v] = true;
+        for (size_t w : depends[v]) {
+            if (index[w] < 0) {
+                visit (w);
+                low[v] = std::min (low[v], low[w]);
+            }
+            else if (stacked[w]) {
+                low[v] = std::min (low[v], index[w]);
+            }
+        }
+        if (low[v] == index[v]) {
+            size_t w;
+            do {
+                w = stack.back ();
+                stack.pop_back ();
+                stacked[w] = false;
+                order[w] = components;
+            } while (w != v);
+            ++components;
+        }
+    };
+    for (size_t v = 0; v < targets.size (); ++v) {
+        if (index[v] < 0) visit (v);
+    }
+
+    // by component, the order of mapping.conf within one
+    _plan.resize (_rules.size ());
+    for (size_t i = 0; i < _plan.size (); ++i) _plan[i] = i;
+    std::stable_sort (_plan.begin (), _plan.end (), [&] (size_t a, size_t b) {
+        return order[target[_rules[a].target]] < order[target[_rules[b].target]];
+    });
+}
+
+bool NUTRules::input (const std::string& name) const
+{
+    auto it = _inputs.find (name);
+    if (it != _inputs.end ()) return it->second;
+    if (_inputs.size () >= NUT_RULES_INPUTS_MAX) {
+        // some driver makes names up, do not grow without bound
+        _inputs.clear ();
+    }
+    bool result = false;
+    for (const auto& rule : _rules) {
+        result = rule.target == name || std::any_of (rule.inputs.begin (), rule.inputs.end (),
+            [&name] (const std::string& input) { return NUTMapping::matches (input, name.c_str ()); });
+        if (result) break;
+    }
+    return _inputs.emplace (name, result).first->second;
+}
+
+void NUTRules::apply (const std::string& prefix, const std::map <std::string, std::string>& attributes,
+                      NUTVariables& vars, NUTRulesState& state, const NUTOutletTable *outlets) const
+{
+    if (_rules.empty ()) return;
+
+    uint64_t hash = 14695981039346656037ULL;
+    s_hash (hash, std::to_string (_generation));
+    for (auto it = vars.lower_bound (prefix); it != vars.end () && it->first.compare (0, prefix.size (), prefix) == 0; ++it) {
+        if (!input (it->first.substr (prefix.size ()))) continue;
+        s_hash (hash, it->first);
+        for (const auto& value : it->second) s_hash (hash, value);
+    }
+    for (const auto& rule : _rules) {
+        for (const auto& name : rule.attributes) {
+            auto it = attributes.find (name);
+            s_hash (hash, it == attributes.end () ? "" : it->second);
+        }
+    }
+    if (hash == 0) hash = 1;
+
+    if (hash == state.inputs) {
+        for (const auto& output : state.outputs) vars.insert (output);
+        ++_reuses;
+        return;
+    }
+
+    state.outputs.clear ();
+    Context context { prefix, attributes, vars, 0, _outletTargets ? NULL : outlets };
+    for (size_t i : _plan) {
+        const Rule& rule = _rules[i];
+        std::string name = prefix + rule.target;
+        if (vars.count (name)) continue;
+        if (rule.condition && !s_true (s_evaluate (*rule.condition, context))) continue;
+        Value value = s_evaluate (*rule.value, context);
+        if (!value.present) continue;
+        std::vector <std::string> result;
+        if (value.raw) result = *value.raw;
+        else result.push_back (value.numeric ? s_format (value.number) : value.text);
+        log_debug ("%s derived by '%s'", name.c_str (), rule.text.c_str ());
+        state.outputs.emplace_back (name, result);
+        vars.emplace (std::move (name), std::move (result));
+    }
+    state.inputs = hash;
+    ++_evaluations;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_rules_test (bool verbose)
+{
+    printf (" * nut_rules: ");
+
+    //  @selftest
+    using drivers::nut::NUTRules;
+    using drivers::nut::NUTRulesState;
+    using drivers::nut::NUTVariables;
+
+    NUTRules rules;
+    std::map <std::string, std::string> attributes = { { "max_power", "2" }, { "subtype", "ups" } };
+
+    // malformed rules are left out
+    assert (rules.compile ({
+        "input.phases = 3 if exists (input.L3.current)",
+        "input.phases = 1",
+        "= 1",
+        "outlet.#.realpower = 0",
+        "ups.load = (ups.realpower",
+        "ups.load = 1 if",
+        "ups.load = \"open",
+        "ups.load = ups.realpower ups.power"
+        }) == 2);
+
+    NUTVariables vars = { { "input.L3.current", { "1.5" } } };
+    NUTRulesState state;
+    rules.apply ("", attributes, vars, state);
+    assert (vars["input.phases"] == std::vector <std::string> { "3" });
+    // never overwrites what the device gives
+    vars = { { "input.phases", { "2" } } };
+    state = NUTRulesState ();
+    rules.apply ("", attributes, vars, state);
+    assert (vars["input.phases"] == std::vector <std::string> { "2" });
+    // other daisy chain devices are left alone
+    vars = { { "device.2.input.L3.current", { "1.5" } } };
+    rules.apply ("device.1.", attributes, vars, state);
+    assert (vars["device.1.input.phases"] == std::vector <std::string> { "1" } && !vars.count ("device.2.input.phases"));
+
+    // expressions
+    auto evaluate = [&attributes] (const std::string& expression, NUTVariables vars) {
+        NUTRules rules;
+        NUTRulesState state;
+        assert (rules.compile ({ "x = " + expression }) == 1);
+        rules.apply ("", attributes, vars, state);
+        return vars.count ("x") ? vars["x"] : std::vector <std::string> { "missing" };
+    };
+    typedef std::vector <std::string> V;
+    assert (evaluate ("1 + 2 * 3", {}) == V { "7" });
+    assert (evaluate ("(1 + 2) * 3", {}) == V { "9" });
+    assert (evaluate ("10 / 4 - -1", {}) == V { "3.5" });
+    assert (evaluate ("1 / 3", {}) == V { "0.33" });
+    assert (evaluate ("1 / 0", {}) == V { "missing" });
+    assert (evaluate ("round (2.5) + round (-0.4)", {}) == V { "3" });
+    assert (evaluate ("a * 2", { { "a", { "1.25" } } }) == V { "2.5" });
+    assert (evaluate ("a * 2", { { "a", { "on" } } }) == V { "missing" });
+    assert (evaluate ("b * 2", {}) == V { "missing" });
+    // variables are copied as they are
+    assert (evaluate ("a", { { "a", { "OL", "CHRG" } } }) == V ({ "OL", "CHRG" }));
+    assert (evaluate ("b ?? a ?? 5", { { "a", { "0.10" } } }) == V { "0.10" });
+    assert (evaluate ("b ?? 5", {}) == V { "5" });
+    assert (evaluate ("\"pdu\"", {}) == V { "pdu" });
+    assert (evaluate ("$max_power * 1000", {}) == V { "2000" });
+    assert (evaluate ("$subtype == \"ups\" && !($subtype != \"ups\")", {}) == V { "1" });
+    assert (evaluate ("a == 1 || b", { { "a", { "1.0" } } }) == V { "1" });
+    assert (evaluate ("a < 10 && a >= 9.5", { { "a", { "9.5" } } }) == V { "1" });
+    assert (evaluate ("exists (a) + exists (b)", { { "a", { "1" } } }) == V { "1" });
+    assert (evaluate ("!b", {}) == V { "1" });
+    assert (evaluate ("input.L3-N.voltage - 1", { { "input.L3-N.voltage", { "231" } } }) == V { "230" });
+    // sum stops at the first one missing
+    NUTVariables outlets = { { "outlet.1.realpower", { "10.5" } }, { "outlet.2.realpower", { "20" } },
+                             { "outlet.4.realpower", { "40" } } };
+    assert (evaluate ("sum (outlet.#.realpower, 100)", outlets) == V { "30.5" });
+    assert (evaluate ("sum (outlet.#.realpower, 1)", outlets) == V { "10.5" });
+    assert (evaluate ("sum (outlet.#.realpower, 0)", outlets) == V { "missing" });
+    assert (evaluate ("sum (output.L#.realpower ?? outlet.#.realpower, 2)", outlets) == V { "30.5" });
+    assert (evaluate ("outlet.#.realpower", outlets) == V { "missing" });
+
+    // variables reading each other run in the order given, the others after what they read
+    assert (rules.compile ({
+        "ups.load = round (ups.realpower / ($max_power * 1000) * 100) if $max_power * 1000 > 0.1",
+        "ups.realpower = input.realpower",
+        "input.realpower = output.realpower",
+        "output.realpower = input.realpower",
+        "ups.realpower = sum (outlet.#.realpower, outlet.count ?? 100) if exists (outlet.1.realpower)"
+        }) == 5);
+    vars = { { "output.realpower", { "500" } } };
+    state = NUTRulesState ();
+    rules.apply ("", attributes, vars, state);
+    assert (vars["input.realpower"] == V { "500" } && vars["ups.realpower"] == V { "500" });
+    assert (vars["ups.load"] == V { "25" });
+    vars = outlets;
+    state = NUTRulesState ();
+    rules.apply ("", attributes, vars, state);
+    assert (vars["ups.realpower"] == V { "30.5" } && vars["ups.load"] == V { "2" });
+    assert (!vars.count ("input.realpower"));
+
+    // inputs
+    assert (rules.input ("outlet.12.realpower") && rules.input ("ups.load") && rules.input ("outlet.count"));
+    assert (!rules.input ("outlet.1.current") && !rules.input ("outlet.x.realpower"));
+
+    // nothing evaluated while inputs stay
+    uint64_t evaluations = rules.evaluations ();
+    vars = outlets;
+    vars["device.model"] = { "ePDU" };
+    rules.apply ("", attributes, vars, state);
+    assert (rules.evaluations () == evaluations && rules.reuses () == 1);
+    assert (vars["ups.realpower"] == V { "30.5" } && vars["ups.load"] == V { "2" });
+    // an input moved
+    vars = outlets;
+    vars["outlet.2.realpower"] = { "21" };
+    rules.apply ("", attributes, vars, state);
+    assert (rules.evaluations () == evaluations + 1 && vars["ups.realpower"] == V { "31.5" });
+    // an attribute moved
+    attributes["max_power"] = "1";
+    vars.erase ("ups.realpower");
+    vars.erase ("ups.load");
+    rules.apply ("", attributes, vars, state);
+    assert (rules.evaluations () == evaluations + 2 && vars["ups.load"] == V { "3" });
+    // the device gives a target
+    vars.erase ("ups.realpower");
+    vars["ups.load"] = { "50" };
+    rules.apply ("", attributes, vars, state);
+    assert (rules.evaluations () == evaluations + 3 && vars["ups.load"] == V { "50" });
+    // rules compiled again
+    vars.erase ("ups.realpower");
+    rules.compile ({ "ups.realpower = 1" });
+    rules.apply ("", attributes, vars, state);
+    assert (vars["ups.realpower"] == V { "1" });
+
+    // sums of outlet columns are taken from the outlet table if given
+    drivers::nut::NUTOutletTable table;
+    for (const auto& item : outlets) table.take (item.first.c_str (), item.second);
+    table.take ("outlet.3.realpower", { "30" });
+    rules.compile ({ "ups.realpower = sum (outlet.#.realpower, outlet.count ?? 100)", "ups.load = sum (outlet.#.realpower, 0)" });
+    vars = outlets;
+    state = NUTRulesState ();
+    rules.apply ("", attributes, vars, state, &table);
+    assert (vars["ups.realpower"] == V { "100.5" } && !vars.count ("ups.load"));
+    // not if some rule derives an outlet variable
+    rules.compile ({ "outlet.3.realpower = 0", "ups.realpower = sum (outlet.#.realpower, 100)" });
+    vars = outlets;
+    state = NUTRulesState ();
+    rules.apply ("", attributes, vars, state, &table);
+    assert (vars["ups.realpower"] == V { "70.5" });
+    //  @end
+    printf ("OK\n");
+}
@@ -0,0 +1,131 @@
+/*  =========================================================================
+    nut_rules - derived variables computed by rules of mapping.conf
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_RULES_H_INCLUDED
+#define NUT_RULES_H_INCLUDED
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nut_snapshot.h"
+
+#define NUT_RULES_INPUTS_MAX    65536   //!< variable names remembered as input or not, all are forgotten above
+
+namespace drivers
+{
+namespace nut
+{
+
+class NUTOutletTable;
+
+//! \brief what the rules derived for one device, to be reused while their inputs stay
+struct NUTRulesState {
+    uint64_t inputs = 0;    //!< hash of the inputs of the last evaluation, 0 for none
+    //! \brief variables derived by the last evaluation, prefix included
+    std::vector <std::pair <std::string, std::vector <std::string>>> outputs;
+};
+
+/**
+ * \brief Rules deriving NUT variables a device does not give.
+ *
+ * One rule per line, e.g.
+ *
+ *    ups.realpower = sum (output.L#.realpower ?? ups.L#.realpower, output.phases) if exists (output.L1.realpower)
+ *    ups.load = round (ups.realpower / ($max_power * 1000) * 100) if output.phases == 1 && $max_power > 0
+ *
+ * Names are NUT variables of the device (daisy chain prefix left out),
+ * $name is an asset ext attribute. Expressions know numbers, "text",
+ * + - * /, comparisons, && || !, a ?? b (a if present, else b),
+ * exists (name), round (x) and sum (x, n) adding x for # = 1..n up to the
+ * first missing one. A variable missing or not a number makes the value
+ * missing, a rule with a missing value or condition does nothing.
+ *
+ * A rule never overwrites a variable, so the rules of one variable are
+ * alternatives in the order given. Variables are derived after the ones
+ * they read; where variables read each other (input.realpower and
+ * output.realpower), their rules run once in the order given. Rules are
+ * evaluated only when some input, some target or an attribute of the
+ * device changed, otherwise the last derived variables are reused. Sums
+ * of outlet.#.current, realpower and voltage are taken from the outlet
+ * table of the device when given.
+ *
+ *    rules.compile ({ "input.phases = 3 if exists (input.L3.current)", "input.phases = 1" });
+ *    rules.apply ("", attributes, vars, state);
+ */
+class NUTRules {
+ public:
+    /**
+     * \brief Compile rules into a plan, malformed ones are logged and left out.
+     * \return number of rules compiled
+     */
+    size_t compile (const std::vector <std::string>& rules);
+    size_t size () const { return _rules.size (); }
+
+    //! \brief add variables missing in vars of device with prefix that rules derive,
+    //!        outlets holds the outlet variables of vars if not NULL
+    void apply (const std::string& prefix, const std::map <std::string, std::string>& attributes,
+                NUTVariables& vars, NUTRulesState& state, const NUTOutletTable *outlets = NULL) const;
+
+    //! \brief true if some rule reads or derives NUT variable name
+    bool input (const std::string& name) const;
+
+    //! \brief number of evaluations done / saved by unchanged inputs since start
+    uint64_t evaluations () const { return _evaluations; }
+    uint64_t reuses () const { return _reuses; }
+
+    struct Node;
+ private:
+    struct Rule {
+        std::string text;
+        std::string target;
+        std::shared_ptr <const Node> value;
+        std::shared_ptr <const Node> condition;     //!< NULL for always
+        std::vector <std::string> inputs;           //!< variables read, '#' for a number
+        std::vector <std::string> attributes;       //!< asset attributes read
+    };
+    std::vector <Rule> _rules;
+    //! \brief indexes to _rules, in the order of evaluation
+    std::vector <size_t> _plan;
+    //! \brief tells states of an older plan from the ones of this
+    uint64_t _generation = 0;
+    //! \brief some rule derives an outlet variable, the outlet table may miss it
+    bool _outletTargets = false;
+    mutable std::unordered_map <std::string, bool> _inputs;
+    mutable uint64_t _evaluations = 0;
+    mutable uint64_t _reuses = 0;
+
+    //! \brief order _rules by what they read, see class description
+    void plan ();
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_rules_test (bool verbose);
+//  @end
+
+#endif
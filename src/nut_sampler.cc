@@ -0,0 +1,213 @@
+/*  =========================================================================
+    nut_sampler - high rate samples of selected metrics and their windows
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_sampler - high rate samples of selected metrics and their windows
+@discuss
+    Samples stay in the process, downstream agents get one message per
+    metric and polling interval as before, the aggregates of the window
+    go in its aux.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+#include <algorithm>
+#include <ctype.h>
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTSampleRing::NUTSampleRing (size_t capacity) :
+    _samples (std::max <size_t> (capacity, 1))
+{
+}
+
+void NUTSampleRing::push (double value, int64_t now)
+{
+    _samples[_head] = Sample { now, value };
+    _head = (_head + 1) % _samples.size ();
+    if (_size < _samples.size ()) ++_size;
+}
+
+NUTSampleWindow NUTSampleRing::window (int64_t since) const
+{
+    NUTSampleWindow window;
+    double sum = 0;
+    // newest first, stop at the first sample out of the window
+    for (size_t i = 0; i < _size; ++i) {
+        const Sample& sample = _samples[(_head + _samples.size () - 1 - i) % _samples.size ()];
+        if (sample.time < since) break;
+        if (window.count == 0) {
+            window.min = window.max = window.last = sample.value;
+            window.newest = sample.time;
+        }
+        window.min = std::min (window.min, sample.value);
+        window.max = std::max (window.max, sample.value);
+        sum += sample.value;
+        ++window.count;
+    }
+    if (window.count) window.avg = sum / window.count;
+    return window;
+}
+
+void NUTSampler::configure (const std::string& asset, const std::string& patterns)
+{
+    std::vector <std::string> parsed;
+    std::string item;
+    for (const char *p = patterns.c_str (); ; ++p) {
+        if (*p == 0 || *p == ',' || isspace (*p)) {
+            if (!item.empty ()) parsed.push_back (item);
+            item.clear ();
+            if (*p == 0) break;
+            continue;
+        }
+        item += *p;
+    }
+    if (parsed.empty ()) {
+        _patterns.erase (asset);
+        _series.erase (asset);
+        return;
+    }
+    auto& old = _patterns[asset];
+    if (old != parsed) {
+        log_info ("sampling %s of %s", patterns.c_str (), asset.c_str ());
+        // samples of metrics no more selected are dropped
+        old.swap (parsed);
+        auto series = _series.find (asset);
+        if (series != _series.end ()) {
+            for (auto it = series->second.begin (); it != series->second.end (); ) {
+                if (sampled (asset, it->first)) ++it;
+                else it = series->second.erase (it);
+            }
+        }
+    }
+}
+
+bool NUTSampler::sampled (const std::string& asset, const std::string& metric) const
+{
+    auto patterns = _patterns.find (asset);
+    if (patterns == _patterns.end ()) return false;
+    for (const auto& pattern : patterns->second) {
+        if (NUTInterest::matches (pattern.c_str (), metric.c_str ())) return true;
+    }
+    return false;
+}
+
+std::vector <std::string> NUTSampler::assets () const
+{
+    std::vector <std::string> result;
+    for (const auto& it : _patterns) {
+        result.push_back (it.first);
+    }
+    return result;
+}
+
+void NUTSampler::sample (const std::string& asset, const std::string& metric, double value, int64_t now)
+{
+    if (!sampled (asset, metric)) return;
+    if (now < 0) now = zclock_mono ();
+    _series[asset][metric].ring.push (value, now);
+    ++_samples;
+}
+
+bool NUTSampler::take (const std::string& asset, const std::string& metric, NUTSampleWindow& window)
+{
+    auto series = _series.find (asset);
+    if (series == _series.end ()) return false;
+    auto it = series->second.find (metric);
+    if (it == series->second.end ()) return false;
+    NUTSampleWindow result = it->second.ring.window (it->second.taken);
+    if (result.count == 0) return false;
+    it->second.taken = result.newest + 1;
+    window = result;
+    return true;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_sampler_test (bool verbose)
+{
+    printf (" * nut_sampler: ");
+
+    //  @selftest
+    using drivers::nut::NUTSampleRing;
+    using drivers::nut::NUTSampleWindow;
+    using drivers::nut::NUTSampler;
+
+    // ring keeps the newest samples only
+    NUTSampleRing ring (4);
+    assert (ring.window (0).count == 0);
+    for (int i = 1; i <= 6; ++i) {
+        ring.push (i * 10, i * 100);
+    }
+    assert (ring.size () == 4 && ring.capacity () == 4);
+    NUTSampleWindow window = ring.window (0);
+    assert (window.count == 4);
+    assert (window.min == 30 && window.max == 60 && window.last == 60);
+    assert (window.avg == 45);
+    assert (window.newest == 600);
+    window = ring.window (500);
+    assert (window.count == 2 && window.min == 50);
+
+    // only selected metrics are sampled
+    NUTSampler sampler;
+    assert (sampler.empty ());
+    sampler.configure ("ups-1", "load.default, realpower.*");
+    assert (sampler.sampled ("ups-1", "load.default"));
+    assert (sampler.sampled ("ups-1", "realpower.output.L1"));
+    assert (!sampler.sampled ("ups-1", "voltage.input.L1"));
+    assert (!sampler.sampled ("ups-2", "load.default"));
+    assert (sampler.assets () == std::vector <std::string> { "ups-1" });
+    sampler.sample ("ups-1", "voltage.input.L1", 230, 1000);
+    assert (sampler.samples () == 0);
+
+    // windows do not overlap
+    sampler.sample ("ups-1", "load.default", 10, 1000);
+    sampler.sample ("ups-1", "load.default", 90, 1500);
+    sampler.sample ("ups-1", "load.default", 20, 2000);
+    assert (sampler.samples () == 3);
+    assert (sampler.take ("ups-1", "load.default", window));
+    assert (window.count == 3 && window.max == 90 && window.min == 10 && window.last == 20);
+    assert (!sampler.take ("ups-1", "load.default", window));
+    assert (!sampler.take ("ups-1", "realpower.default", window));
+    sampler.sample ("ups-1", "load.default", 30, 2500);
+    assert (sampler.take ("ups-1", "load.default", window));
+    assert (window.count == 1 && window.avg == 30);
+
+    // deselected metrics and assets lose their samples
+    sampler.sample ("ups-1", "realpower.default", 500, 3000);
+    sampler.configure ("ups-1", "realpower.*");
+    assert (!sampler.take ("ups-1", "load.default", window));
+    assert (sampler.take ("ups-1", "realpower.default", window));
+    sampler.configure ("ups-1", "");
+    assert (sampler.empty ());
+    //  @end
+    printf ("OK\n");
+}
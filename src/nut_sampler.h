@@ -0,0 +1,131 @@
+/*  =========================================================================
+    nut_sampler - high rate samples of selected metrics and their windows
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_SAMPLER_H_INCLUDED
+#define NUT_SAMPLER_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define NUT_SAMPLER_CAPACITY            512     //!< samples kept per metric, the oldest are overwritten
+#define NUT_SAMPLER_ATTRIBUTE           "sampling"  //!< asset ext attribute, metric patterns to sample
+#define NUT_SAMPLER_DEFAULT_INTERVAL    500     //!< [ms] between two samples
+
+namespace drivers
+{
+namespace nut
+{
+
+//! \brief aggregate of the samples of one window
+struct NUTSampleWindow {
+    size_t count = 0;
+    double min = 0;
+    double max = 0;
+    double avg = 0;
+    double last = 0;
+    int64_t newest = 0;     //!< [ms] time of last
+};
+
+/**
+ * \brief Fixed size ring of timestamped samples.
+ *
+ * Memory is taken once by the constructor, push () just overwrites the
+ * oldest sample when full.
+ */
+class NUTSampleRing {
+ public:
+    explicit NUTSampleRing (size_t capacity = NUT_SAMPLER_CAPACITY);
+
+    void push (double value, int64_t now);
+    //! \brief aggregate of the samples taken at or after since [ms]
+    NUTSampleWindow window (int64_t since) const;
+    size_t size () const { return _size; }
+    size_t capacity () const { return _samples.size (); }
+
+ private:
+    struct Sample {
+        int64_t time;
+        double value;
+    };
+    std::vector <Sample> _samples;
+    size_t _head = 0;       //!< where the next sample goes
+    size_t _size = 0;
+};
+
+/**
+ * \brief Samples of the metrics selected per asset.
+ *
+ * The asset attribute NUT_SAMPLER_ATTRIBUTE holds metric patterns ('*'
+ * and '?') separated by commas or spaces. Selected metrics are sampled
+ * many times per polling interval, but published once per interval
+ * with min/max/avg/last of the samples since the last publish.
+ *
+ *    sampler.configure ("ups-1", "load.default, realpower.*");
+ *    sampler.sample ("ups-1", "load.default", 42.0);
+ *    NUTSampleWindow window;
+ *    if (sampler.take ("ups-1", "load.default", window)) publish (window.max);
+ */
+class NUTSampler {
+ public:
+    //! \brief set metric patterns of asset, empty stops sampling it
+    void configure (const std::string& asset, const std::string& patterns);
+    //! \brief true if asset has some metric to sample
+    bool configured (const std::string& asset) const { return _patterns.count (asset) != 0; }
+    //! \brief true if metric of asset is to be sampled
+    bool sampled (const std::string& asset, const std::string& metric) const;
+    //! \brief assets with some metric to sample
+    std::vector <std::string> assets () const;
+    bool empty () const { return _patterns.empty (); }
+
+    //! \brief add value of metric of asset taken at now [ms]
+    void sample (const std::string& asset, const std::string& metric, double value, int64_t now = -1);
+
+    /**
+     * \brief Aggregate the samples since the last take () of metric.
+     * \return false if there is no new sample
+     */
+    bool take (const std::string& asset, const std::string& metric, NUTSampleWindow& window);
+
+    //! \brief number of samples added since start
+    uint64_t samples () const { return _samples; }
+
+ private:
+    struct Series {
+        NUTSampleRing ring;
+        int64_t taken = 0;  //!< [ms] samples before this were published
+    };
+    //! \brief asset | metric patterns
+    std::map <std::string, std::vector <std::string>> _patterns;
+    //! \brief asset | metric | its samples
+    std::map <std::string, std::map <std::string, Series>> _series;
+    uint64_t _samples = 0;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_sampler_test (bool verbose);
+//  @end
+
+#endif
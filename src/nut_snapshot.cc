@@ -0,0 +1,199 @@
+/*  =========================================================================
+    nut_snapshot - per-cycle NUT snapshot shared by all actors
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_snapshot - per-cycle NUT snapshot shared by all actors
+@discuss
+    Only the pointer to the latest snapshot is shared (under a mutex), the
+    snapshot itself is never modified after publish (). The notification
+    carries just the cycle number, subscribers read the data by latest ().
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+const NUTVariables *NUTSnapshot::find (const std::string& nutName) const
+{
+    auto it = devices.find (nutName);
+    if (it == devices.end ()) return NULL;
+    return &it->second;
+}
+
+NUTSnapshotBus& NUTSnapshotBus::instance ()
+{
+    static NUTSnapshotBus bus;
+    return bus;
+}
+
+bool NUTSnapshotBus::open ()
+{
+    if (_publisher) return true;
+    _publisher = zsock_new_pub ("@" NUT_SNAPSHOT_ENDPOINT);
+    if (!_publisher) {
+        log_error ("can't bind %s, snapshots are not announced", NUT_SNAPSHOT_ENDPOINT);
+        return false;
+    }
+    return true;
+}
+
+void NUTSnapshotBus::close ()
+{
+    zsock_destroy (&_publisher);
+}
+
+void NUTSnapshotBus::publish (std::shared_ptr <NUTSnapshot> snapshot)
+{
+    if (!snapshot) return;
+    uint64_t cycle;
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        snapshot->cycle = cycle = ++_cycle;
+        if (snapshot->timestamp == 0) snapshot->timestamp = zclock_mono ();
+        _latest = snapshot;
+    }
+    log_debug ("snapshot %" PRIu64 " of %zu devices published", cycle, snapshot->devices.size ());
+    if (_publisher) {
+        zstr_sendx (_publisher, "SNAPSHOT", std::to_string (cycle).c_str (), NULL);
+    }
+}
+
+NUTSnapshotPtr NUTSnapshotBus::latest () const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    return _latest;
+}
+
+bool NUTSnapshotBus::fresh (int64_t maxAge) const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    return _latest && zclock_mono () - _latest->timestamp <= maxAge;
+}
+
+zsock_t *NUTSnapshotBus::subscribe ()
+{
+    return zsock_new_sub (">" NUT_SNAPSHOT_ENDPOINT, "SNAPSHOT");
+}
+
+void NUTSnapshotBus::publishStatus (std::shared_ptr <NUTSnapshot> snapshot)
+{
+    if (!snapshot) return;
+    uint64_t cycle;
+    {
+        std::lock_guard<std::mutex> lock (_mutex);
+        snapshot->cycle = cycle = ++_statusCycle;
+        if (snapshot->timestamp == 0) snapshot->timestamp = zclock_mono ();
+        _latestStatus = snapshot;
+    }
+    if (_publisher) {
+        zstr_sendx (_publisher, "STATUS", std::to_string (cycle).c_str (), NULL);
+    }
+}
+
+NUTSnapshotPtr NUTSnapshotBus::latestStatus () const
+{
+    std::lock_guard<std::mutex> lock (_mutex);
+    return _latestStatus;
+}
+
+zsock_t *NUTSnapshotBus::subscribeStatus ()
+{
+    return zsock_new_sub (">" NUT_SNAPSHOT_ENDPOINT, "STATUS");
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_snapshot_test (bool verbose)
+{
+    printf (" * nut_snapshot: ");
+
+    //  @selftest
+    using namespace drivers::nut;
+
+    NUTSnapshotBus bus;
+    assert (!bus.latest ());
+    assert (!bus.fresh (1000));
+    assert (bus.open ());
+    zsock_t *subscriber = NUTSnapshotBus::subscribe ();
+    assert (subscriber);
+    // let the subscription reach the publisher
+    zclock_sleep (100);
+
+    auto snapshot = std::make_shared <NUTSnapshot> ();
+    snapshot->devices["ups"]["ups.status"] = { "OL" };
+    bus.publish (snapshot);
+
+    char *command = NULL, *cycle = NULL;
+    assert (zstr_recvx (subscriber, &command, &cycle, NULL) == 2);
+    assert (streq (command, "SNAPSHOT"));
+    assert (streq (cycle, "1"));
+    zstr_free (&command);
+    zstr_free (&cycle);
+
+    NUTSnapshotPtr latest = bus.latest ();
+    assert (latest && latest->cycle == 1);
+    assert (bus.fresh (1000));
+    assert (latest->find ("ups"));
+    assert (latest->find ("ups")->at ("ups.status")[0] == "OL");
+    assert (latest->find ("epdu") == NULL);
+
+    // readers keep their snapshot while a new one is published
+    bus.publish (std::make_shared <NUTSnapshot> ());
+    assert (latest->devices.size () == 1);
+    assert (bus.latest ()->cycle == 2);
+    assert (zstr_recvx (subscriber, &command, &cycle, NULL) == 2);
+    zstr_free (&command);
+    zstr_free (&cycle);
+
+    // status lane has its own subscribers and does not replace latest ()
+    zsock_t *statusSubscriber = NUTSnapshotBus::subscribeStatus ();
+    assert (statusSubscriber);
+    zclock_sleep (100);
+    auto status = std::make_shared <NUTSnapshot> ();
+    status->devices["ups"]["ups.status"] = { "OB" };
+    bus.publishStatus (status);
+    assert (zstr_recvx (statusSubscriber, &command, &cycle, NULL) == 2);
+    assert (streq (command, "STATUS"));
+    assert (streq (cycle, "1"));
+    zstr_free (&command);
+    zstr_free (&cycle);
+    assert (bus.latestStatus ()->find ("ups")->at ("ups.status")[0] == "OB");
+    assert (bus.latest ()->cycle == 2);
+    zpoller_t *poller = zpoller_new (subscriber, NULL);
+    assert (zpoller_wait (poller, 100) == NULL);
+    zpoller_destroy (&poller);
+
+    zsock_destroy (&statusSubscriber);
+    zsock_destroy (&subscriber);
+    bus.close ();
+    //  @end
+    printf ("OK\n");
+}
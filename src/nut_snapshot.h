@@ -0,0 +1,120 @@
+/*  =========================================================================
+    nut_snapshot - per-cycle NUT snapshot shared by all actors
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_SNAPSHOT_H_INCLUDED
+#define NUT_SNAPSHOT_H_INCLUDED
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define NUT_SNAPSHOT_ENDPOINT   "inproc://fty-nut-snapshot"
+
+namespace drivers
+{
+namespace nut
+{
+
+typedef std::map <std::string, std::vector <std::string>> NUTVariables;
+
+/**
+ * \brief Variables of NUT devices fetched in one cycle.
+ *
+ * Only devices that were due and answered are present, quiet devices are
+ * skipped by the adaptive polling and keep their previous values.
+ */
+struct NUTSnapshot {
+    uint64_t cycle = 0;         //!< sequence number, set by NUTSnapshotBus::publish ()
+    int64_t timestamp = 0;      //!< [ms] zclock_mono when taken
+    std::map <std::string, NUTVariables> devices;   //!< nut name | variables
+
+    //! \brief variables of nut device, NULL if it did not answer
+    const NUTVariables *find (const std::string& nutName) const;
+};
+
+typedef std::shared_ptr <const NUTSnapshot> NUTSnapshotPtr;
+
+/**
+ * \brief Hands the snapshot of the polling actor to the other actors.
+ *
+ * fty_nut_server polls upsd once per cycle and publishes the result here.
+ * The snapshot is immutable once published, so any actor can keep and
+ * read it without locking. Subscribers get "SNAPSHOT"/cycle on an inproc
+ * PUB/SUB socket after each publish and should fall back to their own
+ * polling only when the latest snapshot is not fresh.
+ */
+class NUTSnapshotBus {
+ public:
+    //! \brief the bus shared by all actors of the process
+    static NUTSnapshotBus& instance ();
+
+    //! \brief bind the notification socket, call from the publishing actor
+    bool open ();
+    //! \brief unbind the notification socket, call before the actor exits
+    void close ();
+
+    //! \brief make snapshot the latest one and notify subscribers
+    void publish (std::shared_ptr <NUTSnapshot> snapshot);
+    //! \brief latest snapshot, NULL if nothing was published yet
+    NUTSnapshotPtr latest () const;
+    //! \brief true if latest snapshot is not older than maxAge [ms]
+    bool fresh (int64_t maxAge) const;
+
+    //! \brief new SUB socket for notifications, owned by caller
+    static zsock_t *subscribe ();
+
+    /**
+     * \brief Make snapshot the latest one of the status lane and notify
+     *        its subscribers by "STATUS"/cycle.
+     *
+     * Status snapshots carry just the status and alert status variables of
+     * all devices, read between the full snapshots. They are kept apart, so
+     * readers of latest () always get all variables.
+     */
+    void publishStatus (std::shared_ptr <NUTSnapshot> snapshot);
+    //! \brief latest status snapshot, NULL if nothing was published yet
+    NUTSnapshotPtr latestStatus () const;
+    //! \brief new SUB socket for status notifications, owned by caller
+    static zsock_t *subscribeStatus ();
+
+    NUTSnapshotBus () {};
+    NUTSnapshotBus (const NUTSnapshotBus&) = delete;
+    NUTSnapshotBus& operator= (const NUTSnapshotBus&) = delete;
+ private:
+    mutable std::mutex _mutex;      //!< protects _latest* and _*cycle
+    NUTSnapshotPtr _latest;
+    NUTSnapshotPtr _latestStatus;
+    uint64_t _cycle = 0;
+    uint64_t _statusCycle = 0;
+    zsock_t *_publisher = NULL;     //!< used by the publishing actor only
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_snapshot_test (bool verbose);
+//  @end
+
+#endif
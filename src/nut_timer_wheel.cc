@@ -0,0 +1,255 @@
+/*  =========================================================================
+    nut_timer_wheel - hierarchical timer wheel for polling schedule
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    nut_timer_wheel - hierarchical timer wheel for polling schedule
+@discuss
+    Level 0 has one slot per tick, every slot of level N covers a whole
+    turn of level N-1. When level N-1 wraps, one slot of level N is
+    cascaded (its timers are inserted again, landing in finer levels).
+    Timers further than the whole wheel wait in the last level and are
+    re-inserted until they fit.
+
+    Cancelled timers are not searched for in the slots, they are just
+    forgotten in the name index and skipped when their slot is processed.
+@end
+*/
+
+#include "fty_nut_classes.h"
+
+namespace drivers
+{
+namespace nut
+{
+
+NUTTimerWheel::NUTTimerWheel (int64_t tick) :
+    _tick (tick > 0 ? tick : NUT_TIMER_WHEEL_TICK_MS)
+{
+}
+
+void NUTTimerWheel::start (int64_t now)
+{
+    if (_started) return;
+    _current = now / _tick;
+    _started = true;
+}
+
+void NUTTimerWheel::schedule (const std::string& name, int64_t when)
+{
+    Entry entry { name, (when + _tick - 1) / _tick };
+    _timers[name] = entry.expires;
+    insert (std::move (entry));
+}
+
+void NUTTimerWheel::cancel (const std::string& name)
+{
+    _timers.erase (name);
+}
+
+void NUTTimerWheel::clear ()
+{
+    _timers.clear ();
+    _due.clear ();
+    for (auto& level : _slots) {
+        for (auto& slot : level) {
+            slot.clear ();
+        }
+    }
+}
+
+void NUTTimerWheel::insert (Entry entry)
+{
+    int64_t delta = entry.expires - _current;
+    if (delta <= 0) {
+        _due.push_back (std::move (entry));
+        return;
+    }
+    for (int level = 0; level < NUT_TIMER_WHEEL_LEVELS; ++level) {
+        int shift = level * NUT_TIMER_WHEEL_BITS;
+        if (delta < (SLOTS << shift)) {
+            _slots [level][(entry.expires >> shift) & (SLOTS - 1)].push_back (std::move (entry));
+            return;
+        }
+    }
+    // beyond the wheel, wait in the farthest slot and try again on cascade
+    int shift = (NUT_TIMER_WHEEL_LEVELS - 1) * NUT_TIMER_WHEEL_BITS;
+    int64_t farthest = _current + (SLOTS << shift) - 1;
+    _slots [NUT_TIMER_WHEEL_LEVELS - 1][(farthest >> shift) & (SLOTS - 1)].push_back (std::move (entry));
+}
+
+void NUTTimerWheel::cascade (int level)
+{
+    if (level >= NUT_TIMER_WHEEL_LEVELS) return;
+    int64_t index = (_current >> (level * NUT_TIMER_WHEEL_BITS)) & (SLOTS - 1);
+    if (index == 0) {
+        // coarser level wrapped as well, its timers may land in this slot
+        cascade (level + 1);
+    }
+    std::vector <Entry> entries;
+    entries.swap (_slots [level][index]);
+    for (auto& entry : entries) {
+        auto it = _timers.find (entry.name);
+        if (it != _timers.end () && it->second == entry.expires) {
+            insert (std::move (entry));
+        }
+    }
+}
+
+std::vector <std::string> NUTTimerWheel::advance (int64_t now)
+{
+    std::vector <std::string> expired;
+    auto fire = [this, &expired] (std::vector <Entry>& entries) {
+        for (const auto& entry : entries) {
+            auto it = _timers.find (entry.name);
+            if (it != _timers.end () && it->second == entry.expires) {
+                expired.push_back (entry.name);
+                _timers.erase (it);
+            }
+        }
+        entries.clear ();
+    };
+
+    start (now);
+    fire (_due);
+    int64_t target = now / _tick;
+    while (_current < target) {
+        ++_current;
+        if ((_current & (SLOTS - 1)) == 0) {
+            cascade (1);
+        }
+        fire (_slots [0][_current & (SLOTS - 1)]);
+        fire (_due);
+    }
+    return expired;
+}
+
+int64_t NUTTimerWheel::timeout (int64_t now) const
+{
+    if (_timers.empty ()) return -1;
+    if (!_due.empty () || !_started) return 0;
+    // the next cascade is at most one turn of level 0 away
+    for (int64_t tick = _current + 1; ; ++tick) {
+        if ((tick & (SLOTS - 1)) == 0 || !_slots [0][tick & (SLOTS - 1)].empty ()) {
+            return std::max <int64_t> (0, tick * _tick - now);
+        }
+    }
+}
+
+int64_t NUTTimerWheel::phase (const std::string& name, int64_t period)
+{
+    if (period <= 0) return 0;
+    // FNV-1a, stable across runs and platforms
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash % period;
+}
+
+int64_t NUTTimerWheel::align (int64_t when, int64_t phase, int64_t period)
+{
+    if (period <= 0) return when;
+    return when + ((phase - when) % period + period) % period;
+}
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  --------------------------------------------------------------------------
+//  Self test of this class
+
+void
+nut_timer_wheel_test (bool verbose)
+{
+    printf (" * nut_timer_wheel: ");
+
+    //  @selftest
+    using drivers::nut::NUTTimerWheel;
+
+    NUTTimerWheel wheel (100);
+    assert (wheel.timeout (0) == -1);
+    int64_t now = 1000000;
+    assert (wheel.advance (now).empty ());
+
+    wheel.schedule ("near", now + 250);
+    wheel.schedule ("middle", now + 30000);         // level 1
+    wheel.schedule ("far", now + 3600000);          // level 2
+    wheel.schedule ("beyond", now + 48 * 3600000);  // past the wheel
+    wheel.schedule ("cancelled", now + 500);
+    wheel.schedule ("moved", now + 500);
+    wheel.cancel ("cancelled");
+    wheel.schedule ("moved", now + 700);
+    assert (wheel.size () == 5);
+    assert (wheel.timeout (now) == 300);
+
+    auto expired = wheel.advance (now + 299);
+    assert (expired.empty ());
+    expired = wheel.advance (now + 300);
+    assert (expired.size () == 1 && expired[0] == "near");
+    expired = wheel.advance (now + 600);
+    assert (expired.empty ());
+    expired = wheel.advance (now + 700);
+    assert (expired.size () == 1 && expired[0] == "moved");
+
+    expired = wheel.advance (now + 29999);
+    assert (expired.empty ());
+    expired = wheel.advance (now + 30000);
+    assert (expired.size () == 1 && expired[0] == "middle");
+
+    expired = wheel.advance (now + 3599900);
+    assert (expired.empty ());
+    expired = wheel.advance (now + 3600000);
+    assert (expired.size () == 1 && expired[0] == "far");
+
+    expired = wheel.advance (now + 48 * 3600000 - 100);
+    assert (expired.empty ());
+    expired = wheel.advance (now + 48 * 3600000);
+    assert (expired.size () == 1 && expired[0] == "beyond");
+    assert (wheel.size () == 0);
+
+    // overdue timers fire on next advance
+    now += 48 * 3600000;
+    wheel.schedule ("late", now - 1000);
+    assert (wheel.timeout (now) == 0);
+    expired = wheel.advance (now);
+    assert (expired.size () == 1 && expired[0] == "late");
+
+    // phases are deterministic and inside the period
+    int64_t phase = NUTTimerWheel::phase ("ups-1", 30000);
+    assert (phase == NUTTimerWheel::phase ("ups-1", 30000));
+    assert (phase >= 0 && phase < 30000);
+    assert (NUTTimerWheel::align (60000, 100, 30000) == 60100);
+    assert (NUTTimerWheel::align (60200, 100, 30000) == 90100);
+    assert (NUTTimerWheel::align (60100, 100, 30000) == 60100);
+
+    // devices spread over the period
+    int buckets [10] = { 0 };
+    for (int i = 0; i < 1000; ++i) {
+        buckets [NUTTimerWheel::phase ("epdu-" + std::to_string (i), 30000) / 3000]++;
+    }
+    for (int i = 0; i < 10; ++i) {
+        assert (buckets [i] > 50 && buckets [i] < 150);
+    }
+    //  @end
+    printf ("OK\n");
+}
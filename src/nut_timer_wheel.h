@@ -0,0 +1,96 @@
+/*  =========================================================================
+    nut_timer_wheel - hierarchical timer wheel for polling schedule
+
+    Copyright (C) 2014 - 2017 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#ifndef NUT_TIMER_WHEEL_H_INCLUDED
+#define NUT_TIMER_WHEEL_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define NUT_TIMER_WHEEL_TICK_MS     100     //!< resolution of the polling schedule
+#define NUT_TIMER_WHEEL_BITS        6       //!< 64 slots per level
+#define NUT_TIMER_WHEEL_LEVELS      3       //!< 6.4 s, 6.8 min and 7.3 h at 100 ms tick
+
+namespace drivers
+{
+namespace nut
+{
+
+/**
+ * \brief Hierarchical timer wheel of named timers.
+ *
+ * schedule () and advance () are O(1) per timer. Timers far in the
+ * future sit in coarser levels and cascade to finer ones as time goes.
+ * A name has at most one timer, scheduling it again replaces the old one.
+ */
+class NUTTimerWheel {
+ public:
+    explicit NUTTimerWheel (int64_t tick = NUT_TIMER_WHEEL_TICK_MS);
+
+    //! \brief set the wheel to time now [ms], done by first advance () as well
+    void start (int64_t now);
+
+    //! \brief (re)schedule timer name to expire at time when [ms], wheel must be started
+    void schedule (const std::string& name, int64_t when);
+    void cancel (const std::string& name);
+    void clear ();
+    size_t size () const { return _timers.size (); }
+
+    //! \brief move the wheel to time now [ms], return names of expired timers
+    std::vector <std::string> advance (int64_t now);
+
+    //! \brief [ms] from now to the next expiration, -1 if no timer is set
+    int64_t timeout (int64_t now) const;
+
+    //! \brief deterministic offset of name within period [ms]
+    static int64_t phase (const std::string& name, int64_t period);
+    //! \brief first time >= when [ms] that has given phase within period
+    static int64_t align (int64_t when, int64_t phase, int64_t period);
+
+ private:
+    struct Entry {
+        std::string name;
+        int64_t expires;    //!< [ticks]
+    };
+    static const int64_t SLOTS = 1 << NUT_TIMER_WHEEL_BITS;
+
+    void insert (Entry entry);
+    void cascade (int level);
+
+    int64_t _tick;
+    int64_t _current = 0;       //!< [ticks] time the wheel is at
+    bool _started = false;
+    std::vector <Entry> _slots [NUT_TIMER_WHEEL_LEVELS][SLOTS];
+    std::vector <Entry> _due;   //!< expired already when inserted
+    //! \brief name | expiration [ticks]; slot entries not matching are cancelled ones
+    std::map <std::string, int64_t> _timers;
+};
+
+} // namespace drivers::nut
+} // namespace drivers
+
+//  Self test of this class
+FTY_NUT_EXPORT void
+    nut_timer_wheel_test (bool verbose);
+//  @end
+
+#endif
@@ -33,6 +33,16 @@ static const char* STATE = "/var/lib/fty/fty-nut/state_file";
 int
 handle_asset_message (mlm_client_t *client, nut_t *data, zmsg_t **message_p);
 
+//  Session of nutClients polled by handle which, NULL if none
+static drivers::nut::NUTAsyncClient *
+s_nut_client (std::map <std::string, std::unique_ptr <drivers::nut::NUTAsyncClient>>& nutClients, void *which)
+{
+    for (auto& nutClient : nutClients) {
+        if (nutClient.second->handle () == which) return nutClient.second.get ();
+    }
+    return NULL;
+}
+
 void
 sensor_actor (zsock_t *pipe, void *args)
 {
@@ -40,6 +50,11 @@ sensor_actor (zsock_t *pipe, void *args)
     uint64_t polling = 30000;
     bool verbose = false;
     Sensors sensors;
+    //! upsd endpoint | session asking it for sensors
+    std::map <std::string, std::unique_ptr <drivers::nut::NUTAsyncClient>> nutClients;
+    //! upsd endpoint | its sensors, published when it answered all requests
+    std::map <std::string, drivers::nut::NUTEndpoint> awaiting;
+    bool publishPending = false;
 
     mlm_client_t *client = mlm_client_new ();
     if (!client) {
@@ -47,9 +62,12 @@ sensor_actor (zsock_t *pipe, void *args)
         return;
     }
 
-    zpoller_t *poller = zpoller_new (pipe, mlm_client_msgpipe (client), NULL);
+    auto& snapshotBus = drivers::nut::NUTSnapshotBus::instance ();
+    zsock_t *snapshots = drivers::nut::NUTSnapshotBus::subscribe ();
+    zpoller_t *poller = zpoller_new (pipe, mlm_client_msgpipe (client), snapshots, NULL);
     if (!poller) {
         log_critical ("zpoller_new () failed");
+        zsock_destroy (&snapshots);
         mlm_client_destroy (&client);
         return;
     }
@@ -65,12 +83,55 @@ sensor_actor (zsock_t *pipe, void *args)
     int64_t publishtime = zclock_mono();
     while (!zsys_interrupted) {
         void *which = zpoller_wait (poller, polling);
-        if (which == NULL || zclock_mono() - publishtime > (int64_t)polling) {
+        if (which == snapshots) {
+            zmsg_t *msg = zmsg_recv (snapshots);
+            zmsg_destroy (&msg);
+            auto snapshot = snapshotBus.latest ();
+            if (snapshot) {
+                log_debug ("sa: sensor update from snapshot %" PRIu64, snapshot->cycle);
+                sensors.updateFromSnapshot (*snapshot);
+                publishPending = true;
+                publishtime = zclock_mono();
+            }
+        }
+        else if (snapshotBus.fresh (2 * polling) && (which == NULL || zclock_mono() - publishtime > (int64_t)polling)) {
+            // next snapshot is on its way, nothing to ask upsd for
+            publishtime = zclock_mono();
+        }
+        else if (which == NULL || zclock_mono() - publishtime > (int64_t)polling) {
+            // nut server stopped sending snapshots, read sensors ourselves
             log_debug ("sa: sensor update");
-            sensors.updateFromNUT ();
-            sensors.publish (client, polling*2/1000);
+            for (const auto& endpoint : drivers::nut::NUTEndpoints::instance ().inUse ()) {
+                auto& nutClient = nutClients[endpoint.toString ()];
+                if (!nutClient) {
+                    nutClient.reset (new drivers::nut::NUTAsyncClient (endpoint.host, endpoint.port));
+                }
+                if (nutClient->pending ()) {
+                    // its sensors were not published, they are asked again
+                    log_warning ("sa: upsd %s did not answer %zu requests, reconnecting",
+                                 endpoint.toString ().c_str (), nutClient->pending ());
+                    zpoller_remove (poller, nutClient->handle ());
+                    nutClient->disconnect ();
+                    awaiting.erase (endpoint.toString ());
+                }
+                if (!nutClient->isConnected () && nutClient->connect ()) {
+                    zpoller_add (poller, nutClient->handle ());
+                }
+                // all GET VARs are sent at once, sensors of an upsd are
+                // published when its last reply arrives, a hung upsd holds
+                // back just its own
+                if (nutClient->isConnected ()) {
+                    sensors.requestFromNUT (*nutClient, endpoint);
+                    awaiting[endpoint.toString ()] = endpoint;
+                }
+            }
             publishtime = zclock_mono();
         }
+        else if (auto nutClient = s_nut_client (nutClients, which)) {
+            if (!nutClient->receive ()) {
+                zpoller_remove (poller, nutClient->handle ());
+            }
+        }
         else if (which == pipe) {
             zmsg_t *msg = zmsg_recv (pipe);
             if (msg) {
@@ -91,8 +152,22 @@ sensor_actor (zsock_t *pipe, void *args)
             zmsg_t *msg = zmsg_recv (which);
             zmsg_destroy (&msg);
         }
+        if (publishPending) {
+            sensors.publish (client, polling*2/1000);
+            publishPending = false;
+        }
+        for (auto it = awaiting.begin (); it != awaiting.end (); ) {
+            auto nutClient = nutClients.find (it->first);
+            if (nutClient != nutClients.end () && nutClient->second->pending () > 0) {
+                ++it;
+                continue;
+            }
+            sensors.publish (client, polling*2/1000, it->second);
+            it = awaiting.erase (it);
+        }
     }
     zpoller_destroy (&poller);
+    zsock_destroy (&snapshots);
     mlm_client_destroy (&client);
 }
 
@@ -164,6 +239,24 @@ sensor_actor_test (bool verbose)
     assert (streq (fty_proto_type (bmsg), "humidity.1"));
     fty_proto_destroy (&bmsg);
 
+    // sensors of one upsd go without the others
+    auto& endpoints = drivers::nut::NUTEndpoints::instance ();
+    endpoints.assign ("nut-far", "upsd-far");
+    sensors._sensors["sensor9"] = Sensor ("nut-far", 0, "PRG", "9", children, "");
+    sensors._sensors["sensor9"]._humidity = "70";
+    sensors.publish (producer, 300, endpoints.lookup ("nut-far"));
+    sensors.publish (producer, 300, endpoints.lookup ("nut"));
+    for (const char *value : { "70", "28", "51" }) {
+        msg = mlm_client_recv (consumer);
+        assert (msg);
+        bmsg = fty_proto_decode (&msg);
+        assert (bmsg);
+        assert (streq (fty_proto_value (bmsg), value));
+        fty_proto_destroy (&bmsg);
+    }
+    sensors._sensors.erase ("sensor9");
+    endpoints.assign ("nut-far", "");
+
     // gpio on EMP001
     std::vector <std::string> contacts;
     children.emplace ("1", "sensorgpio-1");
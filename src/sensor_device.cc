@@ -24,55 +24,36 @@
 #include <vector>
 #include <string>
 
-void Sensor::update (nut::TcpClient &conn)
+std::vector <std::string> Sensor::variables () const
 {
-    log_debug ("sa: updating temperature and humidity from NUT device %s", _nutMaster.c_str());
-    auto nutDevice = conn.getDevice(_nutMaster);
-    if (! nutDevice.isOk()) {
-        log_debug ("sa: NUT device %s is not ready", _nutMaster.c_str());
-        return;
-    }
-    try {
-        std::string prefix = nutPrefix();
-        log_debug ("sa: getting %stemperature from %s", prefix.c_str(), _nutMaster.c_str());
-        auto temperature = nutDevice.getVariableValue (prefix + "temperature");
-        if (temperature.empty ()) {
-            log_debug ("sa: %stemperature on %s is not present", prefix.c_str(), _location.c_str ());
-        } else {
-            _temperature =  temperature[0];
-            log_debug ("sa: %stemperature on %s is %s", prefix.c_str (), _location.c_str (), _temperature.c_str());
-        }
-
-        log_debug ("sa: getting %shumidity from %s", prefix.c_str(), _nutMaster.c_str());
-        auto humidity = nutDevice.getVariableValue (prefix + "humidity");
-        if (humidity.empty ()) {
-            log_debug ("sa: %shumidity on %s is not present", prefix.c_str(), _location.c_str ());
-        } else {
-            _humidity =  humidity[0];
-            log_debug ("sa: %shumidity on %s is %s", prefix.c_str (), _location.c_str (), _humidity.c_str());
-
-        }
-
-        std::string state = nutDevice.getVariableValue (prefix + "contacts.1.status")[0];
-        if (state != "unknown" && state != "bad")
-            _contacts.push_back (state);
-        else
-            zsys_debug ("sa: %scontact.1.status state %s", prefix.c_str (), state.c_str ());
+    std::string prefix = nutPrefix ();
+    return {
+        prefix + "temperature",
+        prefix + "humidity",
+        prefix + "contacts.1.status",
+        prefix + "contacts.2.status"
+    };
+}
 
-        state = nutDevice.getVariableValue (prefix + "contacts.2.status")[0];
-        if (state != "unknown" && state != "bad")
-            _contacts.push_back (state);
+void Sensor::update (const std::string& variable, const std::string& value)
+{
+    std::string prefix = nutPrefix ();
+    if (variable.compare (0, prefix.size (), prefix) != 0) return;
+    std::string name = variable.substr (prefix.size ());
+    if (name == "temperature") {
+        _temperature = value;
+        log_debug ("sa: %stemperature on %s is %s", prefix.c_str (), _location.c_str (), _temperature.c_str());
+    }
+    else if (name == "humidity") {
+        _humidity = value;
+        log_debug ("sa: %shumidity on %s is %s", prefix.c_str (), _location.c_str (), _humidity.c_str());
+    }
+    else if (name == "contacts.1.status" || name == "contacts.2.status") {
+        if (value != "unknown" && value != "bad")
+            _contacts.push_back (value);
         else
-            zsys_debug ("sa: %scontact.2.status state %s", prefix.c_str (), state.c_str ());
-
-        log_debug ("sa: %scontact.status on %s: contact.1 %s, contact.2 %s",
-                   prefix.c_str (),
-                   _location.c_str (),
-                   nutDevice.getVariableValue (prefix + "contacts.1.status")[0].c_str (),
-                   nutDevice.getVariableValue (prefix + "contacts.2.status")[0].c_str ()
-        );
-
-    } catch (...) {}
+            log_debug ("sa: %s%s state %s", prefix.c_str (), name.c_str (), value.c_str ());
+    }
 }
 
 std::string Sensor::topicSuffix () const
@@ -248,6 +229,21 @@ sensor_device_test(bool verbose)
     assert (d.sensorPrefix() == "device.2.ambient.3.");
     assert (d.topicSuffix() == ".3@ups2");
 
+    // values are matched by NUT variable name
+    auto variables = d.variables ();
+    assert (variables.size () == 4);
+    assert (variables[0] == "device.2.ambient.3.temperature");
+    d.update (variables[0], "21.5");
+    d.update (variables[1], "40");
+    d.update (variables[2], "bad");
+    d.update (variables[3], "open");
+    d.update ("device.1.ambient.3.temperature", "99");
+    assert (d._temperature == "21.5");
+    assert (d._humidity == "40");
+    assert (d._contacts.size () == 1 && d._contacts[0] == "open");
+    d.clearContacts ();
+    assert (d._contacts.empty ());
+
     //  @end
     printf (" OK\n");
 }
@@ -24,7 +24,6 @@
 
 #include <map>
 #include <string>
-#include <nutclient.h>
 #include <malamute.h>
 
 #include "fty_nut_library.h"
@@ -41,7 +40,12 @@ class Sensor {
         _sname (sname)
         { };
     Sensor () { };
-    void update (nut::TcpClient &conn);
+    //! \brief NUT variables of the master device read for this sensor
+    std::vector <std::string> variables () const;
+    //! \brief store value of one of variables (), contacts in order of arrival
+    void update (const std::string& variable, const std::string& value);
+    void clearContacts () { _contacts.clear (); };
+    const std::string& nutMaster () const { return _nutMaster; };
     void publish (mlm_client_t *client, int ttl);
     void addChild (const char* port, const char *child_name);
     std::map <std::string, std::string> getChildren ();
@@ -30,17 +30,52 @@
 
 //  Structure of our class
 
-void Sensors::updateFromNUT ()
+void Sensors::requestFromNUT (drivers::nut::NUTAsyncClient& client, const drivers::nut::NUTEndpoint& endpoint)
 {
-    try {
-        nut::TcpClient nutClient;
-        nutClient.connect ("localhost", 3493);
-        for (auto& it : _sensors) {
-            it.second.update (nutClient);
+    auto& breaker = drivers::nut::NUTCircuitBreaker::instance ();
+    auto& endpoints = drivers::nut::NUTEndpoints::instance ();
+    for (auto& it : _sensors) {
+        if (endpoints.lookup (it.second.nutMaster ()) != endpoint) continue;
+        // master failed repeatedly, keep what we have
+        if (! breaker.allow (it.second.nutMaster ())) continue;
+        it.second.clearContacts ();
+        // sensor list may change before the reply comes, look it up by name
+        std::string name = it.first;
+        for (const auto& variable : it.second.variables ()) {
+            client.getVar (it.second.nutMaster (), variable,
+                [this, name, &breaker] (const drivers::nut::NUTAsyncReply& reply) {
+                    if (!reply.ok) {
+                        log_debug ("sa: %s not read from %s (%s)", name.c_str (), reply.device.c_str (), reply.error.c_str ());
+                        // missing variable says nothing about the master
+                        if (reply.error == "UNKNOWN-UPS" ||
+                            reply.error == "DRIVER-NOT-CONNECTED" ||
+                            reply.error == "DATA-STALE") {
+                            breaker.failure (reply.device, reply.error);
+                        }
+                        return;
+                    }
+                    breaker.success (reply.device);
+                    auto sensor = _sensors.find (name);
+                    if (sensor == _sensors.end ()) return;
+                    sensor->second.update (reply.vars[0].first, reply.vars[0].second);
+                });
+        }
+    }
+}
+
+void Sensors::updateFromSnapshot (const drivers::nut::NUTSnapshot& snapshot)
+{
+    for (auto& it : _sensors) {
+        // master may be skipped in this cycle, keep what we have
+        auto vars = snapshot.find (it.second.nutMaster ());
+        if (!vars) continue;
+        it.second.clearContacts ();
+        for (const auto& variable : it.second.variables ()) {
+            auto value = vars->find (variable);
+            if (value != vars->end () && !value->second.empty ()) {
+                it.second.update (variable, value->second[0]);
+            }
         }
-        nutClient.disconnect();
-    } catch (std::exception& e) {
-        log_error ("reading data from NUT: %s", e.what ());
     }
 }
 
@@ -152,6 +187,15 @@ void Sensors::publish (mlm_client_t *client, int ttl)
     }
 }
 
+void Sensors::publish (mlm_client_t *client, int ttl, const drivers::nut::NUTEndpoint& endpoint)
+{
+    auto& endpoints = drivers::nut::NUTEndpoints::instance ();
+    for (auto& it : _sensors) {
+        if (endpoints.lookup (it.second.nutMaster ()) != endpoint) continue;
+        it.second.publish (client, ttl);
+    }
+}
+
 
 //  --------------------------------------------------------------------------
 //  Self test of this class
@@ -224,6 +268,17 @@ sensor_list_test (bool verbose)
     assert (list._sensors["sensor-2"].sensorPrefix() == "device.2.ambient.21.");
     assert (list._sensors["sensor-2"].topicSuffix() == ".21@epdu-2");
 
+    // values are taken from snapshot of the master device
+    drivers::nut::NUTSnapshot snapshot;
+    snapshot.devices["ups-1"]["ambient.temperature"] = { "25" };
+    snapshot.devices["epdu-1"]["device.2.ambient.21.humidity"] = { "45" };
+    snapshot.devices["epdu-1"]["device.2.ambient.21.contacts.1.status"] = { "open" };
+    list.updateFromSnapshot (snapshot);
+    assert (list._sensors["sensor-1"]._temperature == "25");
+    assert (list._sensors["sensor-1"]._humidity.empty ());
+    assert (list._sensors["sensor-2"]._humidity == "45");
+    assert (list._sensors["sensor-2"]._contacts.size () == 1);
+
     nut_destroy (&config);
     //  @end
     printf ("OK\n");
@@ -24,9 +24,14 @@
 
 class Sensors {
  public:
-    void updateFromNUT ();
+    //! \brief queue reading of sensors whose master endpoint serves, values
+    //!        are stored as replies arrive
+    void requestFromNUT (drivers::nut::NUTAsyncClient& client, const drivers::nut::NUTEndpoint& endpoint);
+    void updateFromSnapshot (const drivers::nut::NUTSnapshot& snapshot);
     void updateSensorList (nut_t *config);
     void publish (mlm_client_t *client, int ttl);
+    //! \brief publish just the sensors whose master endpoint serves
+    void publish (mlm_client_t *client, int ttl, const drivers::nut::NUTEndpoint& endpoint);
 
     // friend function for unit-testing
     friend void sensor_list_test (bool verbose);
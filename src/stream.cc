@@ -56,8 +56,17 @@ stream_deliver_handle (
         zmsg_destroy (message_p);
         return;
     }
+    // device may be reachable with its new configuration, don't wait for
+    // the probe; circuits are kept by NUT device, the master for a daisy
+    // chain member, which the change may have moved
+    std::string asset = fty_proto_name (proto);
+    std::string before = nut_agent.nutName (asset);
     nut_put (data, &proto);
     nut_agent.updateDeviceList (data);
+    std::string after = nut_agent.nutName (asset);
+    auto &breaker = drivers::nut::NUTCircuitBreaker::instance ();
+    breaker.reset (after.empty () ? asset : after);
+    if (!before.empty () && before != after) breaker.reset (before);
 }
 
 //  --------------------------------------------------------------------------